@@ -0,0 +1,100 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// arena.cpp
+// Memory that is allocated in big blocks and freed all at once
+
+#include "arena.h"
+
+#include <vector>
+#include <memory>
+#include <algorithm>	/* max, swap */
+#include <cstddef>
+using namespace std;
+
+Arena::Arena(size_t blockSize)
+{
+	blockSize_ = blockSize;
+}
+
+// Each block is at least as big as everything before it, so there are few of them
+void Arena::AddBlock(size_t bytes)
+{
+	size_t size = max(max(bytes, blockSize_), total_);
+	blocks_.push_back({unique_ptr<char[]>(new char[size]), size});
+	used_ = 0;
+}
+
+void Arena::Reserve(size_t bytes)
+{
+	if (blocks_.empty() || blocks_.back().size - used_ < bytes)
+	{
+		AddBlock(bytes);
+	}
+}
+
+void* Arena::Allocate(size_t bytes, size_t alignment)
+{
+	size_t padding = 0;
+
+	if (!blocks_.empty())
+	{
+		size_t address = reinterpret_cast<size_t>(blocks_.back().data.get()) + used_;
+		padding = (alignment - address % alignment) % alignment;
+	}
+
+	if (blocks_.empty() || blocks_.back().size - used_ < bytes + padding)
+	{
+		// New blocks come from 'new' and are aligned for any type
+		AddBlock(bytes);
+		padding = 0;
+	}
+
+	void* p = blocks_.back().data.get() + used_ + padding;
+	used_ += bytes + padding;
+	total_ += bytes + padding;
+
+	return p;
+}
+
+void Arena::Reset()
+{
+	blocks_.clear();
+	used_ = 0;
+	total_ = 0;
+}
+
+void Arena::Swap(Arena& other)
+{
+	swap(blocks_, other.blocks_);
+	swap(used_, other.used_);
+	swap(total_, other.total_);
+	swap(blockSize_, other.blockSize_);
+}
+
+size_t Arena::Used() const
+{
+	return total_;
+}
+
+size_t Arena::Capacity() const
+{
+	size_t capacity = 0;
+
+	for (unsigned int i = 0; i < blocks_.size(); i++)
+		capacity += blocks_[i].size;
+
+	return capacity;
+}
@@ -0,0 +1,69 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// arena.h
+// Memory that is allocated in big blocks and freed all at once
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <memory>
+#include <new>	/* placement new */
+#include <type_traits>	/* is_trivially_destructible */
+#include <cstddef>
+using namespace std;
+
+class Arena
+{
+private:
+	struct Block
+	{
+		unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	vector<Block> blocks_;
+	size_t used_ = 0;	// Bytes used in the last block
+	size_t total_ = 0;	// Bytes used in every block
+	size_t blockSize_;
+
+	void AddBlock(size_t bytes);
+
+public:
+	explicit Arena(size_t blockSize = 64 * 1024);
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// Make sure that the next allocations that add up to 'bytes' come from the same block
+	void Reserve(size_t bytes);
+	void* Allocate(size_t bytes, size_t alignment);
+
+	// Objects are never destroyed one by one, so they must not need their destructor
+	template<class T> T* New()
+	{
+		static_assert(is_trivially_destructible<T>::value, "Objects in an arena are not destroyed");
+		return new (Allocate(sizeof(T), alignof(T))) T();
+	}
+
+	void Reset();	// Free everything
+	void Swap(Arena& other);
+
+	size_t Used() const;
+	size_t Capacity() const;
+};
+
+#endif	// ARENA_H
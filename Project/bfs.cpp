@@ -0,0 +1,147 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// bfs.cpp
+// Breadth-first search algorithm
+
+#include "bfs.h"
+#include "graph.h"
+
+#include <algorithm>	/* reverse */
+#include <vector>
+using namespace std;
+
+void BreadthFirstSearch::Reset(const Graph& graph)
+{
+	// Every node is queued once at most, so the ring buffer never has to grow during a search.
+	// It has a free slot more than the nodes, otherwise a full queue would look empty.
+	size_t size = 1;
+	while (size <= graph.Size())
+		size *= 2;
+
+	if (queue_.size() < size)
+		queue_.resize(size);
+
+	parent_.resize(graph.Size());
+	visited_.assign((graph.Size() + 63) / 64, 0);
+	path_.clear();
+}
+
+bool BreadthFirstSearch::Reached(NodeId node) const
+{
+	return node / 64 < visited_.size() && (visited_[node / 64] >> (node % 64)) & 1;
+}
+
+NodeId BreadthFirstSearch::Parent(NodeId node) const
+{
+	return Reached(node) ? parent_[node] : NO_NODE;
+}
+
+// Returns true if the goal was reached
+bool BreadthFirstSearch::Search(const Graph& graph, const NodeId* starts, size_t count, NodeId goal)
+{
+	Reset(graph);
+
+	// The members are copied to locals so the compiler keeps them in registers
+	const size_t mask = queue_.size() - 1;
+	NodeId* queue = queue_.data();
+	uint64_t* visited = visited_.data();
+	NodeId* parent = parent_.data();
+	size_t head = 0;
+	size_t tail = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (starts[i] < graph.Size() && !Reached(starts[i]))
+		{
+			visited[starts[i] / 64] |= 1ULL << (starts[i] % 64);
+			parent[starts[i]] = NO_NODE;
+			queue[tail] = starts[i];
+			tail = (tail + 1) & mask;
+		}
+	}
+
+	if (goal != NO_NODE && Reached(goal))
+		return true;
+
+	while (head != tail)
+	{
+		NodeId node = queue[head];
+		head = (head + 1) & mask;
+
+		for (NodeId neighbor: graph.Neighbors(node))
+		{
+			uint64_t bit = 1ULL << (neighbor % 64);
+
+			if (visited[neighbor / 64] & bit)
+				continue;
+
+			visited[neighbor / 64] |= bit;
+			parent[neighbor] = node;
+			queue[tail] = neighbor;
+			tail = (tail + 1) & mask;
+
+			if (neighbor == goal)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+const vector<NodeId>& BreadthFirstSearch::Find(const Graph& graph, NodeId start, NodeId goal)
+{
+	return Find(graph, &start, 1, goal);
+}
+
+const vector<NodeId>& BreadthFirstSearch::Find(const Graph& graph, const vector<NodeId>& starts, NodeId goal)
+{
+	return Find(graph, starts.data(), starts.size(), goal);
+}
+
+const vector<NodeId>& BreadthFirstSearch::Find(const Graph& graph, const NodeId* starts, size_t count, NodeId goal)
+{
+	if (goal < graph.Size() && Search(graph, starts, count, goal))
+	{
+		// Walk back from the goal
+		for (NodeId node = goal; node != NO_NODE; node = parent_[node])
+			path_.push_back(node);
+
+		reverse(path_.begin(), path_.end());
+	}
+	else
+	{
+		path_.clear();
+	}
+
+	return path_;
+}
+
+void BreadthFirstSearch::Flood(const Graph& graph, const vector<NodeId>& starts)
+{
+	Search(graph, starts.data(), starts.size(), NO_NODE);
+}
+
+vector<Float3> BFS(const Graph& graph, const Float3& node, const Float3& dest)
+{
+	static thread_local BreadthFirstSearch search;
+	vector<Float3> path;
+
+	for (NodeId id: search.Find(graph, graph.Find(node), graph.Find(dest)))
+		path.push_back(graph.Get(id));
+
+	return path;
+}
@@ -22,79 +22,40 @@
 #include "vecmath.h"
 #include "graph.h"
 
-#include <utility>
-#include <algorithm>
+#include <cstdint>
 #include <vector>
-#include <cassert>
-#include <iostream>
-
 using namespace std;
 
-vector<Float3> BFS(Graph graph, Float3 node, Float3 dest)
+// Finds the paths with the fewest links. The memory is kept from one search to the next,
+// so searches don't allocate once a graph of the same size was searched.
+class BreadthFirstSearch
 {
-	vector<Float3> visited;
-	vector<Float3> visitedFrom;
-	vector<Float3> queue;
-
-	visited.push_back(node);
-	visitedFrom.push_back(node);  // For the first element, "visited" == "visited form"
-	queue.push_back(node);        // Enqueue source node
-
-	while (!queue.empty())
-	{
-		// Return then pop first element
-		Float3 s = queue.front();
-		queue.erase(queue.begin());
-		cout << "(" << s.x << "," << s.y << ") " << endl;
-
-		// We'll enqueue neighbors nodes
-		for (auto& neighbor: graph.GetNeighbors(s))
-		{
-			vector<Float3>::iterator it = find(visited.begin(), visited.end(), neighbor);
-
-			if (it == visited.end()) {
-				// Not found, so not already visited
-
-				visited.push_back(neighbor);    // Mark as visited
-				queue.push_back(neighbor);      // Enqueue
-
-				// Save visited from to traceback the path later.
-				// For i, an index in the visited list, you'll get the 
-				// neighbors at the same i in the visitedFrom list.
-				visitedFrom.push_back(s);
+public:
+	// Path from 'start' to 'goal', both included. Empty if the goal can't be reached.
+	// The path is valid until the next search.
+	const vector<NodeId>& Find(const Graph& graph, NodeId start, NodeId goal);
 
-				// Destionation found, a path is possible. This path will be returned.
-				if (queue.back() == dest)
-				{
-					cout << "Found destination" << endl;
+	// Starts from every node of 'starts' at once, so the path begins at the one that is the closest to the goal
+	const vector<NodeId>& Find(const Graph& graph, const vector<NodeId>& starts, NodeId goal);
 
-					// Create path
-					vector<Float3> path;
-					Float3 current = queue.back();
-					path.push_back(current);
-					while (!(current == node))
-					{
-						it = find(visited.begin(), visited.end(), current);
+	// Visit every node that can be reached from the starts. Use Reached() and Parent() to know the result.
+	void Flood(const Graph& graph, const vector<NodeId>& starts);
 
-						// This assertion shall never fail
-						// The path will always be in made of visited nodes
-						assert(it != visited.end());
+	bool Reached(NodeId node) const;	// By the last search
+	NodeId Parent(NodeId node) const;	// Node it was reached from, or NO_NODE for a start
 
-						unsigned int i = distance(visited.begin(), it);
-						current = visitedFrom[i];
-						path.push_back(current);
-					}
+private:
+	vector<NodeId> queue_;	// Ring buffer, its size is a power of two
+	vector<uint64_t> visited_;	// One bit per node
+	vector<NodeId> parent_;
+	vector<NodeId> path_;
 
-					reverse(path.begin(), path.end());
-					return path;
-				}
-			}
-		}
-	}
+	void Reset(const Graph& graph);
+	bool Search(const Graph& graph, const NodeId* starts, size_t count, NodeId goal);
+	const vector<NodeId>& Find(const Graph& graph, const NodeId* starts, size_t count, NodeId goal);
+};
 
-	vector<Float3> empty;
-	cout << "Destination not found" << endl;
-	return empty;
-}
+// Same as BreadthFirstSearch, but with the positions of the nodes
+vector<Float3> BFS(const Graph& graph, const Float3& node, const Float3& dest);
 
 #endif	// BFS_H
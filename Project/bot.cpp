@@ -16,34 +16,58 @@
 // bot.cpp
 // AI bot
 
+#include "bot.h"
 #include "player.h"
 #include "level.h"
+#include "navmesh.h"	/* NavMesh */
+#include "sight.h"	/* LineOfSight */
 
 #include <cmath>
+#include <vector>
 
 using namespace std;
 
-Player* findTarget(Player* const bot, const Level* const lvl)
+void BotWorld::Capture(const Level& lvl)
+{
+	players.resize(lvl.players.size());
+
+	for (unsigned int i = 0; i < lvl.players.size(); i++)
+	{
+		const Player* p = lvl.players[i];
+		BotPlayerView& view = players[i];
+
+		view.pos = p->pos_;
+		view.mom = p->mom_;
+		view.cam = {p->CamX(), p->CamY(), p->CamZ()};
+		view.angle = p->GetRadianAngle(p->Angle);
+		view.radius = p->Radius();
+		view.timeSinceLastShot = p->TimeSinceLastShot;
+	}
+}
+
+void BotOutput::Clear()
+{
+	commands.clear();
+	spawns.clear();
+	queries.clear();
+}
+
+int findTarget(const BotWorld& world, uint32_t bot)
 {
 	// Have at least a bot and a player
-	if (lvl->players.size() >= 2)
+	if (world.players.size() >= 2)
 	{
-		for (unsigned int i = 0; i < lvl->players.size(); i++)
+		for (unsigned int i = 0; i < world.players.size(); i++)
 		{
 			// Target can't be itself
-			if (lvl->players[i] != bot)
+			if (i != bot)
 			{
-				return lvl->players[i];
+				return i;
 			}
 		}
 	}
 
-	return nullptr;
-}
-
-float angleBetweenPlayers(const Player* const source, const Player* const target)
-{
-	return atan2(source->PosY() - target->PosY(), source->PosX() - target->PosX());
+	return -1;
 }
 
 float distance(const Float3& u, const Float3& v)
@@ -62,17 +86,47 @@ float velocity(const Float3& v)
 }
 
 // Simple AI that follows a target
-void updateBot(Player* const bot, Level* const lvl)
+void ThinkBot(const BotWorld& world, uint32_t self, BotOutput& out)
 {
-	Player* target = findTarget(bot, lvl);
+	const BotPlayerView& bot = world.players[self];
+	BotCommand command = {self, 0, 0, bot.timeSinceLastShot};
+	int index = findTarget(world, self);
 
-	if (target)
+	if (index >= 0)
 	{
+		const BotPlayerView& target = world.players[index];
+
+		// Ask if the target can be seen. The answer comes on the next tic.
+		bool visible = true;
+
+		if (world.sight)
+		{
+			visible = world.sight->Get(self) == LineOfSight::VISIBLE;
+			out.queries.push_back({self, bot.cam, target.cam});
+		}
+
+		// Go around the walls by following the navmesh. Points that were already reached are skipped.
+		Float3 goal = target.pos;
+		bool detour = false;
+
+		if (world.nav && world.nav->FindPath(bot.pos, target.pos, out.path))
+		{
+			for (unsigned int i = 1; i + 1 < out.path.size() && !detour; i++)
+			{
+				if (distance(bot.pos, out.path[i]) > bot.radius)
+				{
+					goal = out.path[i];
+					detour = true;
+				}
+			}
+		}
+
 		// Calculate the turn towards the target
-		float currentAngle = bot->GetRadianAngle(bot->Angle);
+		float currentAngle = bot.angle;
 
 		// Calculate the turn to execute
-		int angleDiff = (currentAngle - angleBetweenPlayers(bot, target)) * 32768 / (M_PI * 2) + 16384;
+		float goalAngle = atan2(bot.pos.y - goal.y, bot.pos.x - goal.x);
+		int angleDiff = (currentAngle - goalAngle) * 32768 / (M_PI * 2) + 16384;
 
 		if (angleDiff > 16383)
 		{
@@ -83,38 +137,32 @@ void updateBot(Player* const bot, Level* const lvl)
 			angleDiff += 32768;
 		}
 
-		bot->Cmd.rotation = -angleDiff;
+		command.rotation = -angleDiff;
 
 		// Calculate distance from target
-		float dist = sqrt(pow(bot->PosX() - target->PosX(), 2) + pow(bot->PosY() - target->PosY(), 2));
+		float dist = distance(bot.pos, target.pos);
 
 		// Move closer if far
-		if (dist > 5.0f)
+		if (dist > 5.0f || detour)
 		{
-			bot->Cmd.forward = 10;
+			command.forward = 10;
 		}
 
 		// Fire at opponent
-		if (bot->TimeSinceLastShot > 30)
+		if (bot.timeSinceLastShot > 30 && visible)
 		{
-			// TODO: LINE OF SIGHT CHECK
-
-			bot->TimeSinceLastShot = 0;
-
-			// Get updated angle
-			currentAngle = bot->GetRadianAngle(bot->Angle);
+			command.timeSinceLastShot = 0;
 
 			const int PROJECTILE_SPEED = 1.0f;	// TODO: Has to get the value from the current weapon
 
 			// This code computes an interception point between two objects that move at a different speed
 			// Quadratic formula adapted from:
 			// https://stackoverflow.com/questions/37250215/intersection-of-two-moving-objects-with-latitude-longitude-coordinates
-			float dist = distance(bot->pos_, target->pos_);
-			float dir = direction(bot->pos_, target->pos_);
+			float dir = direction(bot.pos, target.pos);
 
 			// "target_dir" is the direction angle of the target
-			float target_dir = atan2(target->mom_.y, target->mom_.x);
-			float target_vel = velocity(target->mom_);
+			float target_dir = atan2(target.mom.y, target.mom.x);
+			float target_vel = velocity(target.mom);
 			// Angle "alpha" is the direction from chaser to target
 			float alpha = M_PI + dir - target_dir;
 			float chaser_vel = PROJECTILE_SPEED;
@@ -128,21 +176,22 @@ void updateBot(Player* const bot, Level* const lvl)
 			if (disc >= 0 && a != 0.0f && dist != 0.0f)
 			{
 				float time = (sqrt(disc) - b) / (2 * a);
-				float x = target->PosX() + target_vel * time * cos(target_dir);
-				float y = target->PosY() + target_vel * time * sin(target_dir);
+				float x = target.pos.x + target_vel * time * cos(target_dir);
+				float y = target.pos.y + target_vel * time * sin(target_dir);
 
-				float missile_zspeed = (target->PosZ() - bot->PosZ()) / dist;
-				float missile_dir = direction(bot->pos_, Float3{x, y , 0});
-				// Spawn missile
+				float missile_zspeed = (target.pos.z - bot.pos.z) / dist;
+				float missile_dir = direction(bot.pos, Float3{x, y , 0});
+				// Spawn missile. It's created once every bot had its turn.
 				// TODO: Aim at player if plasma, aim at ground if rocket because of splash damage
-				lvl->things.push_back(new Plasma(bot->PosX(), bot->PosY(), bot->CamZ() - 0.5f, cos(missile_dir), sin(missile_dir), missile_zspeed));
+				out.spawns.push_back({self, {bot.pos.x, bot.pos.y, bot.cam.z - 0.5f}, {cos(missile_dir), sin(missile_dir), missile_zspeed}});
 			}
 			// Else preserve ammo
 		}
 		else
 		{
-			bot->TimeSinceLastShot++;
+			command.timeSinceLastShot++;
 		}
-
 	}
+
+	out.commands.push_back(command);
 }
@@ -14,9 +14,73 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 // bot.h
-// AI bot
+// AI bot. The bots only read a copy of the players and write what they want to do in
+// buffers, so many bots can think at the same time.
 
-#include "player.h"
-#include "level.h"
+#ifndef BOT_H
+#define BOT_H
 
-void updateBot(Player* const bot, Level* const lvl);
+#include "vecmath.h"	/* Float3 */
+#include "sight.h"	/* SightQuery */
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+class Level;
+class NavMesh;
+class LineOfSight;
+
+// What the bots know about a player
+struct BotPlayerView
+{
+	Float3 pos;
+	Float3 mom;
+	Float3 cam;
+	float angle;	// In radians
+	float radius;
+	int timeSinceLastShot;
+};
+
+// Copy of the world that doesn't change while the bots think
+struct BotWorld
+{
+	vector<BotPlayerView> players;
+	const NavMesh* nav = nullptr;	// Without a navmesh, the bots go straight to their target
+	const LineOfSight* sight = nullptr;	// Without it, the bots fire blindly
+
+	void Capture(const Level& lvl);
+};
+
+// Applied to a player once every bot had its turn
+struct BotCommand
+{
+	uint32_t player;
+	short rotation;
+	signed char forward;
+	int timeSinceLastShot;
+};
+
+// A projectile fired by a bot
+struct BotSpawn
+{
+	uint32_t player;
+	Float3 pos;
+	Float3 mom;
+};
+
+// What the bots want to do. Each thread writes in its own.
+struct BotOutput
+{
+	vector<BotCommand> commands;
+	vector<BotSpawn> spawns;
+	vector<SightQuery> queries;	// Answered before the next tic
+	vector<Float3> path;	// Scratch memory
+
+	void Clear();
+};
+
+// Think for the bot that controls a player. Only 'out' is modified.
+void ThinkBot(const BotWorld& world, uint32_t bot, BotOutput& out);
+
+#endif	// BOT_H
@@ -0,0 +1,176 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// botbench.cpp
+// Measures how long the bots take to think
+
+#include "botbench.h"
+#include "botscheduler.h"	/* BotScheduler */
+#include "navmesh.h"	/* NavMesh */
+#include "level.h"	/* Level */
+#include "player.h"	/* Player */
+#include "plane.h"	/* Plane */
+#include "physics.h"	/* NewPositionIsValid, PlayerToPlayersCollision */
+#include "mainloop.h"	/* PlayTic */
+#include "gamestate.h"	/* GameState */
+#include "levelfile.h"	/* IsTiledLevel */
+#include "texture.h"	/* Texture::SetHeadless */
+#include "strutils.h"	/* EndsWith */
+#include "vecmath.h"	/* Float3, pointInPoly, PointHeightOnPoly */
+
+#include <cmath>
+#include <vector>
+#include <set>
+#include <utility>	/* pair */
+#include <chrono>
+#include <iostream>
+#include <iomanip>	/* setprecision */
+#include <algorithm>	/* sort */
+#include <stdexcept>
+using namespace std;
+
+// Distance between the places where the bots start. They must not touch each other.
+const float BOTBENCH_SPACING = Player::Radius_ * 2.2f;
+
+// Find places where the bots can start. They are on a grid so they don't touch, and they can reach the target.
+static void FindStarts(const Level& lvl, const NavMesh& nav, unsigned int count, vector<Float3>& starts)
+{
+	const Float3 target = lvl.players[0]->pos_;
+	set<pair<long, long>> used;	// The collisions between the players are in 2D
+	vector<Float3> path;
+	Player probe;
+
+	for (uint32_t n = 0; n < nav.NumNodes() && starts.size() < count; n++)
+	{
+		if (!nav.FindPath(nav.Node(n).center, target, path))
+			continue;
+
+		const Plane* p = lvl.planes[nav.Node(n).plane];
+		Float3 vertices[Plane::MAX_VERTICES];
+		unsigned int numVertices = p->GetVertices(vertices);
+
+		long x1 = (long)ceil(p->BoxMin().x / BOTBENCH_SPACING);
+		long x2 = (long)floor(p->BoxMax().x / BOTBENCH_SPACING);
+		long y1 = (long)ceil(p->BoxMin().y / BOTBENCH_SPACING);
+		long y2 = (long)floor(p->BoxMax().y / BOTBENCH_SPACING);
+
+		for (long y = y1; y <= y2 && starts.size() < count; y++)
+		{
+			for (long x = x1; x <= x2 && starts.size() < count; x++)
+			{
+				Float3 pos = {x * BOTBENCH_SPACING, y * BOTBENCH_SPACING, 0};
+
+				if (used.count({x, y}) || !pointInPoly(pos.x, pos.y, vertices, numVertices))
+					continue;
+
+				pos.z = PointHeightOnPoly(pos.x, pos.y, p->Max(), p->normal, p->centroid);
+				probe.pos_ = pos;
+
+				if (isnan(pos.z) || nav.FindNode(pos) != (int)n || !NewPositionIsValid(&probe, &lvl) ||
+					PlayerToPlayersCollision(&probe, lvl.players))
+					continue;
+
+				used.insert({x, y});
+				starts.push_back(pos);
+			}
+		}
+	}
+}
+
+void BotBenchmark(const BotBenchSettings& settings)
+{
+	if (settings.bots == 0 || settings.tics == 0)
+	{
+		throw runtime_error("The bot benchmark needs at least a bot and a tic.");
+	}
+
+	if (IsTiledLevel(settings.level))
+	{
+		throw runtime_error("Tiled levels don't have a navmesh. Use another level for the bot benchmark.");
+	}
+
+	Texture::SetHeadless(true);
+
+	// The first player is the target. It doesn't move.
+	Level lvl(settings.level, settings.scale, 1);
+	NavMesh nav(lvl, settings.level + NAVMESH_EXTENSION);
+
+	vector<Float3> starts;
+	FindStarts(lvl, nav, settings.bots, starts);
+
+	if (starts.size() < settings.bots)
+	{
+		// Only OBJ models can be scaled
+		string advice = EndsWith(settings.level, ".obj") ? "Use -scale to make it bigger." : "Use fewer bots or a bigger level.";
+		throw runtime_error("Only " + to_string(starts.size()) + " bots fit in '" + settings.level + "'. " + advice);
+	}
+
+	vector<uint32_t> bots;
+	for (unsigned int i = 0; i < starts.size(); i++)
+	{
+		Player* bot = new Player();
+		bot->pos_ = starts[i];
+		bot->Angle = (i * 2731) % 32768;
+
+		bots.push_back(lvl.players.size());
+		lvl.players.push_back(bot);
+		lvl.things.push_back(bot);
+	}
+
+	BotScheduler scheduler(lvl, bots, &nav, settings.threads);
+
+	cout << "Bot benchmark: " << settings.bots << " bots on " << settings.level << ", " << settings.tics << " tics, "
+		<< scheduler.Threads() << " threads" << endl;
+
+	vector<float> thinkTimes;	// Of each tic in microseconds
+	double thinkTotal = 0;
+	double playTotal = 0;
+	unsigned long long spawned = 0;
+	unsigned long long queries = 0;
+
+	for (unsigned int tic = 0; tic < settings.tics; tic++)
+	{
+		auto start = chrono::steady_clock::now();
+		scheduler.Think();
+		auto thought = chrono::steady_clock::now();
+		PlayTic(&lvl);
+		auto played = chrono::steady_clock::now();
+
+		float think = chrono::duration<float, micro>(thought - start).count();
+		thinkTimes.push_back(think);
+		thinkTotal += think;
+		playTotal += chrono::duration<double, micro>(played - thought).count();
+		spawned += scheduler.Spawned();
+		queries += scheduler.Queries();
+	}
+
+	sort(thinkTimes.begin(), thinkTimes.end());
+	unsigned int tics = settings.tics;
+
+	// The same hash with any number of threads shows that the bots don't depend on the order of the threads
+	GameState state;
+	state.Save(lvl);
+
+	cout << fixed << setprecision(2);
+	cout << "Think time per bot: " << thinkTotal / tics / settings.bots << "us" << endl;
+	cout << "Think time per tic: " << thinkTimes[thinkTimes.size() / 2] << "us (50%), " << thinkTimes[thinkTimes.size() * 99 / 100]
+		<< "us (99%), " << thinkTimes.back() << "us (max)" << endl;
+	cout << "Rest of the tic: " << playTotal / tics << "us" << endl;
+	cout << "Per tic: " << queries / tics << " line of sight queries, " << (double)spawned / tics << " projectiles" << endl;
+	cout.unsetf(ios::fixed);
+	cout << setprecision(6);
+	cout << "Hash of the game: " << hex << setw(16) << setfill('0') << state.Hash() << dec << setfill(' ') << endl;
+}
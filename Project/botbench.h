@@ -0,0 +1,39 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// botbench.h
+// Measures how long the bots take to think. A crowd of bots chases a player that doesn't move
+// on a level without a window.
+
+#ifndef BOTBENCH_H
+#define BOTBENCH_H
+
+#include <string>
+using namespace std;
+
+struct BotBenchSettings
+{
+	string level = "citadel.txt";
+	unsigned int bots = 1000;
+	unsigned int tics = 100;	// Colliding players make the tics slow when there are many bots
+	unsigned int threads = 0;	// Zero means one thread per core
+	float scale = 1;	// Of the level, if it's an OBJ model
+};
+
+// Prints the results
+void BotBenchmark(const BotBenchSettings& settings);
+
+#endif	// BOTBENCH_H
@@ -0,0 +1,127 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// botscheduler.cpp
+// Makes the bots think on many threads
+
+#include "botscheduler.h"
+#include "bot.h"	/* ThinkBot */
+#include "level.h"	/* Level */
+#include "player.h"	/* Player */
+#include "actor.h"	/* Plasma */
+
+#include <vector>
+#include <future>
+#include <algorithm>	/* min */
+using namespace std;
+
+// More ranges than threads, so a thread that finishes early can take another range
+const unsigned int BOT_RANGES_PER_THREAD = 4;
+
+BotScheduler::BotScheduler(Level& level, const vector<uint32_t>& bots, const NavMesh* nav, unsigned int threads):
+	level_(level), bots_(bots), pool_(threads), sight_(level, &pool_)
+{
+	world_.nav = nav;
+	world_.sight = &sight_;
+	outputs_.resize(pool_.Size() * BOT_RANGES_PER_THREAD);
+}
+
+void BotScheduler::Think()
+{
+	world_.Capture(level_);
+
+	unsigned int ranges = min((unsigned int)outputs_.size(), (unsigned int)bots_.size());
+	vector<future<void>> done;
+
+	for (unsigned int r = 0; r < ranges; r++)
+	{
+		unsigned int first = (unsigned long long)bots_.size() * r / ranges;
+		unsigned int last = (unsigned long long)bots_.size() * (r + 1) / ranges;
+		BotOutput& out = outputs_[r];
+
+		done.push_back(pool_.Submit([this, &out, first, last]
+		{
+			out.Clear();
+
+			for (unsigned int i = first; i < last; i++)
+				ThinkBot(world_, bots_[i], out);
+		}));
+	}
+
+	// Wait for everything before rethrowing, because the buffers are used by the tasks
+	for (unsigned int r = 0; r < done.size(); r++)
+	{
+		done[r].wait();
+	}
+
+	for (unsigned int r = 0; r < done.size(); r++)
+	{
+		done[r].get();
+	}
+
+	// The ranges are in the order of the bots
+	spawned_ = 0;
+
+	for (unsigned int r = 0; r < ranges; r++)
+	{
+		Apply(outputs_[r]);
+	}
+
+	// The answers are used on the next tic
+	sight_.Resolve();
+}
+
+void BotScheduler::Apply(const BotOutput& out)
+{
+	for (unsigned int i = 0; i < out.commands.size(); i++)
+	{
+		const BotCommand& command = out.commands[i];
+		Player* p = level_.players[command.player];
+
+		p->Cmd.rotation = command.rotation;
+		p->Cmd.forward = command.forward;
+		p->TimeSinceLastShot = command.timeSinceLastShot;
+	}
+
+	for (unsigned int i = 0; i < out.spawns.size(); i++)
+	{
+		const BotSpawn& spawn = out.spawns[i];
+		level_.things.push_back(new Plasma(spawn.pos.x, spawn.pos.y, spawn.pos.z, spawn.mom.x, spawn.mom.y, spawn.mom.z));
+	}
+
+	spawned_ += out.spawns.size();
+	sight_.Submit(out.queries);
+}
+
+void BotScheduler::SetNavMesh(const NavMesh* nav)
+{
+	world_.nav = nav;
+}
+
+unsigned int BotScheduler::Threads() const
+{
+	return pool_.Size();
+}
+
+unsigned int BotScheduler::Spawned() const
+{
+	return spawned_;
+}
+
+unsigned int BotScheduler::Queries() const
+{
+	return sight_.Resolved();
+}
@@ -0,0 +1,64 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// botscheduler.h
+// Makes the bots think on many threads. The bots read a copy of the players that is taken
+// before they think and each range of bots writes in its own buffers. The buffers are applied
+// in the order of the bots, so the result is the same whatever the number of threads.
+
+#ifndef BOTSCHEDULER_H
+#define BOTSCHEDULER_H
+
+#include "bot.h"	/* BotWorld, BotOutput */
+#include "sight.h"	/* LineOfSight */
+#include "threadpool.h"	/* ThreadPool */
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+class Level;
+class NavMesh;
+
+class BotScheduler
+{
+public:
+	// The bots control the players at these indices. The navmesh is optional.
+	BotScheduler(Level& level, const vector<uint32_t>& bots, const NavMesh* nav, unsigned int threads = 0);
+
+	// Every bot thinks and sets the command of its player. Must be called before the tic is played.
+	void Think();
+
+	// When the level is reloaded
+	void SetNavMesh(const NavMesh* nav);
+
+	unsigned int Threads() const;
+	unsigned int Spawned() const;	// Projectiles fired by the last call to Think()
+	unsigned int Queries() const;	// Line of sight queries answered by the last call to Think()
+
+private:
+	Level& level_;
+	vector<uint32_t> bots_;
+	ThreadPool pool_;
+	LineOfSight sight_;
+	BotWorld world_;
+	vector<BotOutput> outputs_;	// One per range of bots
+	unsigned int spawned_ = 0;
+
+	void Apply(const BotOutput& out);
+};
+
+#endif	// BOTSCHEDULER_H
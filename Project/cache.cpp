@@ -24,7 +24,7 @@
 #include <string>
 using namespace std;
 
-Cache* Cache::instance_ = nullptr;
+thread_local Cache* Cache::instance_ = nullptr;
 
 Cache::Cache()
 {
@@ -42,6 +42,17 @@ bool Cache::Add(const string& name, bool enableFiltering)
 	return false;
 }
 
+void Cache::Remove(const string& key)
+{
+	auto found = store_.find(key);
+
+	if (found != store_.end())
+	{
+		delete found->second;
+		store_.erase(found);
+	}
+}
+
 Texture* Cache::Get(const string& key)
 {
 	// Will throw 'std::out_of_range' if key is not found
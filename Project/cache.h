@@ -31,13 +31,14 @@ class Cache
 private:
 	map<string, Texture*> store_;
 
-	static Cache* instance_;
+	static thread_local Cache* instance_;	// Each thread that loads levels has its own cache
 
 	Cache();
 	~Cache();	// Prevent unwanted destruction
 
 public:
 	bool Add(const string& key, bool enableFiltering);
+	void Remove(const string& key);
 
 	Texture* Get(const string& key);
 
@@ -0,0 +1,863 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// demo.cpp
+// Reads and writes demos. A container starts with a header, then has records: the tics in
+// blocks and the keyframes before the tics that follow them. The index of the keyframes is
+// the last record and the file ends with its offset, so it's found without reading the rest.
+// The tics of a block are compressed. Each field is written as its difference with the
+// previous tic, so the fields that don't change become runs of zeros.
+
+#include "demo.h"
+#include "events.h"	/* BYTES_TO_READ, writeCmdToDemo, writeTicToDemo, writeChecksumToDemo */
+#include "player.h"
+#include "packet.h"	/* WriteVarint, ReadVarint, WritePacked, ReadPacked */
+#include "lz.h"	/* LzCompress, LzDecompress */
+#include "log.h"	/* Log, LogError */
+
+#include <string>
+#include <vector>
+#include <algorithm>	/* equal, upper_bound, max */
+#include <cstring>	/* memchr, memcpy */
+#include <cstddef>	/* ptrdiff_t */
+#include <stdexcept>
+using namespace std;
+
+const char DEMO_MAGIC[4] = {'M', 'G', 'D', 'M'};
+const char DEMO_INDEX_MAGIC[4] = {'M', 'G', 'D', 'X'};
+const unsigned char DEMO_FORMAT = 2;	// The first format had no compression
+
+enum DemoRecord: unsigned char
+{
+	DEMO_KEYFRAME = 'K',	// Tic and the state of the game before it
+	DEMO_TICS = 'T',	// First tic, number of tics, then the commands and the checksum of each tic
+	DEMO_COMPRESSED_TICS = 'C',	// First tic, number of tics, codec, then the columns of the tics
+	DEMO_INDEX = 'X'	// Number of tics and the tic and offset of each keyframe
+};
+
+// How the columns of a block are compressed after their zeros are packed
+enum DemoCodec: unsigned char
+{
+	DEMO_CODEC_NONE,
+	DEMO_CODEC_LZ	// Size of the packed columns, then an LZ4 block
+};
+
+// How a field of the tics is written. Each field is a column with a value for each tic,
+// and the bytes of the same rank are written together.
+enum DemoColumnType: unsigned char
+{
+	COLUMN_BYTE,	// Difference with the previous tic
+	COLUMN_FLAGS,	// Bits that changed
+	COLUMN_BE16,	// Difference of a 16-bit number that's written most significant byte first
+	COLUMN_LE16,	// Least significant byte first
+	COLUMN_HASH	// Bits of a 32-bit hash that changed
+};
+
+struct DemoColumn
+{
+	unsigned int offset;	// In a tic
+	DemoColumnType type;
+};
+
+// A block is written when it has this many tics, or before a keyframe
+const unsigned int DEMO_BLOCK_TICS = 256;
+
+// Type and size of the payload
+const size_t DEMO_RECORD_HEADER = 5;
+
+// Offset of the index and DEMO_INDEX_MAGIC
+const size_t DEMO_TRAILER_SIZE = 12;
+
+static void Put32(unsigned char* data, uint32_t value)
+{
+	for (unsigned int i = 0; i < 4; i++)
+		data[i] = value >> (i * 8);
+}
+
+static uint32_t Get32(const unsigned char* data)
+{
+	return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static void Put64(unsigned char* data, uint64_t value)
+{
+	for (unsigned int i = 0; i < 8; i++)
+		data[i] = value >> (i * 8);
+}
+
+static uint64_t Get64(const unsigned char* data)
+{
+	return Get32(data) | (uint64_t)Get32(data + 4) << 32;
+}
+
+static void WriteString(vector<unsigned char>& data, const string& str)
+{
+	WriteVarint(data, str.size());
+	data.insert(data.end(), str.begin(), str.end());
+}
+
+static string ReadString(const unsigned char*& pos, const unsigned char* end)
+{
+	uint32_t size = ReadVarint(pos, end);
+	if (size > (size_t)(end - pos))
+		throw runtime_error("The header of the demo is damaged.");
+
+	string str(reinterpret_cast<const char*>(pos), size);
+	pos += size;
+	return str;
+}
+
+// The fields of a command are the same as in WriteCommand, then the fields of the checksum
+static void GetColumns(unsigned int players, vector<DemoColumn>& columns)
+{
+	columns.clear();
+
+	for (unsigned int i = 0; i < players; i++)
+	{
+		unsigned int command = i * BYTES_TO_READ;
+		columns.push_back({command, COLUMN_FLAGS});
+		columns.push_back({command + 1, COLUMN_BYTE});	// Forward
+		columns.push_back({command + 2, COLUMN_BYTE});	// Lateral
+		columns.push_back({command + 3, COLUMN_BE16});	// Rotation
+		columns.push_back({command + 5, COLUMN_BE16});	// Vertical
+	}
+
+	unsigned int sum = players * BYTES_TO_READ;
+	columns.push_back({sum, COLUMN_LE16});	// Random
+	columns.push_back({sum + 2, COLUMN_HASH});	// Players
+	columns.push_back({sum + 6, COLUMN_HASH});	// Things
+}
+
+static unsigned int ColumnWidth(DemoColumnType type)
+{
+	if (type == COLUMN_HASH)
+		return 4;
+	if (type == COLUMN_BE16 || type == COLUMN_LE16)
+		return 2;
+
+	return 1;
+}
+
+static uint32_t GetColumn(const unsigned char* tic, DemoColumnType type)
+{
+	if (type == COLUMN_BE16)
+		return tic[0] << 8 | tic[1];
+	if (type == COLUMN_LE16)
+		return tic[0] | tic[1] << 8;
+	if (type == COLUMN_HASH)
+		return Get32(tic);
+
+	return tic[0];
+}
+
+static void SetColumn(unsigned char* tic, DemoColumnType type, uint32_t value)
+{
+	if (type == COLUMN_BE16)
+	{
+		tic[0] = value >> 8;
+		tic[1] = value;
+	}
+	else if (type == COLUMN_LE16)
+	{
+		tic[0] = value;
+		tic[1] = value >> 8;
+	}
+	else if (type == COLUMN_HASH)
+	{
+		Put32(tic, value);
+	}
+	else
+	{
+		tic[0] = value;
+	}
+}
+
+// Small differences have small values, whatever their sign
+static uint32_t Difference(DemoColumnType type, uint32_t value, uint32_t previous)
+{
+	if (type == COLUMN_FLAGS || type == COLUMN_HASH)
+		return value ^ previous;
+
+	int32_t difference = type == COLUMN_BYTE ? (int8_t)(value - previous) : (int16_t)(value - previous);
+	return ((uint32_t)difference << 1) ^ (uint32_t)(difference >> 31);
+}
+
+static uint32_t ApplyDifference(DemoColumnType type, uint32_t difference, uint32_t previous)
+{
+	if (type == COLUMN_FLAGS || type == COLUMN_HASH)
+		return difference ^ previous;
+
+	int32_t value = (int32_t)(difference >> 1) ^ -(int32_t)(difference & 1);
+	return (previous + value) & (type == COLUMN_BYTE ? 0xFF : 0xFFFF);
+}
+
+// Tics one after the other to columns. The first tic of a block is compared with zeros,
+// so each block can be read without the ones before it.
+static void SplitColumns(const vector<unsigned char>& tics, unsigned int count, const vector<DemoColumn>& columns, vector<unsigned char>& out)
+{
+	size_t ticSize = tics.size() / count;
+	size_t pos = 0;
+	out.resize(tics.size());
+
+	for (unsigned int c = 0; c < columns.size(); c++)
+	{
+		const DemoColumn& column = columns[c];
+		unsigned int width = ColumnWidth(column.type);
+		uint32_t previous = 0;
+
+		for (unsigned int t = 0; t < count; t++)
+		{
+			uint32_t value = GetColumn(&tics[t * ticSize + column.offset], column.type);
+			uint32_t difference = Difference(column.type, value, previous);
+			previous = value;
+
+			for (unsigned int b = 0; b < width; b++)
+				out[pos + b * count + t] = difference >> (b * 8);
+		}
+
+		pos += width * count;
+	}
+}
+
+static void MergeColumns(const vector<unsigned char>& in, unsigned int count, const vector<DemoColumn>& columns, vector<unsigned char>& tics)
+{
+	size_t ticSize = in.size() / count;
+	size_t pos = 0;
+	tics.resize(in.size());
+
+	for (unsigned int c = 0; c < columns.size(); c++)
+	{
+		const DemoColumn& column = columns[c];
+		unsigned int width = ColumnWidth(column.type);
+		uint32_t previous = 0;
+
+		for (unsigned int t = 0; t < count; t++)
+		{
+			uint32_t difference = 0;
+			for (unsigned int b = 0; b < width; b++)
+				difference |= (uint32_t)in[pos + b * count + t] << (b * 8);
+
+			previous = ApplyDifference(column.type, difference, previous);
+			SetColumn(&tics[t * ticSize + column.offset], column.type, previous);
+		}
+
+		pos += width * count;
+	}
+}
+
+/****************************** WRITER ******************************/
+
+DemoWriter::DemoWriter(const string& path, const DemoInfo& info)
+	: file_(path, ios::binary), info_(info)
+{
+	if (!file_.is_open())
+	{
+		throw runtime_error("Could not open file '" + path + "' to write");
+	}
+
+	container_ = path.size() > DEMO_CONTAINER_EXTENSION.size() &&
+		path.compare(path.size() - DEMO_CONTAINER_EXTENSION.size(), DEMO_CONTAINER_EXTENSION.size(), DEMO_CONTAINER_EXTENSION) == 0;
+
+	info_.checksums = true;
+
+	if (!container_)
+	{
+		info_.interval = 0;
+
+		file_ << info_.version << endl;
+		file_ << info_.level << endl;
+		file_ << info_.seed << endl;
+		file_ << info_.players << endl;
+		file_ << "checksums" << endl;
+		return;
+	}
+
+	info_.interval = max(info_.interval, 1u);
+
+	record_.push_back(DEMO_FORMAT);
+	WriteString(record_, info_.version);
+	WriteString(record_, info_.level);
+	WriteVarint(record_, info_.seed);
+	WriteVarint(record_, info_.players);
+	WriteVarint(record_, info_.interval);
+
+	unsigned char size[4];
+	Put32(size, record_.size());
+	file_.write(DEMO_MAGIC, sizeof(DEMO_MAGIC));
+	file_.write(reinterpret_cast<const char*>(size), sizeof(size));
+	file_.write(reinterpret_cast<const char*>(record_.data()), record_.size());
+}
+
+DemoWriter::~DemoWriter()
+{
+	Close();
+}
+
+bool DemoWriter::IsContainer() const
+{
+	return container_;
+}
+
+unsigned int DemoWriter::Tic() const
+{
+	return tic_;
+}
+
+bool DemoWriter::KeyframeDue() const
+{
+	return container_ && !commandsWritten_ && tic_ % info_.interval == 0 && (keyframes_.empty() || keyframes_.back().tic != tic_);
+}
+
+void DemoWriter::writeRecord(unsigned char type)
+{
+	unsigned char header[DEMO_RECORD_HEADER];
+	header[0] = type;
+	Put32(header + 1, record_.size());
+
+	file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file_.write(reinterpret_cast<const char*>(record_.data()), record_.size());
+}
+
+void DemoWriter::flushBlock()
+{
+	if (blockTics_ == 0)
+		return;
+
+	vector<DemoColumn> columns;
+	GetColumns(info_.players, columns);
+	SplitColumns(block_, blockTics_, columns, columns_);
+
+	packed_.clear();
+	WritePacked(packed_, columns_);
+
+	record_.clear();
+	WriteVarint(record_, blockTic_);
+	WriteVarint(record_, blockTics_);
+
+	size_t pos = record_.size();
+	record_.push_back(DEMO_CODEC_LZ);
+	WriteVarint(record_, packed_.size());
+	LzCompress(packed_.data(), packed_.size(), record_);
+
+	// Very short blocks don't have anything to compress
+	if (record_.size() - pos > packed_.size())
+	{
+		record_.resize(pos);
+		record_.push_back(DEMO_CODEC_NONE);
+		record_.insert(record_.end(), packed_.begin(), packed_.end());
+	}
+
+	writeRecord(DEMO_COMPRESSED_TICS);
+
+	block_.clear();
+	blockTic_ = tic_;
+	blockTics_ = 0;
+}
+
+void DemoWriter::WriteKeyframe(const GameState& state)
+{
+	if (!container_)
+		return;
+
+	// The tics before the keyframe must be in the file before it
+	flushBlock();
+
+	keyframes_.push_back({tic_, (uint64_t)file_.tellp()});
+
+	record_.clear();
+	WriteVarint(record_, tic_);
+	WritePacked(record_, state.Data());
+	writeRecord(DEMO_KEYFRAME);
+}
+
+void DemoWriter::WriteTic(const vector<Player*>& players)
+{
+	if (!container_)
+	{
+		writeCmdToDemo(file_, players);
+		return;
+	}
+
+	for (unsigned int i = 0; i < players.size(); i++)
+	{
+		vector<unsigned char> command = players[i]->CmdToNet();
+		command.resize(max<size_t>(command.size(), BYTES_TO_READ));
+		block_.insert(block_.end(), command.begin(), command.begin() + BYTES_TO_READ);
+	}
+
+	commandsWritten_ = true;
+}
+
+void DemoWriter::WriteTic(const vector<vector<unsigned char>>& commands)
+{
+	if (!container_)
+	{
+		writeTicToDemo(file_, commands);
+		return;
+	}
+
+	for (unsigned int i = 0; i < commands.size(); i++)
+	{
+		size_t size = min<size_t>(commands[i].size(), BYTES_TO_READ);
+		block_.insert(block_.end(), commands[i].begin(), commands[i].begin() + size);
+		block_.resize(block_.size() + BYTES_TO_READ - size);
+	}
+
+	commandsWritten_ = true;
+}
+
+void DemoWriter::WriteChecksum(const Checksum& sum)
+{
+	tic_++;
+
+	if (!container_)
+	{
+		writeChecksumToDemo(file_, sum);
+		return;
+	}
+
+	size_t pos = block_.size();
+	block_.resize(pos + Checksum::SIZE);
+	sum.Write(&block_[pos]);
+
+	commandsWritten_ = false;
+	blockTics_++;
+
+	if (blockTics_ == DEMO_BLOCK_TICS)
+		flushBlock();
+}
+
+void DemoWriter::Close()
+{
+	if (!file_.is_open())
+		return;
+
+	if (container_)
+	{
+		// A tic that has no checksum was not played
+		if (commandsWritten_)
+			block_.resize(block_.size() - info_.players * BYTES_TO_READ);
+
+		flushBlock();
+
+		uint64_t offset = file_.tellp();
+
+		record_.clear();
+		WriteVarint(record_, tic_);
+		WriteVarint(record_, keyframes_.size());
+
+		for (unsigned int i = 0; i < keyframes_.size(); i++)
+		{
+			WriteVarint(record_, keyframes_[i].tic);
+			record_.resize(record_.size() + 8);
+			Put64(&record_[record_.size() - 8], keyframes_[i].offset);
+		}
+
+		writeRecord(DEMO_INDEX);
+
+		unsigned char trailer[DEMO_TRAILER_SIZE];
+		Put64(trailer, offset);
+		copy(DEMO_INDEX_MAGIC, DEMO_INDEX_MAGIC + sizeof(DEMO_INDEX_MAGIC), trailer + 8);
+		file_.write(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+	}
+
+	file_.close();
+}
+
+/****************************** READER ******************************/
+
+DemoReader::DemoReader(const string& path)
+{
+	if (!file_.Open(path))
+	{
+		throw runtime_error("Could not open demo '" + path + "'");
+	}
+
+	// Demos are read from start to end
+	file_.Sequential();
+
+	pos_ = file_.Data();
+	end_ = file_.Data() + file_.Size();
+
+	container_ = file_.Size() >= sizeof(DEMO_MAGIC) && equal(pos_, pos_ + sizeof(DEMO_MAGIC), DEMO_MAGIC);
+
+	if (container_)
+	{
+		pos_ += sizeof(DEMO_MAGIC);
+		readHeader();
+
+		if (info_.players == 0)
+		{
+			throw runtime_error("Demo '" + path + "' has no players.");
+		}
+
+		commandsSize_ = info_.players * BYTES_TO_READ;
+		readIndex();
+		return;
+	}
+
+	// Old format: version, level, seed and number of players
+	info_.version = readLine();
+	info_.level = readLine();
+	string line = readLine();
+	info_.seed = stoi(line);
+	line = readLine();
+	info_.players = stoi(line);
+
+	// Newer demos have a checksum after each tic
+	if (pos_ < end_ && *pos_ == 'c')
+	{
+		info_.checksums = readLine() == "checksums";
+	}
+
+	if (info_.players == 0)
+	{
+		throw runtime_error("Demo '" + path + "' has no players.");
+	}
+
+	start_ = pos_;
+	commandsSize_ = info_.players * BYTES_TO_READ;
+	tics_ = (end_ - start_) / (commandsSize_ + (info_.checksums ? Checksum::SIZE : 0));
+}
+
+string DemoReader::readLine()
+{
+	const unsigned char* eol = static_cast<const unsigned char*>(memchr(pos_, '\n', end_ - pos_));
+	if (!eol)
+		eol = end_;
+
+	string line(reinterpret_cast<const char*>(pos_), eol - pos_);
+	pos_ = eol < end_ ? eol + 1 : end_;
+	return line;
+}
+
+void DemoReader::readHeader()
+{
+	if (end_ - pos_ < 4 || (size_t)(end_ - pos_ - 4) < Get32(pos_) || Get32(pos_) == 0)
+	{
+		throw runtime_error("The header of the demo is damaged.");
+	}
+
+	const unsigned char* pos = pos_ + 4;
+	const unsigned char* end = pos + Get32(pos_);
+
+	if (*pos > DEMO_FORMAT)
+	{
+		throw runtime_error("The demo is in a newer format (" + to_string(*pos) + ").");
+	}
+
+	pos++;
+	info_.version = ReadString(pos, end);
+	info_.level = ReadString(pos, end);
+	info_.seed = ReadVarint(pos, end);
+	info_.players = ReadVarint(pos, end);
+	info_.interval = ReadVarint(pos, end);
+	info_.checksums = true;
+
+	start_ = pos_ = end;
+}
+
+// 'pos' is moved after the record. Returns false if there's no complete record.
+bool DemoReader::readRecord(const unsigned char*& pos, unsigned char& type, const unsigned char*& payload, uint32_t& size) const
+{
+	if ((size_t)(end_ - pos) < DEMO_RECORD_HEADER)
+		return false;
+
+	type = pos[0];
+	size = Get32(pos + 1);
+
+	if ((size_t)(end_ - pos) - DEMO_RECORD_HEADER < size)
+		return false;
+
+	payload = pos + DEMO_RECORD_HEADER;
+	pos = payload + size;
+	return true;
+}
+
+void DemoReader::readIndex()
+{
+	const unsigned char* trailer = end_ - DEMO_TRAILER_SIZE;
+	const unsigned char* index = nullptr;
+	unsigned char type = 0;
+	uint32_t size = 0;
+
+	if (end_ - start_ >= (ptrdiff_t)DEMO_TRAILER_SIZE && equal(trailer + 8, end_, DEMO_INDEX_MAGIC) &&
+		Get64(trailer) < (uint64_t)(trailer - file_.Data()))
+	{
+		const unsigned char* pos = file_.Data() + Get64(trailer);
+		if (!readRecord(pos, type, index, size) || type != DEMO_INDEX)
+			index = nullptr;
+	}
+
+	if (index)
+	{
+		const unsigned char* pos = index;
+		const unsigned char* end = index + size;
+
+		tics_ = ReadVarint(pos, end);
+		keyframes_.resize(ReadVarint(pos, end));
+
+		for (unsigned int i = 0; i < keyframes_.size(); i++)
+		{
+			keyframes_[i].tic = ReadVarint(pos, end);
+
+			if (end - pos < 8 || Get64(pos) >= file_.Size())
+				throw runtime_error("The index of the demo is damaged.");
+
+			keyframes_[i].offset = Get64(pos);
+			pos += 8;
+		}
+	}
+	else
+	{
+		// The game did not end properly. Everything that was written is still there.
+		Log() << "The demo has no index. It was not closed properly." << endl;
+		scanRecords();
+	}
+}
+
+void DemoReader::scanRecords()
+{
+	const unsigned char* pos = start_;
+	const unsigned char* record = pos;
+	const unsigned char* payload;
+	unsigned char type;
+	uint32_t size;
+
+	for (; readRecord(pos, type, payload, size); record = pos)
+	{
+		const unsigned char* end = payload + size;
+
+		if (type == DEMO_KEYFRAME)
+		{
+			keyframes_.push_back({ReadVarint(payload, end), (uint64_t)(record - file_.Data())});
+		}
+		else if (type == DEMO_TICS || type == DEMO_COMPRESSED_TICS)
+		{
+			uint32_t first = ReadVarint(payload, end);
+			uint32_t count = ReadVarint(payload, end);
+
+			if (type == DEMO_TICS && (size_t)(end - payload) != count * (commandsSize_ + Checksum::SIZE))
+				break;
+
+			tics_ = first + count;
+		}
+	}
+}
+
+const DemoInfo& DemoReader::Info() const
+{
+	return info_;
+}
+
+bool DemoReader::IsContainer() const
+{
+	return container_;
+}
+
+unsigned int DemoReader::Tic() const
+{
+	return tic_;
+}
+
+unsigned int DemoReader::Tics() const
+{
+	return tics_;
+}
+
+unsigned int DemoReader::Keyframes() const
+{
+	return keyframes_.size();
+}
+
+bool DemoReader::nextBlock()
+{
+	const unsigned char* payload;
+	unsigned char type;
+	uint32_t size;
+	size_t ticSize = commandsSize_ + Checksum::SIZE;
+
+	while (readRecord(pos_, type, payload, size))
+	{
+		// Keyframes are only read when seeking. The index is the end of the demo.
+		if (type == DEMO_INDEX)
+			return false;
+
+		if (type != DEMO_TICS && type != DEMO_COMPRESSED_TICS)
+			continue;
+
+		const unsigned char* pos = payload;
+		const unsigned char* end = payload + size;
+		tic_ = ReadVarint(pos, end);
+		blockTics_ = ReadVarint(pos, end);
+		block_ = pos;
+
+		if (type == DEMO_COMPRESSED_TICS && blockTics_ > 0)
+		{
+			unsigned char codec = pos < end ? *pos++ : 0xFF;
+
+			if (codec == DEMO_CODEC_LZ)
+			{
+				uint32_t packed = ReadVarint(pos, end);
+				LzDecompress(pos, end - pos, packed_, packed);
+				pos = packed_.data();
+				end = packed_.data() + packed_.size();
+			}
+			else if (codec != DEMO_CODEC_NONE)
+			{
+				throw runtime_error("The demo uses an unknown codec (" + to_string(codec) + ").");
+			}
+
+			ReadPacked(pos, end, columns_);
+
+			if (columns_.size() != blockTics_ * ticSize)
+			{
+				throw runtime_error("The demo is damaged at tic " + to_string(tic_) + ".");
+			}
+
+			vector<DemoColumn> columns;
+			GetColumns(info_.players, columns);
+			MergeColumns(columns_, blockTics_, columns, decoded_);
+			block_ = decoded_.data();
+		}
+		else if ((size_t)(end - pos) != blockTics_ * ticSize)
+		{
+			throw runtime_error("The demo is damaged at tic " + to_string(tic_) + ".");
+		}
+
+		if (blockTics_ > 0)
+			return true;
+	}
+
+	return false;
+}
+
+const unsigned char* DemoReader::nextCommands()
+{
+	const unsigned char* commands;
+
+	if (container_)
+	{
+		if (blockTics_ == 0 && !nextBlock())
+			return nullptr;
+
+		commands = block_;
+		block_ += commandsSize_ + Checksum::SIZE;
+		blockTics_--;
+
+		checksum_.Read(commands + commandsSize_);
+		hasChecksum_ = true;
+	}
+	else
+	{
+		size_t ticSize = commandsSize_ + (info_.checksums ? Checksum::SIZE : 0);
+
+		if ((size_t)(end_ - pos_) < ticSize)
+		{
+			if (pos_ < end_)
+				LogError() << "WARNING: demo ended prematurely" << endl;
+
+			pos_ = end_;
+			return nullptr;
+		}
+
+		commands = pos_;
+		pos_ += ticSize;
+
+		if (info_.checksums)
+		{
+			checksum_.Read(commands + commandsSize_);
+			hasChecksum_ = true;
+		}
+	}
+
+	tic_++;
+	return commands;
+}
+
+bool DemoReader::ReadTic(const vector<Player*>& players)
+{
+	const unsigned char* commands = nextCommands();
+	if (!commands)
+		return false;
+
+	for (unsigned int i = 0; i < players.size() && i < info_.players; i++)
+	{
+		memcpy(command_, commands + i * BYTES_TO_READ, BYTES_TO_READ);
+		players[i]->Cmd.Deserialize(command_, sizeof(command_));
+	}
+
+	return true;
+}
+
+bool DemoReader::ReadTic(vector<vector<unsigned char>>& commands)
+{
+	const unsigned char* found = nextCommands();
+	if (!found)
+		return false;
+
+	commands.resize(info_.players);
+
+	for (unsigned int i = 0; i < commands.size(); i++)
+	{
+		commands[i].assign(found + i * BYTES_TO_READ, found + (i + 1) * BYTES_TO_READ);
+	}
+
+	return true;
+}
+
+bool DemoReader::ReadChecksum(Checksum& sum)
+{
+	if (!hasChecksum_)
+		return false;
+
+	sum = checksum_;
+	hasChecksum_ = false;
+	return true;
+}
+
+unsigned int DemoReader::Seek(unsigned int tic, Level& lvl)
+{
+	auto found = upper_bound(keyframes_.begin(), keyframes_.end(), tic,
+		[](unsigned int t, const KeyframeEntry& entry) { return t < entry.tic; });
+
+	if (found == keyframes_.begin())
+		return tic_;
+
+	const KeyframeEntry& keyframe = *(found - 1);
+
+	const unsigned char* pos = file_.Data() + keyframe.offset;
+	const unsigned char* payload;
+	unsigned char type;
+	uint32_t size;
+
+	if (!readRecord(pos, type, payload, size) || type != DEMO_KEYFRAME)
+	{
+		throw runtime_error("The keyframe at tic " + to_string(keyframe.tic) + " is damaged.");
+	}
+
+	const unsigned char* end = payload + size;
+	tic_ = ReadVarint(payload, end);
+
+	ReadPacked(payload, end, keyframe_);
+	state_.Load(keyframe_);
+	state_.Restore(lvl);
+
+	// The block after the keyframe starts at its tic
+	pos_ = pos;
+	blockTics_ = 0;
+	hasChecksum_ = false;
+	return tic_;
+}
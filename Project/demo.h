@@ -0,0 +1,168 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// demo.h
+// Reads and writes demos. The old format is a text header followed by the commands of each tic.
+// The container format (.mgd) also has a copy of the game state (a keyframe) every few seconds
+// and an index of the keyframes at its end, so playback can start at any tic without playing
+// every tic before it.
+
+#ifndef DEMO_H
+#define DEMO_H
+
+#include "gamestate.h"	/* GameState, Checksum */
+#include "mapfile.h"	/* MappedFile */
+#include "ticcmd.h"	/* Ticcmd::HEADER_SIZE */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+using namespace std;
+
+class Level;
+class Player;
+
+// Demos whose name ends with this are written in the container format
+const string DEMO_CONTAINER_EXTENSION = ".mgd";
+
+struct DemoInfo
+{
+	string version;
+	string level;
+	unsigned short seed = 0;
+	unsigned int players = 0;
+	bool checksums = false;	// The checksum of the game after each tic
+	unsigned int interval = 0;	// Tics between keyframes. 0 if there are none.
+};
+
+class DemoWriter
+{
+public:
+	// Tics are written one after the other, starting at the first tic of the game
+	DemoWriter(const string& path, const DemoInfo& info);
+	~DemoWriter();
+
+	DemoWriter(const DemoWriter&) = delete;
+	DemoWriter& operator=(const DemoWriter&) = delete;
+
+	bool IsContainer() const;
+	unsigned int Tic() const;	// Of the next tic that's written
+
+	// A keyframe is the state of the game before the next tic. Only the container format has them.
+	bool KeyframeDue() const;
+	void WriteKeyframe(const GameState& state);
+
+	void WriteTic(const vector<Player*>& players);
+	void WriteTic(const vector<vector<unsigned char>>& commands);	// From the network
+	void WriteChecksum(const Checksum& sum);	// After the tic that was written
+
+	// Writes the index of the keyframes
+	void Close();
+
+private:
+	struct KeyframeEntry
+	{
+		uint32_t tic;
+		uint64_t offset;	// Of its record in the file
+	};
+
+	ofstream file_;
+	DemoInfo info_;
+	bool container_;
+	unsigned int tic_ = 0;
+
+	// Tics that are not written yet. A tic is complete once its checksum is there.
+	vector<unsigned char> block_;
+	unsigned int blockTic_ = 0;	// First tic of the block
+	unsigned int blockTics_ = 0;
+	bool commandsWritten_ = false;	// The checksum of the last tic is missing
+
+	vector<KeyframeEntry> keyframes_;
+	vector<unsigned char> record_;	// Reused
+	vector<unsigned char> columns_;
+	vector<unsigned char> packed_;
+
+	void writeRecord(unsigned char type);
+	void flushBlock();
+};
+
+// The demo is mapped in memory and read from start to end. Nothing is allocated while the tics are read.
+class DemoReader
+{
+public:
+	explicit DemoReader(const string& path);
+
+	DemoReader(const DemoReader&) = delete;
+	DemoReader& operator=(const DemoReader&) = delete;
+
+	const DemoInfo& Info() const;
+	bool IsContainer() const;
+	unsigned int Tic() const;	// Of the next tic that's read
+	unsigned int Tics() const;	// Number of tics in the demo. 0 if it's not known.
+	unsigned int Keyframes() const;
+
+	// Returns false at the end of the demo. The commands are the first BYTES_TO_READ bytes of each player's command.
+	bool ReadTic(const vector<Player*>& players);
+	bool ReadTic(vector<vector<unsigned char>>& commands);
+
+	// Of the tic that was just read. Returns false if the demo has no checksums.
+	bool ReadChecksum(Checksum& sum);
+
+	// Restore the last keyframe at or before 'tic' and return its tic. The tics after it are read next,
+	// so the ones before 'tic' must be played. Demos without keyframes are not changed.
+	unsigned int Seek(unsigned int tic, Level& lvl);
+
+private:
+	struct KeyframeEntry
+	{
+		uint32_t tic;
+		uint64_t offset;
+	};
+
+	MappedFile file_;
+	const unsigned char* start_ = nullptr;	// First tic or record
+	const unsigned char* pos_ = nullptr;	// Next byte that's read
+	const unsigned char* end_ = nullptr;
+	DemoInfo info_;
+	bool container_ = false;
+	unsigned int tic_ = 0;
+	unsigned int tics_ = 0;
+	size_t commandsSize_ = 0;	// Of every player in a tic
+
+	bool hasChecksum_ = false;
+	Checksum checksum_;	// Of the last tic
+	unsigned char command_[Ticcmd::HEADER_SIZE] = {};	// The size of the chat string is always 0
+
+	// Container format. Tics are read from the file, or from the memory of the block that was decompressed.
+	vector<KeyframeEntry> keyframes_;
+	const unsigned char* block_ = nullptr;	// Next tic of the current block
+	unsigned int blockTics_ = 0;	// Tics left in the block
+	vector<unsigned char> decoded_;	// Their memory is reused by each block
+	vector<unsigned char> columns_;
+	vector<unsigned char> packed_;
+	vector<unsigned char> keyframe_;
+	GameState state_;
+
+	string readLine();
+	void readHeader();
+	void readIndex();
+	void scanRecords();	// Finds the keyframes of a demo that has no index
+	bool readRecord(const unsigned char*& pos, unsigned char& type, const unsigned char*& payload, uint32_t& size) const;
+	bool nextBlock();
+	const unsigned char* nextCommands();	// Null at the end of the demo
+};
+
+#endif	// DEMO_H
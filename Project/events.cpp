@@ -48,29 +48,28 @@ void writeCmdToDemo(ofstream& demo, const vector<Player*>& players)
 	}
 }
 
-// Read a tic from the demo and updates each player
-// Returns false if demo must be ended
-bool readCmdFromDemo(ifstream& demo, vector<Player*> players)
+// Write a tic that was received from the network in the demo file
+void writeTicToDemo(ofstream& demo, const vector<vector<unsigned char>>& commands)
 {
-	vector<unsigned char> command;
-	command.resize(8, 0);	// '8' because the chat string size is '0'
-
-	// Demo Play is True
-	for (unsigned int i = 0; i < players.size(); i++)
+	for (unsigned int i = 0; i < commands.size(); i++)
 	{
-		// Read 7 bytes (BYTES_TO_READ) from the demo file and write them to the command vector
-		demo.read(reinterpret_cast<char*>(command.data()), BYTES_TO_READ);
-
-		if (!demo)
+		if (commands[i].size() >= BYTES_TO_READ)
 		{
-			cerr << "WARNING: demo ended prematurely" << endl;
-			return false;
+			// Same as a player's command, without the chat string
+			demo.write(reinterpret_cast<const char*>(commands[i].data()), BYTES_TO_READ);
+		}
+		else
+		{
+			cerr << string(__FUNCTION__) << ": Tried to read more bytes than the command size." << endl;
 		}
-
-		players[i]->NetToCmd(command);
 	}
+}
 
-	return true;
+void writeChecksumToDemo(ofstream& demo, const Checksum& sum)
+{
+	unsigned char data[Checksum::SIZE];
+	sum.Write(data);
+	demo.write(reinterpret_cast<char*>(data), sizeof(data));
 }
 
 // Takes keyboard and mouse events and applies them to the player
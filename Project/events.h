@@ -18,6 +18,7 @@
 
 #include "viewdraw.h"
 #include "player.h"
+#include "gamestate.h"	/* Checksum */
 
 #include <GLFW/glfw3.h>
 
@@ -30,8 +31,11 @@ const unsigned int BYTES_TO_READ = 7;
 // Write each player's tic in the demo file
 void writeCmdToDemo(ofstream& demo, const vector<Player*>& players);
 
-// Read a tic from the demo and updates each player
-bool readCmdFromDemo(ifstream& demo, vector<Player*> players);
+// Write a tic that was received from the network in the demo file
+void writeTicToDemo(ofstream& demo, const vector<vector<unsigned char>>& commands);
+
+// Checksum of the game after a tic. Only in demos that have a "checksums" line in their header.
+void writeChecksumToDemo(ofstream& demo, const Checksum& sum);
 
 // Takes keyboard and mouse events and applies them to the player
 void updatePlayerWithEvents(GLFWwindow* window, GameWindow& view, unsigned int TicCount, Player* play);
@@ -0,0 +1,377 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// gamestate.cpp
+// Copy of everything that changes while the game is played, so it can be put back later,
+// and checksums of it to find desyncs
+
+#include "gamestate.h"
+#include "level.h"
+#include "actor.h"
+#include "player.h"
+#include "random.h"	/* GetIndex, SetIndex */
+
+#include <vector>
+#include <string>
+#include <cstring>	/* memcpy */
+#include <cstdint>
+#include <stdexcept>
+using namespace std;
+
+const size_t Checksum::SIZE;
+
+// Type of each thing in the saved list
+enum StateThing: unsigned char
+{
+	STATE_PLAYER,
+	STATE_WEAPON,
+	STATE_PUFF,
+	STATE_BLOOD,
+	STATE_PLASMA
+};
+
+// Fields are copied as they are in memory, so a state can only be used by the same build on the same kind of computer
+template<class T> static void Write(vector<unsigned char>& data, const T& value)
+{
+	size_t pos = data.size();
+	data.resize(pos + sizeof(T));
+	memcpy(&data[pos], &value, sizeof(T));
+}
+
+template<class T> static void Read(const vector<unsigned char>& data, size_t& pos, T& value)
+{
+	if (data.size() - pos < sizeof(T))
+		throw runtime_error("Saved game state is incomplete.");
+
+	memcpy(&value, &data[pos], sizeof(T));
+	pos += sizeof(T);
+}
+
+// Find the position of an object in a list
+template<class T> static uint32_t IndexOf(const vector<T*>& list, const T* object)
+{
+	for (unsigned int i = 0; i < list.size(); i++)
+	{
+		if (list[i] == object)
+			return i;
+	}
+
+	throw runtime_error("Cannot save a thing that is not part of the level.");
+}
+
+void GameState::Save(const Level& lvl)
+{
+	data_.clear();
+
+	Write(data_, GetIndex());
+
+	Write(data_, (uint32_t)lvl.players.size());
+	for (unsigned int i = 0; i < lvl.players.size(); i++)
+	{
+		const Player* p = lvl.players[i];
+		Write(data_, p->pos_);
+		Write(data_, p->mom_);
+		Write(data_, p->Angle);
+		Write(data_, p->VerticalAim);
+		Write(data_, p->MoX);
+		Write(data_, p->MoY);
+		Write(data_, p->MoZ);
+		Write(data_, p->AirTime);
+		Write(data_, p->ShouldFire);
+		Write(data_, p->TimeSinceLastShot);
+		Write(data_, p->OwnedWeapons);
+		Write(data_, p->Ammo);
+		Write(data_, p->Shells);
+		Write(data_, p->Rockets);
+		Write(data_, p->Cells);
+	}
+
+	Write(data_, (uint32_t)lvl.weapons.size());
+	for (unsigned int i = 0; i < lvl.weapons.size(); i++)
+	{
+		Write(data_, lvl.weapons[i]->pos_);
+	}
+
+	Write(data_, (uint32_t)lvl.things.size());
+	for (unsigned int i = 0; i < lvl.things.size(); i++)
+	{
+		const Actor* thing = lvl.things[i];
+
+		if (const Player* player = dynamic_cast<const Player*>(thing))
+		{
+			Write(data_, STATE_PLAYER);
+			Write(data_, IndexOf(lvl.players, player));
+		}
+		else if (const Weapon* weapon = dynamic_cast<const Weapon*>(thing))
+		{
+			Write(data_, STATE_WEAPON);
+			Write(data_, IndexOf(lvl.weapons, weapon));
+		}
+		else if (const Puff* puff = dynamic_cast<const Puff*>(thing))
+		{
+			Write(data_, STATE_PUFF);
+			Write(data_, puff->pos_);
+			Write(data_, puff->Age_);
+		}
+		else if (const Blood* blood = dynamic_cast<const Blood*>(thing))
+		{
+			Write(data_, STATE_BLOOD);
+			Write(data_, blood->pos_);
+			Write(data_, blood->GroundZ_);
+			Write(data_, blood->Age_);
+			Write(data_, blood->MomZ_);
+		}
+		else if (const Plasma* plasma = dynamic_cast<const Plasma*>(thing))
+		{
+			Write(data_, STATE_PLASMA);
+			Write(data_, plasma->pos_);
+			Write(data_, plasma->mom_);
+			Write(data_, plasma->Age_);
+		}
+		else
+		{
+			throw runtime_error("Cannot save an unknown type of thing.");
+		}
+	}
+}
+
+void GameState::Restore(Level& lvl) const
+{
+	size_t pos = 0;
+	unsigned short index;
+	uint32_t count;
+
+	Read(data_, pos, index);
+	SetIndex(index);
+
+	Read(data_, pos, count);
+	if (count != lvl.players.size())
+		throw runtime_error("Saved game state has a different number of players.");
+
+	for (unsigned int i = 0; i < lvl.players.size(); i++)
+	{
+		Player* p = lvl.players[i];
+		Read(data_, pos, p->pos_);
+		Read(data_, pos, p->mom_);
+		Read(data_, pos, p->Angle);
+		Read(data_, pos, p->VerticalAim);
+		Read(data_, pos, p->MoX);
+		Read(data_, pos, p->MoY);
+		Read(data_, pos, p->MoZ);
+		Read(data_, pos, p->AirTime);
+		Read(data_, pos, p->ShouldFire);
+		Read(data_, pos, p->TimeSinceLastShot);
+		Read(data_, pos, p->OwnedWeapons);
+		Read(data_, pos, p->Ammo);
+		Read(data_, pos, p->Shells);
+		Read(data_, pos, p->Rockets);
+		Read(data_, pos, p->Cells);
+	}
+
+	Read(data_, pos, count);
+	if (count != lvl.weapons.size())
+		throw runtime_error("Saved game state has a different number of weapons.");
+
+	for (unsigned int i = 0; i < lvl.weapons.size(); i++)
+	{
+		Read(data_, pos, lvl.weapons[i]->pos_);
+	}
+
+	// Effects are created again. Players and weapons are put back in the list.
+	for (unsigned int i = 0; i < lvl.things.size(); i++)
+	{
+		if (!dynamic_cast<Player*>(lvl.things[i]) && !dynamic_cast<Weapon*>(lvl.things[i]))
+			delete lvl.things[i];
+	}
+
+	lvl.things.clear();
+
+	Read(data_, pos, count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		StateThing type;
+		uint32_t which;
+		Float3 position;
+		Read(data_, pos, type);
+
+		if (type == STATE_PLAYER || type == STATE_WEAPON)
+		{
+			Read(data_, pos, which);
+
+			if (type == STATE_PLAYER && which < lvl.players.size())
+				lvl.things.push_back(lvl.players[which]);
+			else if (type == STATE_WEAPON && which < lvl.weapons.size())
+				lvl.things.push_back(lvl.weapons[which]);
+			else
+				throw runtime_error("Saved game state is corrupted.");
+		}
+		else if (type == STATE_PUFF)
+		{
+			Read(data_, pos, position);
+			Puff* puff = new Puff(position.x, position.y, position.z);
+			lvl.things.push_back(puff);
+			Read(data_, pos, puff->Age_);
+		}
+		else if (type == STATE_BLOOD)
+		{
+			float groundz;
+			Read(data_, pos, position);
+			Read(data_, pos, groundz);
+			Blood* blood = new Blood(position.x, position.y, position.z, groundz);
+			lvl.things.push_back(blood);
+			Read(data_, pos, blood->Age_);
+			Read(data_, pos, blood->MomZ_);
+		}
+		else if (type == STATE_PLASMA)
+		{
+			Float3 momentum;
+			Read(data_, pos, position);
+			Read(data_, pos, momentum);
+			Plasma* plasma = new Plasma(position.x, position.y, position.z, momentum.x, momentum.y, momentum.z);
+			lvl.things.push_back(plasma);
+			Read(data_, pos, plasma->Age_);
+		}
+		else
+		{
+			throw runtime_error("Saved game state is corrupted.");
+		}
+	}
+}
+
+bool GameState::Empty() const
+{
+	return data_.empty();
+}
+
+size_t GameState::Size() const
+{
+	return data_.size();
+}
+
+uint64_t GameState::Hash() const
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < data_.size(); i++)
+		hash = (hash ^ data_[i]) * 1099511628211ULL;
+
+	return hash;
+}
+
+const vector<unsigned char>& GameState::Data() const
+{
+	return data_;
+}
+
+void GameState::Load(const vector<unsigned char>& data)
+{
+	data_ = data;
+}
+
+// FNV-1a on whole words. Floats are hashed by their bits, so any difference is seen.
+static uint32_t Mix(uint32_t hash, uint32_t value)
+{
+	return (hash ^ value) * 16777619u;
+}
+
+static uint32_t Mix(uint32_t hash, float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return Mix(hash, bits);
+}
+
+static uint32_t Mix(uint32_t hash, const Float3& value)
+{
+	return Mix(Mix(Mix(hash, value.x), value.y), value.z);
+}
+
+Checksum TicChecksum(const Level& lvl)
+{
+	Checksum sum;
+	sum.random = GetIndex();
+
+	uint32_t hash = 2166136261u;
+	for (unsigned int i = 0; i < lvl.players.size(); i++)
+	{
+		const Player* p = lvl.players[i];
+		hash = Mix(hash, p->pos_);
+		hash = Mix(hash, (uint32_t)(uint16_t)p->Angle);
+		hash = Mix(hash, p->VerticalAim);
+		hash = Mix(hash, (uint32_t)p->AirTime);
+	}
+	sum.players = hash;
+
+	hash = Mix(2166136261u, (uint32_t)lvl.things.size());
+	for (unsigned int i = 0; i < lvl.things.size(); i++)
+	{
+		hash = Mix(hash, lvl.things[i]->pos_);
+		hash = Mix(hash, lvl.things[i]->mom_);
+	}
+	sum.things = hash;
+
+	return sum;
+}
+
+// Same byte order everywhere, so it can be sent and saved
+void Checksum::Write(unsigned char* data) const
+{
+	data[0] = random;
+	data[1] = random >> 8;
+
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		data[2 + i] = players >> (i * 8);
+		data[6 + i] = things >> (i * 8);
+	}
+}
+
+void Checksum::Read(const unsigned char* data)
+{
+	random = data[0] | (data[1] << 8);
+	players = 0;
+	things = 0;
+
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		players |= (uint32_t)data[2 + i] << (i * 8);
+		things |= (uint32_t)data[6 + i] << (i * 8);
+	}
+}
+
+bool Checksum::operator==(const Checksum& other) const
+{
+	return random == other.random && players == other.players && things == other.things;
+}
+
+bool Checksum::operator!=(const Checksum& other) const
+{
+	return !(*this == other);
+}
+
+string Checksum::Differences(const Checksum& other) const
+{
+	string fields;
+
+	if (random != other.random)
+		fields += "random index (" + to_string(random) + " and " + to_string(other.random) + ")";
+	if (players != other.players)
+		fields += string(fields.empty() ? "" : ", ") + "players";
+	if (things != other.things)
+		fields += string(fields.empty() ? "" : ", ") + "things";
+
+	return fields;
+}
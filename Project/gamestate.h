@@ -0,0 +1,70 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// gamestate.h
+// Copy of everything that changes while the game is played, so it can be put back later,
+// and checksums of it to find desyncs
+
+#ifndef GAMESTATE_H
+#define GAMESTATE_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+class Level;
+
+// Cheap hashes of what changes in the game after a tic. Peers and demos compare them to find desyncs.
+struct Checksum
+{
+	uint16_t random = 0;	// Index of the random number generator
+	uint32_t players = 0;	// Position, angles and air time of the players
+	uint32_t things = 0;	// Number, position and momentum of the things
+
+	static const size_t SIZE = 10;	// Serialized
+
+	void Write(unsigned char* data) const;
+	void Read(const unsigned char* data);
+
+	bool operator==(const Checksum& other) const;
+	bool operator!=(const Checksum& other) const;
+	string Differences(const Checksum& other) const;	// Names of the fields that are not the same
+};
+
+Checksum TicChecksum(const Level& lvl);
+
+class GameState
+{
+private:
+	vector<unsigned char> data_;	// Its memory is reused by the next save
+
+public:
+	// Players and weapons are kept by the level, so only their fields are saved.
+	// Other things are created again when the state is restored.
+	void Save(const Level& lvl);
+	void Restore(Level& lvl) const;
+
+	bool Empty() const;
+	size_t Size() const;	// In bytes
+	uint64_t Hash() const;	// Of the saved bytes
+
+	// The saved bytes, to send the state to spectators. They must use the same kind of computer.
+	const vector<unsigned char>& Data() const;
+	void Load(const vector<unsigned char>& data);
+};
+
+#endif	// GAMESTATE_H
@@ -19,98 +19,154 @@
 #include "graph.h"
 #include "vecmath.h"
 
-#include <algorithm>
+#include <cmath>	/* llround */
 #include <vector>
 #include <stdexcept>
 using namespace std;
 
-Graph::Graph()
+Graph::Graph(float precision): scale_(1.0f / precision)
 {
-	// Empty
+	offsets_.push_back(0);
 }
 
-bool Graph::Add(Float3 node, vector<Float3> neighbors)
+size_t Graph::GridHash::operator()(const GridKey& key) const
 {
-	vector<Float3>::iterator it = find(nodes_.begin(), nodes_.end(), node);
+	// Mix the coordinates so that close points don't end up in close buckets
+	uint64_t hash = (uint64_t)key.x * 0x9E3779B97F4A7C15ULL;
+	hash ^= (uint64_t)key.y * 0xC2B2AE3D27D4EB4FULL + (hash << 6) + (hash >> 2);
+	hash ^= (uint64_t)key.z * 0x165667B19E3779F9ULL + (hash << 6) + (hash >> 2);
+	return hash ^ (hash >> 31);
+}
 
-	if (it != nodes_.end())
-	{
-		// Element found
-		unsigned int i = distance(nodes_.begin(), it);
-		vector<Float3>* n = &neighbors_[i];
-		n->insert(n->end(), neighbors.begin(), neighbors.end());
+Graph::GridKey Graph::Key(const Float3& node) const
+{
+	return {llround(node.x * (double)scale_), llround(node.y * (double)scale_), llround(node.z * (double)scale_)};
+}
 
-		return true;
-	}
+NodeId Graph::Add(const Float3& node)
+{
+	auto inserted = ids_.insert({Key(node), (NodeId)nodes_.size()});
 
-	// Element not found
-	nodes_.push_back(node);
-	neighbors_.push_back(neighbors);
+	if (inserted.second)
+	{
+		// The new node has no links yet
+		nodes_.push_back(node);
+		removed_.push_back(false);
+		offsets_.push_back(offsets_.back());
+	}
 
-	return false;
+	return inserted.first->second;
 }
 
-bool Graph::Add(Float3 node)
+NodeId Graph::Add(const Float3& node, const vector<Float3>& neighbors)
 {
-	vector<Float3>::iterator it = find(nodes_.begin(), nodes_.end(), node);
+	NodeId id = Add(node);
 
-	if (it != nodes_.end())
+	for (unsigned int i = 0; i < neighbors.size(); i++)
 	{
-		// Element found
-		return true;
+		Link(id, Add(neighbors[i]));
 	}
 
-	vector<Float3> empty;
+	return id;
+}
 
-	// Element not found
-	nodes_.push_back(node);
-	neighbors_.push_back(empty);
+void Graph::Link(NodeId from, NodeId to)
+{
+	if (from >= nodes_.size() || to >= nodes_.size())
+	{
+		throw out_of_range("Invalid node supplied to Graph::Link");
+	}
 
-	return false;
+	pending_.push_back({from, to});
+	changed_ = true;
 }
 
-vector<Float3> Graph::GetNeighbors(const Float3 node)
+// Put the new links with the others. The links of each node stay in the order they were added.
+void Graph::Compact()
 {
-	vector<Float3>::iterator it = find(nodes_.begin(), nodes_.end(), node);
+	if (!changed_)
+		return;
 
-	if (it != nodes_.end())
+	vector<uint32_t> counts(nodes_.size(), 0);
+
+	for (NodeId from = 0; from < nodes_.size(); from++)
 	{
-		// Element found
-		unsigned int i = distance(nodes_.begin(), it);
-		return neighbors_[i];
+		for (uint32_t i = offsets_[from]; i < offsets_[from + 1]; i++)
+		{
+			if (!removed_[from] && !removed_[links_[i]])
+				counts[from]++;
+		}
 	}
 
-	// Element not found
-	throw out_of_range("Node supplied to Graph::GetNeighbors not found in graph.");
-}
+	for (unsigned int i = 0; i < pending_.size(); i++)
+	{
+		if (!removed_[pending_[i].first] && !removed_[pending_[i].second])
+			counts[pending_[i].first]++;
+	}
 
-Float3 Graph::Get(const unsigned int index)
-{
-	if (index < nodes_.size())
+	// Turn the counts into offsets, then fill the links
+	vector<uint32_t> offsets(nodes_.size() + 1);
+	offsets[0] = 0;
+
+	for (NodeId n = 0; n < nodes_.size(); n++)
 	{
-		return nodes_.at(index);
+		offsets[n + 1] = offsets[n] + counts[n];
+		counts[n] = offsets[n];
 	}
 
-	// Range is wrong
-	throw out_of_range("Invalid index supplied to Graph::Get");
+	vector<NodeId> links(offsets.back());
+
+	for (NodeId from = 0; from < nodes_.size(); from++)
+	{
+		for (uint32_t i = offsets_[from]; i < offsets_[from + 1]; i++)
+		{
+			if (!removed_[from] && !removed_[links_[i]])
+				links[counts[from]++] = links_[i];
+		}
+	}
+
+	for (unsigned int i = 0; i < pending_.size(); i++)
+	{
+		NodeId from = pending_[i].first;
+
+		if (!removed_[from] && !removed_[pending_[i].second])
+			links[counts[from]++] = pending_[i].second;
+	}
+
+	offsets_.swap(offsets);
+	links_.swap(links);
+	pending_.clear();
+	changed_ = false;
 }
 
-bool Graph::Remove(const Float3 node)
+bool Graph::Remove(const Float3& node)
 {
-	vector<Float3>::iterator it = find(nodes_.begin(), nodes_.end(), node);
+	auto it = ids_.find(Key(node));
 
-	if (it != nodes_.end())
-	{
-		// Element found
-		unsigned int i = distance(nodes_.begin(), it);
-		nodes_.erase(nodes_.begin() + i);
-		neighbors_.erase(neighbors_.begin() + i);
+	if (it == ids_.end())
+		return false;
+
+	removed_[it->second] = true;
+	ids_.erase(it);
+	changed_ = true;
+	return true;
+}
+
+NodeId Graph::Find(const Float3& node) const
+{
+	auto it = ids_.find(Key(node));
+	return it != ids_.end() ? it->second : NO_NODE;
+}
 
-		return true;
+const Float3& Graph::Get(NodeId node) const
+{
+	if (node < nodes_.size())
+	{
+		return nodes_[node];
 	}
 
-	// Element not found
-	return false;
+	// Range is wrong
+	throw out_of_range("Invalid index supplied to Graph::Get");
 }
 
 unsigned int Graph::Size() const
@@ -118,8 +174,18 @@ unsigned int Graph::Size() const
 	return nodes_.size();
 }
 
-// Destructor
-Graph::~Graph()
+unsigned int Graph::NumLinks() const
 {
-	// Empty
+	return links_.size() + pending_.size();
+}
+
+void Graph::Uncompacted()
+{
+	throw logic_error("Graph::Neighbors can't be used until Graph::Compact is called");
+}
+
+void Graph::InvalidNode()
+{
+	// Range is wrong
+	throw out_of_range("Invalid index supplied to Graph::Neighbors");
 }
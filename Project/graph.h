@@ -14,38 +14,103 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 // graph.h
-// Graph of nodes with their connected neighbors
+// Graph of nodes with their connected neighbors. Nodes have integer IDs and are found
+// from their position with a hash map. Links are kept in flat arrays (CSR).
 
 #ifndef GRAPH_H
 #define GRAPH_H
 
 #include "vecmath.h"
 
-#include <algorithm>
+#include <cstdint>
+#include <cstddef>
 #include <vector>
+#include <unordered_map>
 using namespace std;
 
-class Graph
+typedef uint32_t NodeId;	// Given in the order the nodes are added
+const NodeId NO_NODE = 0xFFFFFFFF;
+
+// Elements of an array that belongs to someone else. It's invalid once the array changes.
+template<class T> class Span
 {
+public:
+	Span(const T* data, size_t size): data_(data), size_(size) {}
+
+	const T* begin() const { return data_; }
+	const T* end() const { return data_ + size_; }
+	const T& operator[](size_t index) const { return data_[index]; }
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
 private:
-	// Nodes and their neighbors
-	vector<Float3> nodes_;
-	vector<vector<Float3>> neighbors_;
+	const T* data_;
+	size_t size_;
+};
 
+class Graph
+{
 public:
-	Graph();
-	~Graph();
+	// Positions are rounded to a grid of this size. Those that round to the same point are the same node.
+	explicit Graph(float precision = 0.001f);
+
+	// Returns the node's ID. The node is only added if it's not already there.
+	NodeId Add(const Float3& node);
+	NodeId Add(const Float3& node, const vector<Float3>& neighbors);
+
+	// One-way link. Neighbors() can only be used again once Compact() is called.
+	void Link(NodeId from, NodeId to);
+	void Compact();
 
-	bool Add(Float3 node, vector<Float3> neighbors);
-	bool Add(Float3 node);
-	bool Remove(const Float3 node);
+	// The node keeps its ID, but it can't be found anymore and it loses its links once Compact() is called
+	bool Remove(const Float3& node);
+
+	NodeId Find(const Float3& node) const;	// NO_NODE if the position is not in the graph
+	const Float3& Get(NodeId node) const;
+	unsigned int Size() const;	// Including the nodes that were removed
+	unsigned int NumLinks() const;
+
+	// Throws if the links changed since the last call to Compact() or if the node doesn't exist, like NO_NODE
+	Span<NodeId> Neighbors(NodeId node) const
+	{
+		if (changed_)
+			Uncompacted();
+
+		if (node >= nodes_.size())
+			InvalidNode();
+
+		return Span<NodeId>(links_.data() + offsets_[node], offsets_[node + 1] - offsets_[node]);
+	}
+
+private:
+	struct GridKey
+	{
+		int64_t x, y, z;
+
+		bool operator==(const GridKey& other) const
+		{
+			return x == other.x && y == other.y && z == other.z;
+		}
+	};
+
+	struct GridHash
+	{
+		size_t operator()(const GridKey& key) const;
+	};
+
+	float scale_;	// One over the precision
+	vector<Float3> nodes_;
+	vector<bool> removed_;
+	unordered_map<GridKey, NodeId, GridHash> ids_;
 
-	// Returns neighbors
-	vector<Float3> GetNeighbors(const Float3 node);
-	// Returns the node at this index. Useful to cycle through nodes.
-	Float3 Get(const unsigned int index);
+	vector<uint32_t> offsets_;	// Where each node's links start in 'links_', one more than the number of nodes
+	vector<NodeId> links_;
+	vector<pair<NodeId, NodeId>> pending_;	// Links that are not in 'links_' yet
+	bool changed_ = false;
 
-	unsigned int Size() const;
+	GridKey Key(const Float3& node) const;
+	[[noreturn]] static void Uncompacted();
+	[[noreturn]] static void InvalidNode();
 };
 
 #endif	// GRAPH_H
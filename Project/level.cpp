@@ -25,17 +25,74 @@
 #include "physics.h"	/* AdjustPlayerToFloor, PlayerToPlayersCollision */
 #include "random.h"	/* Rand() */
 #include "strutils.h"
+#include "levelfile.h"	/* IsCompiledLevel, IsTiledLevel */
+#include "levelstream.h"	/* LevelStream */
+#include "threadpool.h"	/* DefaultThreadCount */
+#include "log.h"	/* Log, LogError */
 
 #include <vector>
 #include <string>
-#include <iostream>	/* cout */
 #include <fstream>	/* ifstream */
 #include <sstream>	/* istringstream */
 #include <iterator>	/* istream_iterator */
 #include <chrono>
 #include <stdexcept>
+#include <cmath>	/* floor */
+#include <algorithm>	/* sort, unique, max */
+#include <limits>	/* numeric_limits */
+#include <set>
+#include <functional>	/* hash */
+#include <sys/stat.h>	/* stat */
 using namespace std;
 
+// Hash of everything that defines a plane in a level file
+static size_t PlaneHash(const Plane* p)
+{
+	size_t hash = std::hash<const string*>()(p->Texture);	// Names are shared
+	auto mix = [&hash](float value)
+	{
+		hash ^= std::hash<float>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	};
+
+	mix(p->Impassable);
+	mix(p->TwoSided);
+	mix(p->Xscale);
+	mix(p->Yscale);
+	mix(p->Xoff);
+	mix(p->Yoff);
+	mix(p->Light);
+
+	for (unsigned int i = 0; i < p->NumVertices(); i++)
+	{
+		mix(p->Vertex(i).x);
+		mix(p->Vertex(i).y);
+		mix(p->Vertex(i).z);
+	}
+
+	return hash;
+}
+
+static bool SamePlane(const Plane* a, const Plane* b, bool compareUVs)
+{
+	if (a->Texture != b->Texture || a->Impassable != b->Impassable || a->TwoSided != b->TwoSided ||
+		a->Xscale != b->Xscale || a->Yscale != b->Yscale || a->Xoff != b->Xoff || a->Yoff != b->Yoff ||
+		a->Light != b->Light || a->NumVertices() != b->NumVertices())
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < a->NumVertices(); i++)
+	{
+		if (!(a->Vertex(i) == b->Vertex(i)))
+			return false;
+
+		if (compareUVs && (a->UV(i).x != b->UV(i).x || a->UV(i).y != b->UV(i).y))
+			return false;
+	}
+
+	return true;
+}
+
 Level::Level(const string& level, float scaling, unsigned int numOfPlayers)
 {
 	auto start = chrono::system_clock::now();
@@ -44,7 +101,7 @@ Level::Level(const string& level, float scaling, unsigned int numOfPlayers)
 	LoadLevel(level, numOfPlayers);
 	auto end = chrono::system_clock::now();
 	auto diff = chrono::duration_cast<chrono::milliseconds>(end - start).count();
-	cout << "Level loading took " << diff << "ms." << endl;
+	Log() << "Level loading took " << diff << "ms." << endl;
 }
 
 Level::~Level()
@@ -55,29 +112,124 @@ Level::~Level()
 		delete things[i];
 	}
 
-	// Delete planes
-	for (unsigned int i = 0; i < planes.size(); i++)
-	{
-		delete planes[i];
-	}
+	DeletePlanes();
 
 	// Delete the cache instance and its contents
 	Cache::Instance()->DestroyInstance();
 }
 
-void Level::Reload()
+// Modification time in nanoseconds and size of a file. Returns false if the file can't be found.
+static bool GetFileStamp(const string& path, int64_t& time, int64_t& size)
 {
-	// Delete planes from memory
-	for (unsigned int i = 0; i < planes.size(); i++)
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+
+#if defined(_WIN32)
+	time = (int64_t)info.st_mtime * 1000000000;
+#elif defined(__APPLE__)
+	time = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+	time = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+
+	size = info.st_size;
+	return true;
+}
+
+// Reload the level's geometry and spawn spots. Players and weapons are not touched.
+bool Level::Reload()
+{
+	auto start = chrono::system_clock::now();
+
+	if (stream_)
 	{
-		delete planes[i];
+		// Tiled levels are generated, so there's nothing to compare
+		DeletePlanes();
+		spawns.clear();
+		reloaded_ = true;
+		LoadLevel(levelname_, players.size());
+		reloaded_ = false;
+		return true;
 	}
 
-	// Delete planes from level
-	planes.clear();
-	// Load level
+	// Keep the current planes so the ones that did not change can be reused.
+	// The new planes go in a new arena. The old one is freed once the new planes are ready.
+	Arena oldArena;
+	oldArena.Swap(arena_);
+	PlaneMesh oldMesh;
+	swap(oldMesh, mesh_);
+	vector<Plane*> oldPlanes;
+	swap(oldPlanes, planes);
+	vector<SpawnSpot> oldSpawns;
+	swap(oldSpawns, spawns);
+	vector<SpawnSpot> oldStarts = starts_;
+	vector<pair<unsigned int, unsigned int>> oldRanges;
+	int64_t oldTime = levelTime_;
+	int64_t oldSize = levelSize_;
+
+	for (unsigned int i = 0; i < oldPlanes.size(); i++)
+	{
+		Plane* p = oldPlanes[i];
+		oldRanges.push_back({p->FirstIndex(), p->NumVertices()});
+		p->SetVertices(&oldMesh, p->FirstIndex(), p->NumVertices());
+		reloadPool_.insert({PlaneHash(p), p});
+	}
+
+	reloadMesh_ = &oldMesh;
 	reloaded_ = true;
-	LoadLevel(levelname_, players.size());
+
+	try
+	{
+		LoadLevel(levelname_, players.size());
+	}
+	catch (const exception& e)
+	{
+		// The file may be saved while it's being edited. Keep the previous version and try again on the next check.
+		LogError() << "Reload failed: " << e.what() << endl;
+		levelTime_ = oldTime;
+		levelSize_ = oldSize;
+
+		arena_.Swap(oldArena);
+		swap(mesh_, oldMesh);
+		planes = oldPlanes;
+		spawns = oldSpawns;
+		starts_ = oldStarts;
+
+		for (unsigned int i = 0; i < planes.size(); i++)
+		{
+			planes[i]->SetVertices(&mesh_, oldRanges[i].first, oldRanges[i].second);
+		}
+
+		reloadPool_.clear();
+		reloadMesh_ = nullptr;
+		reloaded_ = false;
+		BuildBlockmap();
+		return false;
+	}
+
+	// What's left was removed from the level. It's freed with the old arena.
+	unsigned int removed = reloadPool_.size();
+	unsigned int added = planes.size() - (oldPlanes.size() - removed);
+	reloadPool_.clear();
+	reloadMesh_ = nullptr;
+	reloaded_ = false;
+
+	auto end = chrono::system_clock::now();
+	Log() << "Level reloaded in " << chrono::duration_cast<chrono::milliseconds>(end - start).count() << "ms: "
+		<< added << " planes added and " << removed << " removed." << endl;
+	return true;
+}
+
+// Reload the level if its file was modified. The time of the file is only kept if the reload worked.
+bool Level::ReloadIfChanged()
+{
+	int64_t time, size;
+
+	if (!GetFileStamp(levelname_, time, size) || (time == levelTime_ && size == levelSize_))
+		return false;
+
+	return Reload();
 }
 
 // Update game entities
@@ -125,7 +277,8 @@ void Level::AddTexture(const string& name, bool enableFiltering)
 {
 	if (Cache::Instance()->Add(name, enableFiltering))
 	{
-		cout << "Added texture " << name << endl;
+		filtering_[name] = enableFiltering;
+		Log() << "Added texture " << name << endl;
 	}
 }
 
@@ -142,15 +295,47 @@ void Level::UseTexture(const string& name)
 // Detects the format and calls the right loading method
 void Level::LoadLevel(const string& LevelName, unsigned int numOfPlayers)
 {
+	// Remember when the file was changed to know when to reload it
+	GetFileStamp(LevelName, levelTime_, levelSize_);
+
+	// The old blockmap would point to planes that don't exist anymore
+	ClearBlockmap();
+	mesh_.Clear();
+	starts_.clear();
+
+	if (IsTiledLevel(LevelName))
+	{
+		// The tiles come and go as the players move
+		LoadTiled(LevelName, numOfPlayers);
+		return;
+	}
+
+	if (IsCompiledLevel(LevelName))
+	{
+		// Comes with its own blockmap
+		LoadCompiled(LevelName, numOfPlayers);
+		return;
+	}
+
 	if (EndsWith(LevelName, ".obj"))
 	{
-		LoadObj(LevelName, numOfPlayers);
+		// Big models are parsed on every core
+		const streamoff PARALLEL_SIZE = 1024 * 1024;
+		ifstream model(LevelName, ios::binary | ios::ate);
+
+		if (DefaultThreadCount() > 1 && model.is_open() && model.tellg() >= PARALLEL_SIZE)
+			LoadObjParallel(LevelName, numOfPlayers);
+		else
+			LoadObj(LevelName, numOfPlayers);
+
 		useUVs_ = true;
 	}
 	else
 	{
 		LoadNative(LevelName, numOfPlayers);
 	}
+
+	BuildBlockmap();
 }
 
 bool Level::HasUVs() const
@@ -193,21 +378,21 @@ void Level::LoadNative(const string& LevelName, unsigned int numOfPlayers)
 					}
 					else if (tokens[1] == "player")
 					{
-						play = new Player();
-						play->pos_.x = atof(tokens[2].c_str());
-						play->pos_.y = atof(tokens[3].c_str());
-						play->pos_.z = atof(tokens[4].c_str());
-						play->Angle = (short)atoi(tokens[5].c_str()) * 91.0222222222f;
-						players.push_back(play);
+						SpawnSpot start;
+						start.pos_.x = atof(tokens[2].c_str());
+						start.pos_.y = atof(tokens[3].c_str());
+						start.pos_.z = atof(tokens[4].c_str());
+						start.Angle = (short)atoi(tokens[5].c_str()) * 91.0222222222f;
+						AddStart(start);
 					}
-					else if (tokens[1] == "weapon")
+					else if (tokens[1] == "weapon" && !reloaded_)
 					{
 						weapons.push_back(new Weapon(atof(tokens[2].c_str()), atof(tokens[3].c_str()), atof(tokens[4].c_str()), tokens[5]));
 					}
 				}
 				else if (tokens[0] == "poly" && (tokens.size() == 21 || tokens.size() == 18))
 				{
-					Plane* p = new Plane();
+					Plane* p = NewPlane();
 					p->Impassable = tokens[2][0] != '0';
 					p->TwoSided = tokens[3][0] != '0';
 					p->Xscale = atof(tokens[4].c_str());
@@ -215,22 +400,24 @@ void Level::LoadNative(const string& LevelName, unsigned int numOfPlayers)
 					p->Light = atof(tokens[8].c_str());
 
 					// polygons are quads or triangles
+					unsigned int first = mesh_.Indices.size();
 					for (unsigned int i = 9; i < tokens.size(); i += 3)
 					{
 						Float3 vt;
 						vt.x = atof(tokens[i].c_str());
 						vt.y = atof(tokens[i+1].c_str());
 						vt.z = atof(tokens[i+2].c_str());
-						p->Vertices.push_back(vt);
+						mesh_.Indices.push_back(mesh_.Vertices.size());
+						mesh_.Vertices.push_back(vt);
 					}
+					p->SetVertices(&mesh_, first, mesh_.Indices.size() - first);
 
 					if (tokens[1] != "INVISIBLE")
 					{
 						AddTexture(tokens[1], blurTextures);	// Add texture to cache
-						p->Texture = tokens[1];
+						p->Texture = TextureName(tokens[1]);
 					}
 
-					p->Process();
 					planes.push_back(p);
 				}
 				else if (tokens[0] == "setting" && tokens.size() == 3)
@@ -251,30 +438,19 @@ void Level::LoadNative(const string& LevelName, unsigned int numOfPlayers)
 				}
 				else
 				{
-					cout << "Skipped line " << Count << endl;
+					Log() << "Skipped line " << Count << endl;
 				}
 			}
 		}
 
-		cout << "Read " << Count - 1 << " lines from file. " << endl;
+		Log() << "Read " << Count - 1 << " lines from file. " << endl;
 		LevelFile.close();
 
-		// Check if no player was created
-		if (players.size() == 0)
-		{
-			// Create the required number of players and spawn them
-			for (unsigned int i = 0; i < numOfPlayers; i++)
-			{
-				players.emplace_back(new Player());
-				SpawnPlayer(players[i], players);
-			}
-			// Set the player to player #1
-			play = players[0];
-		}
+		ProcessPlanes();
 
-		// Populate the array of "things"
-		things.insert(things.end(), weapons.begin(), weapons.end());
-		things.insert(things.end(), players.begin(), players.end());
+		floorSpawn_ = false;
+		SpawnPlayers(numOfPlayers);
+		AddThings();
 	}
 	else
 	{
@@ -285,7 +461,7 @@ void Level::LoadNative(const string& LevelName, unsigned int numOfPlayers)
 // Loading method for OBJ format
 void Level::LoadObj(const string& path, unsigned int numOfPlayers)
 {
-	cout << "Loading 3D model: " << path << endl;
+	Log() << "Loading 3D model: " << path << endl;
 
 	ifstream model;
 	model.open(path);
@@ -341,7 +517,7 @@ void Level::LoadObj(const string& path, unsigned int numOfPlayers)
 				else if (slices[0] == "f" && (slices.size() == 4 || slices.size() == 5))	// Defines a face
 				{
 					// Create a plane for a set of vertices
-					Plane* p = new Plane();
+					Plane* p = NewPlane();
 					p->Impassable = 1;
 					p->TwoSided = 0;
 					p->Xscale = 1;
@@ -351,162 +527,541 @@ void Level::LoadObj(const string& path, unsigned int numOfPlayers)
 					// Assign the last specified texture if the plane is not invisible
 					if (texture != "None")
 					{
-						p->Texture = texture;
+						p->Texture = TextureName(texture);
 					}
 
 					// Format: vertex, uv, normal. They are indices that points to the previous data.
+					unsigned int first = mesh_.Indices.size();
 					for (unsigned int i = 1; i < slices.size(); i++)
 					{
 						vector<string> indices = Split(slices[i], '/');
-
-						if (indices.size() >= 1)
-						{
-							vertices_.push_back(temp_vertices[atoi(indices[0].c_str())-1]);
-							p->Vertices.push_back(temp_vertices[atoi(indices[0].c_str())-1]);
-						}
+						unsigned int uv = OBJ_NO_UV;
 
 						if (indices.size() >= 2)
 						{
-							uvs_.push_back(temp_uvs[atoi(indices[1].c_str())-1]);
+							uv = atoi(indices[1].c_str())-1;
 
 							if (indices.size() == 3)
 							{
 								normals_.push_back(temp_normals[atoi(indices[2].c_str())-1]);
 							}
 						}
+
+						mesh_.Indices.push_back(AddObjCorner(atoi(indices[0].c_str())-1, uv, temp_vertices, temp_uvs));
 					}
 
-					p->Process();
+					p->SetVertices(&mesh_, first, slices.size() - 1);
 					planes.push_back(p);
 				}
-				else if (slices[0] == "usemtl" && slices.size() == 2)
+				else if (!ParseObjStatement(slices, texture, path))
 				{
-					texture = slices[1];
-					string folder;
-
-					// Get the directory of the OBJ file because the textures should be in the same directory
-					texture = DirName(path) + texture;
-
-					if (!EndsWith(texture, "None"))
-					{
-						AddTexture(texture, false);
-					}
-					else	// Texture is "None"
-					{
-						texture = "None";
-					}
-				}
-				else if (slices[0] == "thing" && slices.size() == 6)
-				{
-					if (slices[1] == "spawn")
-					{
-						SpawnSpot spawn;
-						spawn.pos_.x = atof(slices[2].c_str()) * scaling_;
-						spawn.pos_.y = atof(slices[3].c_str()) * scaling_;
-						spawn.pos_.z = atof(slices[4].c_str()) * scaling_;
-						spawn.Angle = (short)atoi(slices[5].c_str()) * 91.0222222222f;
-						spawns.push_back(spawn);
-					}
-					else if (slices[1] == "player")
-					{
-						play = new Player();
-						play->pos_.x = atof(slices[2].c_str()) * scaling_;
-						play->pos_.y = atof(slices[3].c_str()) * scaling_;
-						play->pos_.z = atof(slices[4].c_str()) * scaling_;
-						play->Angle = (short)atoi(slices[5].c_str()) * 91.0222222222f;
-						players.push_back(play);
-					}
-					else if (slices[1] == "weapon")
-					{
-						weapons.push_back(new Weapon(atof(slices[2].c_str()) * scaling_, atof(slices[3].c_str()) * scaling_, atof(slices[4].c_str()) * scaling_, slices[5]));
-					}
-				}
-				else if (slices[0] == "setting" && slices.size() == 3)
-				{
-					if (slices[1] == "scale")
-					{
-						scaling_ = atof(slices[2].c_str());
-					}
-				}
-				else
-				{
-					cout << "Skipped line " << Count << endl;
+					Log() << "Skipped line " << Count << endl;
 				}
 			}
 		} // end of while loop
 
-		// Check if no player was created
-		if (players.size() == 0)
+		FinishObj(numOfPlayers);
+	}
+	else
+	{
+		throw runtime_error("Unable to open level '" + path + "'");
+	}
+
+	model.close();
+}
+
+// Handles the lines of an OBJ file that are not geometry. They must be read in order.
+// Returns false if the line is unknown.
+bool Level::ParseObjStatement(const vector<string>& slices, string& texture, const string& path)
+{
+	if (slices[0] == "usemtl" && slices.size() == 2)
+	{
+		texture = slices[1];
+
+		// Get the directory of the OBJ file because the textures should be in the same directory
+		texture = DirName(path) + texture;
+
+		if (!EndsWith(texture, "None"))
 		{
-			// Create the required number of players and spawn them
-			for (unsigned int i = 0; i < numOfPlayers; i++)
-			{
-				players.emplace_back(new Player());
-				SpawnPlayer(players[i], players);
+			AddTexture(texture, false);
+		}
+		else	// Texture is "None"
+		{
+			texture = "None";
+		}
+	}
+	else if (slices[0] == "thing" && slices.size() == 6)
+	{
+		if (slices[1] == "spawn")
+		{
+			SpawnSpot spawn;
+			spawn.pos_.x = atof(slices[2].c_str()) * scaling_;
+			spawn.pos_.y = atof(slices[3].c_str()) * scaling_;
+			spawn.pos_.z = atof(slices[4].c_str()) * scaling_;
+			spawn.Angle = (short)atoi(slices[5].c_str()) * 91.0222222222f;
+			spawns.push_back(spawn);
+		}
+		else if (slices[1] == "player")
+		{
+			SpawnSpot start;
+			start.pos_.x = atof(slices[2].c_str()) * scaling_;
+			start.pos_.y = atof(slices[3].c_str()) * scaling_;
+			start.pos_.z = atof(slices[4].c_str()) * scaling_;
+			start.Angle = (short)atoi(slices[5].c_str()) * 91.0222222222f;
+			AddStart(start);
+		}
+		else if (slices[1] == "weapon" && !reloaded_)
+		{
+			weapons.push_back(new Weapon(atof(slices[2].c_str()) * scaling_, atof(slices[3].c_str()) * scaling_, atof(slices[4].c_str()) * scaling_, slices[5]));
+		}
+	}
+	else if (slices[0] == "setting" && slices.size() == 3)
+	{
+		if (slices[1] == "scale")
+		{
+			scaling_ = atof(slices[2].c_str());
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+// Get the mesh vertex for a corner of a face. Corners that have the same vertex and UV share it.
+unsigned int Level::AddObjCorner(unsigned int vertex, unsigned int uv, const vector<Float3>& vertices, const vector<Float2>& uvs)
+{
+	uint64_t key = (uint64_t)vertex << 32 | uv;
+	auto found = objCorners_.find(key);
+
+	if (found != objCorners_.end())
+		return found->second;
+
+	unsigned int index = mesh_.Vertices.size();
+	mesh_.Vertices.push_back(vertices[vertex]);
+	mesh_.UVs.push_back(uv != OBJ_NO_UV ? uvs[uv] : Float2{0, 0});
+	objCorners_[key] = index;
+
+	return index;
+}
+
+// Things that are done once every line of an OBJ file has been read
+void Level::FinishObj(unsigned int numOfPlayers)
+{
+	ProcessPlanes();
+
+	floorSpawn_ = true;
+	SpawnPlayers(numOfPlayers);
+	AddThings();
+
+	bool foundUVs = false;
+	for (auto it = objCorners_.begin(); it != objCorners_.end() && !foundUVs; ++it)
+	{
+		foundUVs = (it->first & 0xFFFFFFFF) != OBJ_NO_UV;
+	}
+
+	if (!foundUVs)
+	{
+		// This should help diagnostics
+		LogError() << "WARNING: No UVs found. Textures will not be mapped correctly." << endl;
+	}
+
+	// Only needed while the faces are read
+	objCorners_.clear();
+
+	// Remove polygons that don't have a texture. Their memory stays in the arena until the level is freed.
+	planes.erase(remove_if(planes.begin(), planes.end(), [](const Plane* p) { return p->Texture == nullptr; }), planes.end());
+}
+
+// Create the players that were not placed by the level and spawn them
+void Level::SpawnPlayers(unsigned int numOfPlayers)
+{
+	// Check if no player was created
+	if (players.size() == 0)
+	{
+		// Create the required number of players and spawn them
+		for (unsigned int i = 0; i < numOfPlayers; i++)
+		{
+			players.emplace_back(new Player());
+			SpawnPlayer(players[i], players);
+
+			if (floorSpawn_)
 				AdjustPlayerToFloor(players[i], this);
-			}
-			// Set the player to player #1
-			play = players[0];
 		}
+		// Set the player to player #1
+		play = players[0];
+	}
+}
+
+// A player that was placed by the level. It's only created the first time the level is loaded.
+void Level::AddStart(const SpawnSpot& start)
+{
+	starts_.push_back(start);
 
-		// Populate the array of "things"
+	if (!reloaded_)
+	{
+		play = new Player();
+		play->pos_ = start.pos_;
+		play->Angle = start.Angle;
+		players.push_back(play);
+	}
+}
+
+// Populate the array of "things"
+void Level::AddThings()
+{
+	// They are already there after a reload
+	if (!reloaded_)
+	{
 		things.insert(things.end(), weapons.begin(), weapons.end());
 		things.insert(things.end(), players.begin(), players.end());
+	}
+}
+
+// Find the normal, centroid and box of the planes that were just read.
+// During a reload, planes that did not change are taken from the previous version of the level.
+void Level::ProcessPlanes()
+{
+	vector<unsigned int> changed;
 
-		if (uvs_.empty())
+	for (unsigned int i = 0; i < planes.size(); i++)
+	{
+		Plane* p = planes[i];
+		Plane* old = nullptr;
+
+		if (!reloadPool_.empty())
 		{
-			// This should help diagnostics
-			cerr << "WARNING: No UVs found. The program is expected to crash." << endl;
+			auto range = reloadPool_.equal_range(PlaneHash(p));
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (SamePlane(p, it->second, !mesh_.UVs.empty() && !reloadMesh_->UVs.empty()))
+				{
+					old = it->second;
+					reloadPool_.erase(it);
+					break;
+				}
+			}
 		}
 
-		// Set UVs
-		unsigned int uv_count = 0;
+		if (old)
+		{
+			// Same plane, but its vertices are now in the new mesh
+			unsigned int first = p->FirstIndex();
+			*p = *old;
+			p->SetVertices(&mesh_, first, old->NumVertices());
+		}
+		else
+		{
+			changed.push_back(i);
+		}
+	}
+
+	// Worth it on big levels
+	const unsigned int PARALLEL_PLANES = 50000;
+
+	if (changed.size() >= PARALLEL_PLANES && DefaultThreadCount() > 1)
+	{
+		ThreadPool pool;
+		pool.ParallelFor(changed.size(), [this, &changed](unsigned int first, unsigned int last)
+		{
+			for (unsigned int i = first; i < last; i++)
+				planes[changed[i]]->Process();
+		});
+	}
+	else
+	{
+		for (unsigned int i = 0; i < changed.size(); i++)
+			planes[changed[i]]->Process();
+	}
+}
+
+// Planes of a tiled level belong to its tiles
+void Level::DeletePlanes()
+{
+	if (stream_)
+	{
+		stream_.reset();
+	}
+	else
+	{
+		arena_.Reset();
+	}
+
+	planes.clear();
+}
+
+Plane* Level::NewPlane()
+{
+	return arena_.New<Plane>();
+}
+
+const string* Level::TextureName(const string& name)
+{
+	return &*textureNames_.insert(name).first;
+}
+
+void Level::SetStreaming(size_t budget, float radius)
+{
+	if (stream_)
+	{
+		stream_->SetBudget(budget);
+
+		if (radius > 0)
+			stream_->SetRadius(radius);
+
+		UpdateStreaming();
+	}
+}
+
+void Level::UpdateStreaming()
+{
+	if (!stream_)
+		return;
+
+	vector<Float3> points;
+	for (unsigned int i = 0; i < players.size(); i++)
+	{
+		points.push_back(players[i]->pos_);
+	}
+
+	if (stream_->Update(points))
+	{
+		// Collisions and rendering only see the active tiles
+		stream_->GetActivePlanes(planes);
+		BuildBlockmap();
+	}
+}
+
+void Level::ClearBlockmap()
+{
+	blockColumns_ = 0;
+	blockRows_ = 0;
+	blockOffsets_.clear();
+	blockPlanes_.clear();
+}
+
+// Put every plane in the blocks that its bounding box overlaps
+void Level::BuildBlockmap()
+{
+	ClearBlockmap();
+
+	if (planes.empty())
+		return;
+
+	Float3 low = planes[0]->BoxMin();
+	Float3 high = planes[0]->BoxMax();
+
+	for (unsigned int i = 1; i < planes.size(); i++)
+	{
+		low.x = min(low.x, planes[i]->BoxMin().x);
+		low.y = min(low.y, planes[i]->BoxMin().y);
+		high.x = max(high.x, planes[i]->BoxMax().x);
+		high.y = max(high.y, planes[i]->BoxMax().y);
+	}
+
+	blockOrigin_ = {low.x, low.y};
+	blockColumns_ = (unsigned int)floor((high.x - low.x) / BLOCKSIZE) + 1;
+	blockRows_ = (unsigned int)floor((high.y - low.y) / BLOCKSIZE) + 1;
+
+	// Count the planes in each block, then fill the blocks
+	vector<unsigned int> counts(blockColumns_ * blockRows_, 0);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
 		for (unsigned int i = 0; i < planes.size(); i++)
 		{
-			for (unsigned int j = 0; j < planes[i]->Vertices.size(); j++)
+			unsigned int x1 = (unsigned int)floor((planes[i]->BoxMin().x - low.x) / BLOCKSIZE);
+			unsigned int x2 = (unsigned int)floor((planes[i]->BoxMax().x - low.x) / BLOCKSIZE);
+			unsigned int y1 = (unsigned int)floor((planes[i]->BoxMin().y - low.y) / BLOCKSIZE);
+			unsigned int y2 = (unsigned int)floor((planes[i]->BoxMax().y - low.y) / BLOCKSIZE);
+
+			for (unsigned int y = y1; y <= y2 && y < blockRows_; y++)
 			{
-				// Distribute an UV to each vertice
-				planes[i]->UVs.push_back(uvs_[uv_count]);
+				for (unsigned int x = x1; x <= x2 && x < blockColumns_; x++)
+				{
+					unsigned int block = y * blockColumns_ + x;
 
-				uv_count++;
+					if (pass == 0)
+						counts[block]++;
+					else
+						blockPlanes_[counts[block]++] = i;
+				}
 			}
 		}
 
-		// Remove polygons that don't have a texture
-		for (int i = planes.size() - 1; i >= 0; i--)
+		if (pass == 0)
 		{
-			if (planes[i]->Texture == "")
+			// Turn the counts into offsets
+			blockOffsets_.resize(counts.size() + 1);
+			blockOffsets_[0] = 0;
+
+			for (unsigned int b = 0; b < counts.size(); b++)
 			{
-				delete planes[i];
-				planes.erase(planes.begin() + i);
+				blockOffsets_[b + 1] = blockOffsets_[b] + counts[b];
+				counts[b] = blockOffsets_[b];
 			}
+
+			blockPlanes_.resize(blockOffsets_.back());
 		}
 	}
-	else
+}
+
+vector<Plane*> Level::getPlanesForBox(float x, float y, float radius) const
+{
+	vector<Plane*> boxplanes;
+
+	if (blockOffsets_.empty())
 	{
-		throw runtime_error("Unable to open level '" + path + "'");
+		// The blockmap is not built while the level is loading
+		for (unsigned int k = 0; k < planes.size(); k++)
+		{
+			// Check if the player could be in the box (2D check)
+			if (planes[k]->InBox2D(x, y, radius))
+			{
+				boxplanes.push_back(planes[k]);
+			}
+		}
+
+		return boxplanes;
 	}
 
-	model.close();
+	// Blocks covered by the box. A bit of margin is added so rounding never misses a plane.
+	const float MARGIN = 0.001f;
+	int x1 = (int)floor((x - radius - MARGIN - blockOrigin_.x) / BLOCKSIZE);
+	int x2 = (int)floor((x + radius + MARGIN - blockOrigin_.x) / BLOCKSIZE);
+	int y1 = (int)floor((y - radius - MARGIN - blockOrigin_.y) / BLOCKSIZE);
+	int y2 = (int)floor((y + radius + MARGIN - blockOrigin_.y) / BLOCKSIZE);
+
+	// Outside of the level
+	if (x2 < 0 || y2 < 0 || x1 >= (int)blockColumns_ || y1 >= (int)blockRows_)
+		return boxplanes;
+
+	x1 = max(x1, 0);
+	y1 = max(y1, 0);
+	x2 = min(x2, (int)blockColumns_ - 1);
+	y2 = min(y2, (int)blockRows_ - 1);
+
+	vector<unsigned int> found;
+
+	for (int by = y1; by <= y2; by++)
+	{
+		for (int bx = x1; bx <= x2; bx++)
+		{
+			unsigned int block = by * blockColumns_ + bx;
+
+			for (unsigned int k = blockOffsets_[block]; k < blockOffsets_[block + 1]; k++)
+			{
+				// Check if the player could be in the box (2D check)
+				if (planes[blockPlanes_[k]]->InBox2D(x, y, radius))
+				{
+					found.push_back(blockPlanes_[k]);
+				}
+			}
+		}
+	}
+
+	// A plane can be in many blocks. Keep the same order as the list of planes.
+	if (x1 != x2 || y1 != y2)
+	{
+		sort(found.begin(), found.end());
+		found.erase(unique(found.begin(), found.end()), found.end());
+	}
+
+	boxplanes.reserve(found.size());
+	for (unsigned int k = 0; k < found.size(); k++)
+	{
+		boxplanes.push_back(planes[found[k]]);
+	}
+
+	return boxplanes;
 }
 
-vector<Plane*> Level::getPlanesForBox(float x, float y, float radius) const
+// Walk the blocks along the line (Amanatides and Woo)
+void Level::getPlanesForLine(float x1, float y1, float x2, float y2, vector<unsigned int>& indices) const
 {
-	// TODO: Should be computed once. Doesn't need to be computed again unless map
-	// geometry moves. Planes could be linked together like a linked list. We could
-	// keep track of the plane where the player is located to speed up lookups.
-	// This would also be useful for the bot's pathfinding.
+	indices.clear();
 
-	vector<Plane*> boxplanes;
+	if (blockOffsets_.empty())
+	{
+		// The blockmap is not built while the level is loading
+		for (unsigned int k = 0; k < planes.size(); k++)
+			indices.push_back(k);
+
+		return;
+	}
+
+	// Position along the line in blocks
+	float startX = (x1 - blockOrigin_.x) / BLOCKSIZE;
+	float startY = (y1 - blockOrigin_.y) / BLOCKSIZE;
+	float dx = (x2 - x1) / BLOCKSIZE;
+	float dy = (y2 - y1) / BLOCKSIZE;
 
-	for (unsigned int k = 0; k < planes.size(); k++)
+	// Only keep the part of the line that is over the blockmap
+	float first = 0;
+	float last = 1;
+	const float start[2] = {startX, startY};
+	const float delta[2] = {dx, dy};
+	const float size[2] = {(float)blockColumns_, (float)blockRows_};
+
+	for (int axis = 0; axis < 2; axis++)
 	{
-		// Check if the player could be in the box (2D check)
-		if (planes[k]->InBox2D(x, y, radius))
+		if (delta[axis] == 0)
 		{
-			boxplanes.push_back(planes[k]);
+			if (start[axis] < 0 || start[axis] > size[axis])
+				return;
+
+			continue;
 		}
+
+		float enter = (0 - start[axis]) / delta[axis];
+		float leave = (size[axis] - start[axis]) / delta[axis];
+
+		if (enter > leave)
+			swap(enter, leave);
+
+		first = max(first, enter);
+		last = min(last, leave);
 	}
 
-	return boxplanes;
+	if (first > last)
+		return;
+
+	int x = min(max((int)floor(startX + dx * first), 0), (int)blockColumns_ - 1);
+	int y = min(max((int)floor(startY + dy * first), 0), (int)blockRows_ - 1);
+	int endX = min(max((int)floor(startX + dx * last), 0), (int)blockColumns_ - 1);
+	int endY = min(max((int)floor(startY + dy * last), 0), (int)blockRows_ - 1);
+
+	// Distance along the line to the next column and row, and from one to the next
+	const float NEVER = numeric_limits<float>::max();
+	int stepX = dx > 0 ? 1 : -1;
+	int stepY = dy > 0 ? 1 : -1;
+	float nextX = dx > 0 ? (x + 1 - startX) / dx : dx < 0 ? (x - startX) / dx : NEVER;
+	float nextY = dy > 0 ? (y + 1 - startY) / dy : dy < 0 ? (y - startY) / dy : NEVER;
+	float deltaX = dx != 0 ? fabs(1 / dx) : NEVER;
+	float deltaY = dy != 0 ? fabs(1 / dy) : NEVER;
+
+	for (unsigned int steps = 0; steps <= blockColumns_ + blockRows_; steps++)
+	{
+		unsigned int block = y * blockColumns_ + x;
+		indices.insert(indices.end(), blockPlanes_.begin() + blockOffsets_[block], blockPlanes_.begin() + blockOffsets_[block + 1]);
+
+		if (x == endX && y == endY)
+			break;
+
+		if (nextX < nextY)
+		{
+			x += stepX;
+			nextX += deltaX;
+		}
+		else
+		{
+			y += stepY;
+			nextY += deltaY;
+		}
+
+		if (x < 0 || y < 0 || x >= (int)blockColumns_ || y >= (int)blockRows_)
+			break;
+	}
 }
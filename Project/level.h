@@ -23,12 +23,24 @@
 #include "player.h"
 #include "plane.h"	/* Plane */
 #include "cache.h"	/* Cache */
+#include "arena.h"	/* Arena */
 #include "vecmath.h"	/* Float3 */
 
 #include <vector>
 #include <string>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
 using namespace std;
 
+class LevelStream;
+struct LevelFileThing;
+
+const unsigned int OBJ_NO_UV = 0xFFFFFFFF;	// For faces without texture coordinates
+
 class Level
 {
 public:
@@ -48,11 +60,23 @@ public:
 
 	Level(const string& level, float scaling, unsigned int numOfPlayers);
 	~Level();
-	void Reload();	// Reload level geometry
+	bool Reload();	// Reload level geometry. Only the planes that changed are rebuilt. Returns false if it failed.
+	bool ReloadIfChanged();	// Returns true if the file was modified and reloaded
 
 	void LoadLevel(const string& LevelName, unsigned int numOfPlayers);
 	void LoadNative(const string& LevelName, unsigned int numOfPlayers);
 	void LoadObj(const string& path, unsigned int numOfPlayers);
+	void LoadObjParallel(const string& path, unsigned int numOfPlayers);	// Same result as LoadObj
+	void LoadCompiled(const string& path, unsigned int numOfPlayers);
+	void LoadTiled(const string& path, unsigned int numOfPlayers);
+
+	// Write the loaded level in the compiled format
+	void SaveCompiled(const string& path) const;
+	void SaveTiled(const string& path, float tileSize) const;
+
+	// Tiled levels only keep the tiles that are close to the players
+	void SetStreaming(size_t budget, float radius);	// A radius of zero keeps the default
+	void UpdateStreaming();	// Must be called once per tic before the players move
 
 	void SpawnPlayer(Player* play, const vector<Player*>& players);
 	void UpdateThings();
@@ -61,18 +85,54 @@ public:
 
 	vector<Plane*> getPlanesForBox(float x, float y, float radius) const;
 
+	// Indices of the planes in the blocks that a 2D line goes through, from the first point to the last.
+	// A plane that is in many blocks is given more than once.
+	void getPlanesForLine(float x1, float y1, float x2, float y2, vector<unsigned int>& indices) const;
+
 private:
 	// OBJ and OpenGL stuff
-	vector<Float3> vertices_;
-	vector<Float2> uvs_;
+	Arena arena_;	// Owns the planes
+	PlaneMesh mesh_;	// Shared by every plane
+	unordered_set<string> textureNames_;	// Texture names used by the planes. Kept for the lifetime of the level.
 	vector<Float3> normals_;
+	unordered_map<uint64_t, unsigned int> objCorners_;	// Mesh vertex of each OBJ vertex and UV pair
 
 	float scaling_ = 1.0f;	// Level scaling that adjusts the size of the level proportionally
 	string levelname_;
 	string lastTextureBind = "";
-	bool reloaded_ = false;
-	void BuildBlockmap();
+	bool reloaded_ = false;	// Set while reloading. Players and weapons are not created again.
+	int64_t levelTime_ = 0;	// Modification time of the file in nanoseconds
+	int64_t levelSize_ = -1;	// Also compared, in case the file is saved twice in the same tick of the clock
+	unordered_multimap<size_t, Plane*> reloadPool_;	// Planes from before the reload that were not reused yet
+	const PlaneMesh* reloadMesh_ = nullptr;
 	bool useUVs_ = false;
+	bool floorSpawn_ = false;	// Spawned players must be adjusted to the floor
+
+	vector<SpawnSpot> starts_;	// Players that were placed by the level
+	unique_ptr<LevelStream> stream_;	// Only for tiled levels. The planes belong to it.
+	map<string, bool> filtering_;	// Filtering used for each texture
+
+	void SpawnPlayers(unsigned int numOfPlayers);
+	void DeletePlanes();
+	Plane* NewPlane();
+	const string* TextureName(const string& name);	// The same pointer is returned for the same name
+	void ProcessPlanes();
+	void AddStart(const SpawnSpot& start);
+	void AddThings();
+	void AddThing(const LevelFileThing& thing, const string& name);
+	bool ParseObjStatement(const vector<string>& slices, string& texture, const string& path);
+	unsigned int AddObjCorner(unsigned int vertex, unsigned int uv, const vector<Float3>& vertices, const vector<Float2>& uvs);
+	void FinishObj(unsigned int numOfPlayers);
+
+	// Blockmap. Planes are put in square blocks so they can be found quickly.
+	const float BLOCKSIZE = 4.0f;
+	Float2 blockOrigin_ = {0, 0};
+	unsigned int blockColumns_ = 0;
+	unsigned int blockRows_ = 0;
+	vector<unsigned int> blockOffsets_;	// Where each block's list starts in 'blockPlanes_'
+	vector<unsigned int> blockPlanes_;	// Indices of the planes in each block
+	void BuildBlockmap();
+	void ClearBlockmap();
 };
 
 #endif // LEVEL_H
@@ -0,0 +1,616 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// levelfile.cpp
+// Compiled level format. The file is memory-mapped while it's loaded. The planes, the mesh and
+// the blockmap are copied from it as-is, so nothing has to be computed again.
+// Every offset is relative to the beginning of the file.
+
+#include "levelfile.h"
+#include "levelstream.h"	/* LevelStream */
+#include "level.h"
+#include "mapfile.h"	/* MappedFile */
+#include "plane.h"
+#include "player.h"
+#include "actor.h"
+#include "cache.h"	/* Cache */
+#include "texture.h"
+#include "log.h"	/* Log */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>	/* min, max */
+#include <cmath>	/* floor */
+#include <fstream>
+#include <cstring>	/* memcmp, memcpy */
+#include <stdexcept>
+using namespace std;
+
+static bool HasMagic(const string& path, const char* signature)
+{
+	char magic[4];
+	ifstream file(path, ios::binary);
+
+	if (file.read(magic, sizeof(magic)))
+		return memcmp(magic, signature, sizeof(magic)) == 0;
+
+	return false;
+}
+
+bool IsCompiledLevel(const string& path)
+{
+	return HasMagic(path, LEVELFILE_MAGIC);
+}
+
+bool IsTiledLevel(const string& path)
+{
+	return HasMagic(path, TILEDFILE_MAGIC);
+}
+
+// Strings and textures that are written to a level file
+struct LevelFileTables
+{
+	vector<char> strings;
+	vector<LevelFileTexture> textures;
+	map<string, int32_t> textureIndices;
+
+	int32_t AddString(const string& s)
+	{
+		int32_t offset = strings.size();
+		strings.insert(strings.end(), s.begin(), s.end());
+		strings.push_back('\0');
+		return offset;
+	}
+
+	int32_t AddTexture(const string& name, const map<string, bool>& filtering)
+	{
+		if (textureIndices.find(name) == textureIndices.end())
+		{
+			auto filter = filtering.find(name);
+			uint32_t filtered = filter != filtering.end() && filter->second;
+			textureIndices[name] = textures.size();
+			textures.push_back({(uint32_t)AddString(name), filtered});
+		}
+
+		return textureIndices[name];
+	}
+};
+
+static void WriteLevelFile(const string& path, const vector<unsigned char>& buffer, const string& kind)
+{
+	ofstream file(path, ios::binary);
+	if (!file.is_open())
+	{
+		throw runtime_error("Could not open file '" + path + "' to write");
+	}
+
+	file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	Log() << kind << " level written to '" << path << "' (" << buffer.size() << " bytes)" << endl;
+}
+
+// Add a thing that was read from a level file
+void Level::AddThing(const LevelFileThing& thing, const string& name)
+{
+	if (thing.type == LEVELTHING_SPAWN)
+	{
+		SpawnSpot spawn;
+		spawn.pos_ = thing.pos;
+		spawn.Angle = thing.angle;
+		spawns.push_back(spawn);
+	}
+	else if (thing.type == LEVELTHING_PLAYER)
+	{
+		SpawnSpot start;
+		start.pos_ = thing.pos;
+		start.Angle = thing.angle;
+		AddStart(start);
+	}
+	else if (thing.type == LEVELTHING_WEAPON && !reloaded_)
+	{
+		weapons.push_back(new Weapon(thing.pos.x, thing.pos.y, thing.pos.z, name));
+	}
+}
+
+// Things of the level in the format of the files
+static vector<LevelFileThing> ThingRecords(const vector<SpawnSpot>& spawns, const vector<SpawnSpot>& starts,
+	const vector<Weapon*>& weapons, LevelFileTables& tables)
+{
+	vector<LevelFileThing> records;
+
+	for (unsigned int i = 0; i < spawns.size(); i++)
+	{
+		records.push_back({LEVELTHING_SPAWN, -1, spawns[i].pos_, spawns[i].Angle});
+	}
+
+	for (unsigned int i = 0; i < starts.size(); i++)
+	{
+		records.push_back({LEVELTHING_PLAYER, -1, starts[i].pos_, starts[i].Angle});
+	}
+
+	for (unsigned int i = 0; i < weapons.size(); i++)
+	{
+		records.push_back({LEVELTHING_WEAPON, tables.AddString(weapons[i]->Type_), weapons[i]->pos_, 0});
+	}
+
+	return records;
+}
+
+void Level::SaveCompiled(const string& path) const
+{
+	if (stream_)
+	{
+		throw runtime_error("A tiled level can't be compiled again");
+	}
+
+	LevelFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, LEVELFILE_MAGIC, sizeof(header.magic));
+	header.version = LEVELFILE_VERSION;
+	header.byteOrder = LEVELFILE_BYTEORDER;
+	header.flags = (useUVs_ ? LEVELFILE_UVS : 0) | (floorSpawn_ ? LEVELFILE_FLOORSPAWN : 0);
+	header.skyHeight = SkyHeigth;
+	header.skyTexture = -1;
+
+	LevelFileTables tables;
+	vector<LevelFilePlane> planeRecords;
+
+	if (!SkyTexture.empty())
+		header.skyTexture = tables.AddTexture(SkyTexture, filtering_);
+
+	for (unsigned int i = 0; i < planes.size(); i++)
+	{
+		const Plane* p = planes[i];
+		LevelFilePlane record;
+
+		record.firstIndex = p->FirstIndex();
+		record.numVertices = p->NumVertices();
+		record.texture = p->Texture ? tables.AddTexture(*p->Texture, filtering_) : -1;
+		record.flags = (p->Impassable ? 1 : 0) | (p->TwoSided ? 2 : 0);
+		record.xscale = p->Xscale;
+		record.yscale = p->Yscale;
+		record.xoff = p->Xoff;
+		record.yoff = p->Yoff;
+		record.light = p->Light;
+		record.normal = p->normal;
+		record.centroid = p->centroid;
+		record.min = p->BoxMin();
+		record.max = p->BoxMax();
+
+		planeRecords.push_back(record);
+	}
+
+	vector<LevelFileThing> thingRecords = ThingRecords(spawns, starts_, weapons, tables);
+
+	header.blockOriginX = blockOrigin_.x;
+	header.blockOriginY = blockOrigin_.y;
+	header.blockColumns = blockColumns_;
+	header.blockRows = blockRows_;
+
+	vector<unsigned char> buffer(sizeof(header), 0);
+	header.strings = AppendSection(buffer, tables.strings);
+	header.textures = AppendSection(buffer, tables.textures);
+	header.planes = AppendSection(buffer, planeRecords);
+	header.vertices = AppendSection(buffer, mesh_.Vertices);
+	header.uvs = AppendSection(buffer, useUVs_ ? mesh_.UVs : vector<Float2>());
+	header.indices = AppendSection(buffer, mesh_.Indices);
+	header.things = AppendSection(buffer, thingRecords);
+	header.blockOffsets = AppendSection(buffer, blockOffsets_);
+	header.blockPlanes = AppendSection(buffer, blockPlanes_);
+	memcpy(buffer.data(), &header, sizeof(header));
+
+	WriteLevelFile(path, buffer, "Compiled");
+}
+
+// Loading method for the compiled format
+void Level::LoadCompiled(const string& path, unsigned int numOfPlayers)
+{
+	MappedFile file(path);
+
+	if (!file.IsOpen())
+	{
+		throw runtime_error("Unable to open level '" + path + "'");
+	}
+
+	if (file.Size() < sizeof(LevelFileHeader))
+	{
+		throw runtime_error("Compiled level '" + path + "' is too small");
+	}
+
+	LevelFileHeader header;
+	memcpy(&header, file.Data(), sizeof(header));
+
+	if (header.byteOrder != LEVELFILE_BYTEORDER)
+	{
+		throw runtime_error("Compiled level '" + path + "' was made on a machine with a different byte order");
+	}
+
+	if (header.version != LEVELFILE_VERSION)
+	{
+		throw runtime_error("Compiled level '" + path + "' has version " + to_string(header.version) +
+			", but version " + to_string(LEVELFILE_VERSION) + " is expected. Compile it again.");
+	}
+
+	const char* strings = GetSection<char>(file, header.strings);
+	const LevelFileTexture* textures = GetSection<LevelFileTexture>(file, header.textures);
+	const LevelFilePlane* records = GetSection<LevelFilePlane>(file, header.planes);
+	const Float3* vertices = GetSection<Float3>(file, header.vertices);
+	const Float2* uvs = GetSection<Float2>(file, header.uvs);
+	const uint32_t* vertexIndices = GetSection<uint32_t>(file, header.indices);
+	const LevelFileThing* thingRecords = GetSection<LevelFileThing>(file, header.things);
+	const uint32_t* offsets = GetSection<uint32_t>(file, header.blockOffsets);
+	const uint32_t* indices = GetSection<uint32_t>(file, header.blockPlanes);
+
+	// Every string ends before the end of the table
+	if (header.strings.count > 0 && strings[header.strings.count - 1] != '\0')
+	{
+		throw runtime_error("Compiled level is corrupted. The strings are not terminated.");
+	}
+
+	auto getString = [&](int32_t offset)
+	{
+		if (offset < 0 || (uint32_t)offset >= header.strings.count)
+			throw runtime_error("Compiled level is corrupted. Invalid string.");
+
+		return string(strings + offset);
+	};
+
+	useUVs_ = header.flags & LEVELFILE_UVS;
+	floorSpawn_ = header.flags & LEVELFILE_FLOORSPAWN;
+	SkyHeigth = header.skyHeight;
+
+	// Load the textures
+	vector<string> names;
+	for (unsigned int i = 0; i < header.textures.count; i++)
+	{
+		names.push_back(getString(textures[i].name));
+		AddTexture(names.back(), textures[i].filtering != 0);
+	}
+
+	if (header.skyTexture >= 0 && (uint32_t)header.skyTexture < names.size())
+	{
+		SkyTexture = names[header.skyTexture];
+	}
+
+	// The mesh is copied as-is
+	if (useUVs_ && header.uvs.count != header.vertices.count)
+	{
+		throw runtime_error("Compiled level is corrupted. There must be an UV for every vertex.");
+	}
+
+	mesh_.Vertices.assign(vertices, vertices + header.vertices.count);
+	if (useUVs_)
+		mesh_.UVs.assign(uvs, uvs + header.uvs.count);
+	mesh_.Indices.assign(vertexIndices, vertexIndices + header.indices.count);
+
+	for (unsigned int i = 0; i < mesh_.Indices.size(); i++)
+	{
+		if (mesh_.Indices[i] >= mesh_.Vertices.size())
+			throw runtime_error("Compiled level is corrupted. A vertex index is invalid.");
+	}
+
+	// The planes are ready to use. Nothing needs to be computed.
+	planes.reserve(planes.size() + header.planes.count);
+	arena_.Reserve(header.planes.count * sizeof(Plane));
+
+	for (unsigned int i = 0; i < header.planes.count; i++)
+	{
+		const LevelFilePlane& record = records[i];
+
+		if (record.numVertices < 3 || record.numVertices > Plane::MAX_VERTICES ||
+			record.firstIndex > header.indices.count || record.numVertices > header.indices.count - record.firstIndex)
+		{
+			throw runtime_error("Compiled level is corrupted. Plane " + to_string(i) + " has invalid vertices.");
+		}
+
+		Plane* p = NewPlane();
+		p->Impassable = record.flags & 1;
+		p->TwoSided = record.flags & 2;
+		p->Xscale = record.xscale;
+		p->Yscale = record.yscale;
+		p->Xoff = record.xoff;
+		p->Yoff = record.yoff;
+		p->Light = record.light;
+
+		if (record.texture >= 0 && (uint32_t)record.texture < names.size())
+		{
+			p->Texture = TextureName(names[record.texture]);
+		}
+
+		p->SetVertices(&mesh_, record.firstIndex, record.numVertices);
+
+		p->normal = record.normal;
+		p->centroid = record.centroid;
+		p->SetBox(record.min, record.max);
+
+		planes.push_back(p);
+	}
+
+	// Use the blockmap from the file
+	uint64_t blocks = (uint64_t)header.blockColumns * header.blockRows;	// Can't wrap around
+
+	if (blocks > 0 && header.blockOffsets.count == blocks + 1)
+	{
+		blockOrigin_ = {header.blockOriginX, header.blockOriginY};
+		blockColumns_ = header.blockColumns;
+		blockRows_ = header.blockRows;
+		blockOffsets_.assign(offsets, offsets + header.blockOffsets.count);
+		blockPlanes_.assign(indices, indices + header.blockPlanes.count);
+
+		for (unsigned int i = 0; i < blockPlanes_.size(); i++)
+		{
+			if (blockPlanes_[i] >= planes.size())
+				throw runtime_error("Compiled level is corrupted. The blockmap points to an invalid plane.");
+		}
+
+		for (unsigned int i = 1; i < blockOffsets_.size(); i++)
+		{
+			if (blockOffsets_[i] < blockOffsets_[i - 1] || blockOffsets_[i] > blockPlanes_.size())
+				throw runtime_error("Compiled level is corrupted. Invalid blockmap.");
+		}
+	}
+	else
+	{
+		BuildBlockmap();
+	}
+
+	for (unsigned int i = 0; i < header.things.count; i++)
+	{
+		const LevelFileThing& thing = thingRecords[i];
+		AddThing(thing, thing.type == LEVELTHING_WEAPON ? getString(thing.name) : "");
+	}
+
+	Log() << "Read " << header.planes.count << " planes from compiled level." << endl;
+
+	SpawnPlayers(numOfPlayers);
+	AddThings();
+}
+
+void Level::SaveTiled(const string& path, float tileSize) const
+{
+	if (stream_)
+	{
+		throw runtime_error("A tiled level can't be compiled again");
+	}
+
+	if (!(tileSize > 0))
+	{
+		throw runtime_error("The size of the tiles must be positive");
+	}
+
+	TiledFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TILEDFILE_MAGIC, sizeof(header.magic));
+	header.version = TILEDFILE_VERSION;
+	header.byteOrder = LEVELFILE_BYTEORDER;
+	header.flags = (useUVs_ ? LEVELFILE_UVS : 0) | (floorSpawn_ ? LEVELFILE_FLOORSPAWN : 0);
+	header.skyHeight = SkyHeigth;
+	header.skyTexture = -1;
+	header.tileSize = tileSize;
+	header.numPlanes = planes.size();
+
+	LevelFileTables tables;
+
+	if (!SkyTexture.empty())
+		header.skyTexture = tables.AddTexture(SkyTexture, filtering_);
+
+	// Make a grid that covers the centroid of every plane
+	Float2 low = {0, 0};
+	Float2 high = {0, 0};
+
+	for (unsigned int i = 0; i < planes.size(); i++)
+	{
+		const Float3& c = planes[i]->centroid;
+
+		if (i == 0 || c.x < low.x)
+			low.x = c.x;
+		if (i == 0 || c.y < low.y)
+			low.y = c.y;
+		if (i == 0 || c.x > high.x)
+			high.x = c.x;
+		if (i == 0 || c.y > high.y)
+			high.y = c.y;
+	}
+
+	header.originX = floor(low.x / tileSize) * tileSize;
+	header.originY = floor(low.y / tileSize) * tileSize;
+	header.columns = (unsigned int)floor((high.x - header.originX) / tileSize) + 1;
+	header.rows = (unsigned int)floor((high.y - header.originY) / tileSize) + 1;
+
+	// Put each plane in its tile
+	vector<vector<unsigned int>> cells(header.columns * header.rows);
+
+	for (unsigned int i = 0; i < planes.size(); i++)
+	{
+		const Plane* p = planes[i];
+		unsigned int x = min((unsigned int)floor((p->centroid.x - header.originX) / tileSize), header.columns - 1);
+		unsigned int y = min((unsigned int)floor((p->centroid.y - header.originY) / tileSize), header.rows - 1);
+		cells[y * header.columns + x].push_back(i);
+
+		// How far the plane goes out of its tile
+		float left = header.originX + x * tileSize;
+		float bottom = header.originY + y * tileSize;
+		header.overhang = max(header.overhang, left - p->BoxMin().x);
+		header.overhang = max(header.overhang, p->BoxMax().x - (left + tileSize));
+		header.overhang = max(header.overhang, bottom - p->BoxMin().y);
+		header.overhang = max(header.overhang, p->BoxMax().y - (bottom + tileSize));
+	}
+
+	vector<TiledFileTile> tiles(cells.size());
+	vector<vector<unsigned char>> tileData(cells.size());
+
+	for (unsigned int t = 0; t < cells.size(); t++)
+	{
+		TiledFileTile& tile = tiles[t];
+		memset(&tile, 0, sizeof(tile));
+
+		if (cells[t].empty())
+			continue;
+
+		vector<LevelFilePlane> records;
+		vector<uint32_t> levelIndices;
+		vector<Float3> vertices;
+		vector<Float2> uvs;
+		vector<uint32_t> indices;
+		unordered_map<unsigned int, uint32_t> localVertex;	// Mesh vertex to vertex of the tile
+
+		tile.min = planes[cells[t][0]]->BoxMin();
+		tile.max = planes[cells[t][0]]->BoxMax();
+
+		for (unsigned int i = 0; i < cells[t].size(); i++)
+		{
+			const Plane* p = planes[cells[t][i]];
+			LevelFilePlane record;
+
+			record.firstIndex = indices.size();
+			record.numVertices = p->NumVertices();
+			record.texture = p->Texture ? tables.AddTexture(*p->Texture, filtering_) : -1;
+			record.flags = (p->Impassable ? 1 : 0) | (p->TwoSided ? 2 : 0);
+			record.xscale = p->Xscale;
+			record.yscale = p->Yscale;
+			record.xoff = p->Xoff;
+			record.yoff = p->Yoff;
+			record.light = p->Light;
+			record.normal = p->normal;
+			record.centroid = p->centroid;
+			record.min = p->BoxMin();
+			record.max = p->BoxMax();
+
+			for (unsigned int v = 0; v < p->NumVertices(); v++)
+			{
+				unsigned int meshVertex = mesh_.Indices[p->FirstIndex() + v];
+				auto found = localVertex.find(meshVertex);
+
+				if (found == localVertex.end())
+				{
+					found = localVertex.insert({meshVertex, (uint32_t)vertices.size()}).first;
+					vertices.push_back(mesh_.Vertices[meshVertex]);
+					if (useUVs_)
+						uvs.push_back(mesh_.UVs[meshVertex]);
+				}
+
+				indices.push_back(found->second);
+			}
+
+			tile.min = {min(tile.min.x, record.min.x), min(tile.min.y, record.min.y), min(tile.min.z, record.min.z)};
+			tile.max = {max(tile.max.x, record.max.x), max(tile.max.y, record.max.y), max(tile.max.z, record.max.z)};
+
+			records.push_back(record);
+			levelIndices.push_back(cells[t][i]);
+		}
+
+		tile.numPlanes = records.size();
+		tile.numVertices = vertices.size();
+		tile.numIndices = indices.size();
+
+		// The arrays are written one after the other, like ReadTile expects them
+		vector<unsigned char>& data = tileData[t];
+		AppendSection(data, records);
+		AppendSection(data, levelIndices);
+		AppendSection(data, vertices);
+		AppendSection(data, uvs);
+		AppendSection(data, indices);
+		tile.size = data.size();
+	}
+
+	vector<LevelFileThing> thingRecords = ThingRecords(spawns, starts_, weapons, tables);
+
+	vector<unsigned char> buffer(sizeof(header), 0);
+	header.strings = AppendSection(buffer, tables.strings);
+	header.textures = AppendSection(buffer, tables.textures);
+	header.things = AppendSection(buffer, thingRecords);
+	header.tiles = AppendSection(buffer, tiles);
+
+	for (unsigned int t = 0; t < tiles.size(); t++)
+	{
+		if (tileData[t].empty())
+			continue;
+
+		// Each tile starts on its own page
+		buffer.resize((buffer.size() + TILEDFILE_PAGESIZE - 1) / TILEDFILE_PAGESIZE * TILEDFILE_PAGESIZE, 0);
+		tiles[t].offset = buffer.size();
+		buffer.insert(buffer.end(), tileData[t].begin(), tileData[t].end());
+	}
+
+	// The offsets of the tiles are only known now
+	memcpy(buffer.data() + header.tiles.offset, tiles.data(), tiles.size() * sizeof(TiledFileTile));
+	memcpy(buffer.data(), &header, sizeof(header));
+
+	Log() << "Level split in " << header.columns << "x" << header.rows << " tiles of " << tileSize << " units." << endl;
+	WriteLevelFile(path, buffer, "Tiled");
+}
+
+// Loading method for the tiled format. Only the tiles around the players are kept.
+void Level::LoadTiled(const string& path, unsigned int numOfPlayers)
+{
+	stream_.reset(new LevelStream(path,
+		[this](const string& name, bool filtering)
+		{
+			AddTexture(name, filtering);
+			Texture* texture = Cache::Instance()->Get(name);
+			return (size_t)texture->Width() * texture->Height() * 4;
+		},
+		[this](const string& name)
+		{
+			if (name != SkyTexture)
+			{
+				Cache::Instance()->Remove(name);
+				filtering_.erase(name);
+				lastTextureBind.clear();
+			}
+		}));
+
+	const TiledFileHeader& header = stream_->Header();
+
+	useUVs_ = header.flags & LEVELFILE_UVS;
+	floorSpawn_ = header.flags & LEVELFILE_FLOORSPAWN;
+	SkyHeigth = header.skyHeight;
+
+	// The sky is always needed
+	SkyTexture = stream_->TextureName(header.skyTexture);
+	if (!SkyTexture.empty())
+		AddTexture(SkyTexture, stream_->TextureFiltering(header.skyTexture));
+
+	const LevelFileThing* thingRecords = stream_->Things();
+	for (unsigned int i = 0; i < header.things.count; i++)
+	{
+		const LevelFileThing& thing = thingRecords[i];
+		AddThing(thing, thing.type == LEVELTHING_WEAPON ? stream_->String(thing.name) : "");
+	}
+
+	// Players can be put on the floor when the tiles around the spawn spots are there
+	vector<Float3> points;
+	for (unsigned int i = 0; i < spawns.size(); i++)
+	{
+		points.push_back(spawns[i].pos_);
+	}
+	for (unsigned int i = 0; i < starts_.size(); i++)
+	{
+		points.push_back(starts_[i].pos_);
+	}
+
+	stream_->Update(points);
+	stream_->GetActivePlanes(planes);
+	BuildBlockmap();
+
+	Log() << "Tiled level has " << header.numPlanes << " planes in " << header.columns << "x" << header.rows << " tiles." << endl;
+
+	SpawnPlayers(numOfPlayers);
+	AddThings();
+
+	// Only keep the tiles around the players
+	UpdateStreaming();
+}
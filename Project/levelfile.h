@@ -0,0 +1,186 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// levelfile.h
+// Compiled level formats. The files are memory-mapped. A compiled level is copied into the level
+// when it's loaded, but nothing has to be computed again. A tiled level stays mapped while its tiles are streamed.
+// Every offset is relative to the beginning of the file.
+
+#ifndef LEVELFILE_H
+#define LEVELFILE_H
+
+#include "vecmath.h"	/* Float3, Float2 */
+#include "mapfile.h"	/* MappedFile */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <stdexcept>
+using namespace std;
+
+const char LEVELFILE_MAGIC[4] = {'M', 'G', 'L', 'C'};
+const uint32_t LEVELFILE_VERSION = 2;
+const uint32_t LEVELFILE_BYTEORDER = 0x01020304;	// Written in the machine's byte order
+
+// Header flags
+const uint32_t LEVELFILE_UVS = 1;	// Planes have texture coordinates
+const uint32_t LEVELFILE_FLOORSPAWN = 2;	// Spawned players are adjusted to the floor
+
+// Types of things
+const uint32_t LEVELTHING_SPAWN = 0;
+const uint32_t LEVELTHING_PLAYER = 1;
+const uint32_t LEVELTHING_WEAPON = 2;
+
+struct LevelFileSection
+{
+	uint32_t offset;
+	uint32_t count;		// Number of elements, not bytes
+};
+
+struct LevelFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t flags;
+
+	float skyHeight;
+	int32_t skyTexture;	// Index in the texture table, -1 if none
+
+	// Blockmap
+	float blockOriginX;
+	float blockOriginY;
+	uint32_t blockColumns;
+	uint32_t blockRows;
+
+	LevelFileSection strings;	// Null-terminated characters
+	LevelFileSection textures;	// LevelFileTexture
+	LevelFileSection planes;	// LevelFilePlane
+	LevelFileSection vertices;	// Float3
+	LevelFileSection uvs;		// Float2, same indices as the vertices
+	LevelFileSection indices;	// uint32_t, vertex indices used by the planes
+	LevelFileSection things;	// LevelFileThing
+	LevelFileSection blockOffsets;	// uint32_t, one more than the number of blocks
+	LevelFileSection blockPlanes;	// uint32_t, plane indices
+};
+
+struct LevelFileTexture
+{
+	uint32_t name;		// Offset in the string table
+	uint32_t filtering;
+};
+
+struct LevelFilePlane
+{
+	uint32_t firstIndex;	// Range in the index table
+	uint32_t numVertices;
+	int32_t texture;	// Index in the texture table, -1 if invisible
+	uint32_t flags;		// 1: Impassable, 2: TwoSided
+	float xscale;
+	float yscale;
+	float xoff;
+	float yoff;
+	float light;
+	Float3 normal;
+	Float3 centroid;
+	Float3 min;
+	Float3 max;
+};
+
+struct LevelFileThing
+{
+	uint32_t type;
+	int32_t name;		// Offset in the string table, -1 if none
+	Float3 pos;
+	int32_t angle;
+};
+
+// Tiled level. The planes are split in square tiles that are streamed as the players move.
+// Tiles start on a page boundary so that each one can be read without touching the others.
+const char TILEDFILE_MAGIC[4] = {'M', 'G', 'L', 'T'};
+const uint32_t TILEDFILE_VERSION = 1;
+const uint32_t TILEDFILE_PAGESIZE = 4096;
+
+struct TiledFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t flags;		// Same flags as LevelFileHeader
+
+	float skyHeight;
+	int32_t skyTexture;	// Index in the texture table, -1 if none
+
+	// Grid of tiles. A plane goes in the tile that contains its centroid.
+	float tileSize;
+	float originX;
+	float originY;
+	uint32_t columns;
+	uint32_t rows;
+	float overhang;		// How far a plane goes outside of its tile
+	uint32_t numPlanes;	// In the whole level
+
+	LevelFileSection strings;	// Null-terminated characters
+	LevelFileSection textures;	// LevelFileTexture
+	LevelFileSection things;	// LevelFileThing
+	LevelFileSection tiles;		// TiledFileTile, one per cell of the grid
+};
+
+// A tile is made of these arrays, one after the other:
+// LevelFilePlane[numPlanes], uint32_t[numPlanes] (index of each plane in the level),
+// Float3[numVertices], Float2[numVertices] (if the level has UVs) and uint32_t[numIndices].
+struct TiledFileTile
+{
+	uint32_t offset;
+	uint32_t size;		// In bytes
+	uint32_t numPlanes;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	Float3 min;		// Box around every plane of the tile
+	Float3 max;
+};
+
+// Append an array to the buffer and return where it was written
+template <typename T>
+inline LevelFileSection AppendSection(vector<unsigned char>& buffer, const vector<T>& items)
+{
+	// Everything in the file is aligned on 4 bytes
+	buffer.resize((buffer.size() + 3) & ~3, 0);
+
+	LevelFileSection section = {(uint32_t)buffer.size(), (uint32_t)items.size()};
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(items.data());
+	buffer.insert(buffer.end(), bytes, bytes + items.size() * sizeof(T));
+
+	return section;
+}
+
+// Get an array from the file after checking that it's inside the file
+template <typename T>
+inline const T* GetSection(const MappedFile& file, const LevelFileSection& section)
+{
+	if (section.offset % 4 != 0 || section.offset > file.Size() ||
+		section.count > (file.Size() - section.offset) / sizeof(T))
+	{
+		throw runtime_error("Compiled level is corrupted. A section is outside of the file.");
+	}
+
+	return reinterpret_cast<const T*>(file.Data() + section.offset);
+}
+
+// Returns true if the file starts with the compiled level signature
+bool IsCompiledLevel(const string& path);
+bool IsTiledLevel(const string& path);
+
+#endif	// LEVELFILE_H
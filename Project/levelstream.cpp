@@ -0,0 +1,498 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// levelstream.cpp
+// Streams the tiles of a tiled level
+
+#include "levelstream.h"
+#include "levelfile.h"
+#include "mapfile.h"
+#include "plane.h"
+#include "log.h"	/* LogError */
+
+#include <string>
+#include <vector>
+#include <algorithm>	/* sort, lower_bound */
+#include <cstring>	/* memcmp, memcpy */
+#include <cmath>	/* floor, sqrt */
+#include <limits>
+#include <chrono>
+#include <stdexcept>
+using namespace std;
+
+LevelStream::LevelStream(const string& path, TextureLoader load, TextureUnloader unload)
+	: loadTexture_(load), unloadTexture_(unload), loader_(1)
+{
+	if (!file_.Open(path))
+	{
+		throw runtime_error("Unable to open level '" + path + "'");
+	}
+
+	if (file_.Size() < sizeof(TiledFileHeader))
+	{
+		throw runtime_error("Tiled level '" + path + "' is too small");
+	}
+
+	memcpy(&header_, file_.Data(), sizeof(header_));
+
+	if (header_.byteOrder != LEVELFILE_BYTEORDER)
+	{
+		throw runtime_error("Tiled level '" + path + "' was made on a machine with a different byte order");
+	}
+
+	if (header_.version != TILEDFILE_VERSION)
+	{
+		throw runtime_error("Tiled level '" + path + "' has version " + to_string(header_.version) +
+			", but version " + to_string(TILEDFILE_VERSION) + " is expected. Compile it again.");
+	}
+
+	if (!(header_.tileSize > 0) || header_.tiles.count != (uint64_t)header_.columns * header_.rows)
+	{
+		throw runtime_error("Tiled level is corrupted. Invalid grid of tiles.");
+	}
+
+	strings_ = GetSection<char>(file_, header_.strings);
+	textures_ = GetSection<LevelFileTexture>(file_, header_.textures);
+	things_ = GetSection<LevelFileThing>(file_, header_.things);
+	tiles_ = GetSection<TiledFileTile>(file_, header_.tiles);
+
+	// Every string ends before the end of the table
+	if (header_.strings.count > 0 && strings_[header_.strings.count - 1] != '\0')
+	{
+		throw runtime_error("Tiled level is corrupted. The strings are not terminated.");
+	}
+
+	slots_.resize(header_.tiles.count);
+	textureUsers_.resize(header_.textures.count, 0);
+	textureBytes_.resize(header_.textures.count, 0);
+
+	// The planes of every tile point to these names
+	for (unsigned int i = 0; i < header_.textures.count; i++)
+		textureNames_.push_back(TextureName(i));
+
+	// Two tiles around the players by default
+	radius_ = header_.tileSize * 2;
+}
+
+LevelStream::~LevelStream()
+{
+	// The worker may still be writing to a slot
+	for (unsigned int i = 0; i < slots_.size(); i++)
+	{
+		if (slots_[i].pending.valid())
+			slots_[i].pending.wait();
+	}
+
+	for (unsigned int i = 0; i < header_.textures.count; i++)
+	{
+		if (textureUsers_[i] > 0)
+			unloadTexture_(TextureName(i));
+	}
+}
+
+const TiledFileHeader& LevelStream::Header() const
+{
+	return header_;
+}
+
+string LevelStream::String(int32_t offset) const
+{
+	if (offset < 0 || (uint32_t)offset >= header_.strings.count)
+		throw runtime_error("Tiled level is corrupted. Invalid string.");
+
+	return string(strings_ + offset);
+}
+
+string LevelStream::TextureName(int32_t index) const
+{
+	if (index < 0 || (uint32_t)index >= header_.textures.count)
+		return "";
+
+	return String(textures_[index].name);
+}
+
+bool LevelStream::TextureFiltering(unsigned int index) const
+{
+	return index < header_.textures.count && textures_[index].filtering != 0;
+}
+
+const LevelFileThing* LevelStream::Things() const
+{
+	return things_;
+}
+
+void LevelStream::SetBudget(size_t bytes)
+{
+	budget_ = bytes;
+	warned_ = false;
+}
+
+void LevelStream::SetRadius(float radius)
+{
+	radius_ = radius;
+}
+
+size_t LevelStream::ResidentBytes() const
+{
+	return residentBytes_;
+}
+
+unsigned int LevelStream::ResidentTiles() const
+{
+	return resident_.size();
+}
+
+// Don't load the next tiles when the memory used is above this part of the budget. Otherwise a tile
+// could be evicted right after it's loaded and be loaded again on the next tic.
+const float PREFETCH_BUDGET = 0.9f;
+
+// Memory used by a tile once it's loaded, without its textures
+static size_t TileBytes(const TiledFileTile& entry, bool hasUVs)
+{
+	return sizeof(LevelTile) + entry.numPlanes * (sizeof(Plane) + sizeof(uint32_t)) +
+		entry.numVertices * (sizeof(Float3) + (hasUVs ? sizeof(Float2) : 0)) + entry.numIndices * sizeof(uint32_t);
+}
+
+// Build a tile from the file. Called by the worker thread.
+LevelTile* LevelStream::ReadTile(unsigned int index) const
+{
+	const TiledFileTile& entry = tiles_[index];
+	const bool hasUVs = header_.flags & LEVELFILE_UVS;
+
+	// The arrays follow each other
+	uint32_t offset = entry.offset;
+	auto next = [&offset](uint32_t count, size_t size)
+	{
+		LevelFileSection section = {offset, count};
+		offset += count * size;
+		return section;
+	};
+
+	const LevelFilePlane* records = GetSection<LevelFilePlane>(file_, next(entry.numPlanes, sizeof(LevelFilePlane)));
+	const uint32_t* levelIndices = GetSection<uint32_t>(file_, next(entry.numPlanes, sizeof(uint32_t)));
+	const Float3* vertices = GetSection<Float3>(file_, next(entry.numVertices, sizeof(Float3)));
+	const Float2* uvs = GetSection<Float2>(file_, next(hasUVs ? entry.numVertices : 0, sizeof(Float2)));
+	const uint32_t* indices = GetSection<uint32_t>(file_, next(entry.numIndices, sizeof(uint32_t)));
+
+	unique_ptr<LevelTile> tile(new LevelTile());
+	tile->mesh.Vertices.assign(vertices, vertices + entry.numVertices);
+	if (hasUVs)
+		tile->mesh.UVs.assign(uvs, uvs + entry.numVertices);
+	tile->mesh.Indices.assign(indices, indices + entry.numIndices);
+	tile->levelIndices.assign(levelIndices, levelIndices + entry.numPlanes);
+
+	for (unsigned int i = 0; i < entry.numIndices; i++)
+	{
+		if (indices[i] >= entry.numVertices)
+			throw runtime_error("Tiled level is corrupted. A vertex index is invalid in tile " + to_string(index) + ".");
+	}
+
+	tile->planes.resize(entry.numPlanes);
+
+	for (unsigned int i = 0; i < entry.numPlanes; i++)
+	{
+		const LevelFilePlane& record = records[i];
+		Plane& p = tile->planes[i];
+
+		if (record.numVertices < 3 || record.numVertices > Plane::MAX_VERTICES ||
+			record.firstIndex > entry.numIndices || record.numVertices > entry.numIndices - record.firstIndex ||
+			levelIndices[i] >= header_.numPlanes)
+		{
+			throw runtime_error("Tiled level is corrupted. Invalid plane in tile " + to_string(index) + ".");
+		}
+
+		p.Impassable = record.flags & 1;
+		p.TwoSided = record.flags & 2;
+		p.Xscale = record.xscale;
+		p.Yscale = record.yscale;
+		p.Xoff = record.xoff;
+		p.Yoff = record.yoff;
+		p.Light = record.light;
+		p.Texture = record.texture >= 0 && (uint32_t)record.texture < header_.textures.count ? &textureNames_[record.texture] : nullptr;
+		p.SetVertices(&tile->mesh, record.firstIndex, record.numVertices);
+		p.normal = record.normal;
+		p.centroid = record.centroid;
+		p.SetBox(record.min, record.max);
+
+		if (record.texture >= 0 && (uint32_t)record.texture < header_.textures.count)
+			tile->textures.push_back(record.texture);
+	}
+
+	sort(tile->textures.begin(), tile->textures.end());
+	tile->textures.erase(unique(tile->textures.begin(), tile->textures.end()), tile->textures.end());
+
+	tile->bytes = TileBytes(entry, hasUVs);
+
+	return tile.release();
+}
+
+// Make a tile resident. Must be called on the thread that owns the textures.
+void LevelStream::Install(unsigned int index, unique_ptr<LevelTile> tile)
+{
+	for (unsigned int i = 0; i < tile->textures.size(); i++)
+	{
+		unsigned int texture = tile->textures[i];
+
+		if (textureUsers_[texture]++ == 0)
+		{
+			textureBytes_[texture] = loadTexture_(TextureName(texture), TextureFiltering(texture));
+			residentBytes_ += textureBytes_[texture];
+			largestTexture_ = max(largestTexture_, textureBytes_[texture]);
+		}
+	}
+
+	residentBytes_ += tile->bytes;
+	slots_[index].tile = move(tile);
+	resident_.push_back(index);
+}
+
+void LevelStream::Evict(unsigned int index)
+{
+	TileSlot& slot = slots_[index];
+
+	for (unsigned int i = 0; i < slot.tile->textures.size(); i++)
+	{
+		unsigned int texture = slot.tile->textures[i];
+
+		if (--textureUsers_[texture] == 0)
+		{
+			unloadTexture_(TextureName(texture));
+			residentBytes_ -= textureBytes_[texture];
+		}
+	}
+
+	residentBytes_ -= slot.tile->bytes;
+	slot.tile.reset();
+	resident_.erase(find(resident_.begin(), resident_.end(), index));
+}
+
+// Counted the same way as when the tile is installed
+size_t LevelStream::Cost(unsigned int index)
+{
+	const TiledFileTile& entry = tiles_[index];
+	TileSlot& slot = slots_[index];
+
+	if (!slot.scanned)
+	{
+		// The planes are right at the beginning of the tile
+		const LevelFilePlane* records = GetSection<LevelFilePlane>(file_, {entry.offset, entry.numPlanes});
+
+		for (unsigned int i = 0; i < entry.numPlanes; i++)
+		{
+			if (records[i].texture >= 0 && (uint32_t)records[i].texture < header_.textures.count)
+				slot.textures.push_back(records[i].texture);
+		}
+
+		sort(slot.textures.begin(), slot.textures.end());
+		slot.textures.erase(unique(slot.textures.begin(), slot.textures.end()), slot.textures.end());
+		slot.scanned = true;
+	}
+
+	size_t cost = TileBytes(entry, header_.flags & LEVELFILE_UVS);
+
+	for (unsigned int i = 0; i < slot.textures.size(); i++)
+	{
+		unsigned int texture = slot.textures[i];
+
+		if (textureUsers_[texture] == 0)
+			cost += textureBytes_[texture] > 0 ? textureBytes_[texture] : largestTexture_;
+	}
+
+	return cost;
+}
+
+// Load a tile in the background
+void LevelStream::Request(unsigned int index)
+{
+	TileSlot& slot = slots_[index];
+	slot.cost = Cost(index);
+	requestedBytes_ += slot.cost;
+
+	slot.pending = loader_.Submit([this, index]()
+	{
+		slots_[index].loading.reset(ReadTile(index));
+	});
+}
+
+// Distance from a point to the box of a tile in 2D. Zero if the point is inside the box.
+static float BoxDistance(const TiledFileTile& entry, const Float3& point)
+{
+	float dx = max(max(entry.min.x - point.x, point.x - entry.max.x), 0.0f);
+	float dy = max(max(entry.min.y - point.y, point.y - entry.max.y), 0.0f);
+	return sqrt(dx * dx + dy * dy);
+}
+
+float LevelStream::Distance(unsigned int index, const vector<Float3>& points) const
+{
+	float nearest = numeric_limits<float>::max();
+
+	for (unsigned int i = 0; i < points.size(); i++)
+	{
+		nearest = min(nearest, BoxDistance(tiles_[index], points[i]));
+	}
+
+	return nearest;
+}
+
+// Find every non-empty tile that is closer than 'radius' to one of the points. The result is sorted.
+void LevelStream::FindTiles(const vector<Float3>& points, float radius, vector<unsigned int>& found) const
+{
+	found.clear();
+
+	// A plane can go a bit outside of its tile
+	const float reach = radius + header_.overhang;
+
+	for (unsigned int i = 0; i < points.size(); i++)
+	{
+		int x1 = max((int)floor((points[i].x - reach - header_.originX) / header_.tileSize), 0);
+		int x2 = min((int)floor((points[i].x + reach - header_.originX) / header_.tileSize), (int)header_.columns - 1);
+		int y1 = max((int)floor((points[i].y - reach - header_.originY) / header_.tileSize), 0);
+		int y2 = min((int)floor((points[i].y + reach - header_.originY) / header_.tileSize), (int)header_.rows - 1);
+
+		for (int y = y1; y <= y2; y++)
+		{
+			for (int x = x1; x <= x2; x++)
+			{
+				unsigned int index = y * header_.columns + x;
+
+				if (tiles_[index].numPlanes > 0 && BoxDistance(tiles_[index], points[i]) <= radius)
+					found.push_back(index);
+			}
+		}
+	}
+
+	sort(found.begin(), found.end());
+	found.erase(unique(found.begin(), found.end()), found.end());
+}
+
+bool LevelStream::Update(const vector<Float3>& points)
+{
+	// Tiles that finished loading in the background
+	for (unsigned int i = 0; i < slots_.size(); i++)
+	{
+		TileSlot& slot = slots_[i];
+
+		if (slot.pending.valid() && slot.pending.wait_for(chrono::seconds(0)) == future_status::ready)
+		{
+			slot.pending.get();	// Rethrows errors from the worker
+			requestedBytes_ -= slot.cost;
+			Install(i, move(slot.loading));
+		}
+	}
+
+	// The active tiles only depend on the position of the players. This way, the game
+	// sees the same planes no matter how fast the tiles were loaded.
+	vector<unsigned int> wanted;
+	FindTiles(points, radius_, wanted);
+	bool changed = wanted != active_;
+
+	for (unsigned int i = 0; i < active_.size(); i++)
+	{
+		slots_[active_[i]].active = false;
+	}
+
+	for (unsigned int i = 0; i < wanted.size(); i++)
+	{
+		TileSlot& slot = slots_[wanted[i]];
+		slot.active = true;
+
+		if (!slot.tile)
+		{
+			if (slot.pending.valid())
+			{
+				// Too late, wait for it
+				slot.pending.get();
+				requestedBytes_ -= slot.cost;
+				Install(wanted[i], move(slot.loading));
+			}
+			else
+			{
+				Install(wanted[i], unique_ptr<LevelTile>(ReadTile(wanted[i])));
+			}
+		}
+	}
+
+	active_ = wanted;
+
+	// Load the next tiles before the players get there
+	vector<unsigned int> nearby;
+	FindTiles(points, radius_ * 2, nearby);
+
+	for (unsigned int i = 0; i < nearby.size(); i++)
+	{
+		TileSlot& slot = slots_[nearby[i]];
+
+		if (!slot.tile && !slot.pending.valid() && residentBytes_ + requestedBytes_ + Cost(nearby[i]) <= budget_ * PREFETCH_BUDGET)
+			Request(nearby[i]);
+	}
+
+	// Evict the farthest tiles that are not active
+	while (residentBytes_ > budget_)
+	{
+		int farthest = -1;
+		float distance = -1;
+
+		for (unsigned int i = 0; i < resident_.size(); i++)
+		{
+			if (!slots_[resident_[i]].active)
+			{
+				float d = Distance(resident_[i], points);
+				if (d > distance)
+				{
+					distance = d;
+					farthest = resident_[i];
+				}
+			}
+		}
+
+		if (farthest < 0)
+		{
+			if (!warned_)
+			{
+				LogError() << "WARNING: The active tiles use " << residentBytes_ / 1024 << " KB, which is more than the budget of "
+					<< budget_ / 1024 << " KB." << endl;
+				warned_ = true;
+			}
+			break;
+		}
+
+		Evict(farthest);
+	}
+
+	return changed;
+}
+
+void LevelStream::GetActivePlanes(vector<Plane*>& planes) const
+{
+	vector<pair<unsigned int, Plane*>> sorted;
+
+	for (unsigned int i = 0; i < active_.size(); i++)
+	{
+		LevelTile* tile = slots_[active_[i]].tile.get();
+
+		for (unsigned int j = 0; j < tile->planes.size(); j++)
+		{
+			sorted.push_back({tile->levelIndices[j], &tile->planes[j]});
+		}
+	}
+
+	sort(sorted.begin(), sorted.end());
+
+	planes.clear();
+	for (unsigned int i = 0; i < sorted.size(); i++)
+	{
+		planes.push_back(sorted[i].second);
+	}
+}
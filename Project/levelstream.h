@@ -0,0 +1,126 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// levelstream.h
+// Streams the tiles of a tiled level. Tiles close to the players are active and are
+// the only ones that the game can see. The next ones are loaded in the background and
+// the farthest ones are evicted when the memory budget is exceeded.
+
+#ifndef LEVELSTREAM_H
+#define LEVELSTREAM_H
+
+#include "levelfile.h"	/* TiledFileHeader */
+#include "mapfile.h"	/* MappedFile */
+#include "plane.h"	/* Plane, PlaneMesh */
+#include "threadpool.h"	/* ThreadPool */
+#include "vecmath.h"	/* Float3 */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <functional>
+#include <cstddef>
+using namespace std;
+
+struct LevelTile
+{
+	vector<Plane> planes;
+	vector<unsigned int> levelIndices;	// Index of each plane in the whole level. Keeps the planes in the same order.
+	vector<unsigned int> textures;	// Textures used by the planes
+	PlaneMesh mesh;
+	size_t bytes = 0;
+};
+
+class LevelStream
+{
+public:
+	// Textures are loaded and unloaded on the thread that calls Update()
+	typedef function<size_t(const string& name, bool filtering)> TextureLoader;	// Returns the size of the texture
+	typedef function<void(const string& name)> TextureUnloader;
+
+	LevelStream(const string& path, TextureLoader load, TextureUnloader unload);
+	~LevelStream();
+
+	LevelStream(const LevelStream&) = delete;
+	LevelStream& operator=(const LevelStream&) = delete;
+
+	const TiledFileHeader& Header() const;
+	string String(int32_t offset) const;
+	string TextureName(int32_t index) const;	// Empty if invalid
+	bool TextureFiltering(unsigned int index) const;
+	const LevelFileThing* Things() const;
+
+	void SetBudget(size_t bytes);
+	void SetRadius(float radius);	// Tiles closer than this to a point are active
+
+	// Make the tiles around the points active. Waits for the active tiles that are not loaded yet.
+	// Returns true if the active tiles changed.
+	bool Update(const vector<Float3>& points);
+
+	// Planes of the active tiles, in the same order as in the level
+	void GetActivePlanes(vector<Plane*>& planes) const;
+
+	size_t ResidentBytes() const;
+	unsigned int ResidentTiles() const;
+
+private:
+	struct TileSlot
+	{
+		unique_ptr<LevelTile> tile;	// Resident data
+		unique_ptr<LevelTile> loading;	// Only used by the worker until 'pending' is ready
+		future<void> pending;
+		size_t cost = 0;	// Memory that was counted for the tile while it loads
+		vector<unsigned int> textures;	// Used by the tile. Only read from the file when it's needed.
+		bool scanned = false;	// The textures are known
+		bool active = false;
+	};
+
+	MappedFile file_;
+	TiledFileHeader header_;
+	const char* strings_ = nullptr;
+	const LevelFileTexture* textures_ = nullptr;
+	const LevelFileThing* things_ = nullptr;
+	const TiledFileTile* tiles_ = nullptr;
+
+	vector<TileSlot> slots_;
+	vector<unsigned int> resident_;	// Slots that have a tile
+	vector<unsigned int> active_;	// Slots that are active, sorted
+
+	TextureLoader loadTexture_;
+	TextureUnloader unloadTexture_;
+	vector<unsigned int> textureUsers_;	// Number of resident tiles that use each texture
+	vector<size_t> textureBytes_;
+	vector<string> textureNames_;	// Never resized after the constructor
+
+	size_t budget_ = 512 * 1024 * 1024;
+	size_t residentBytes_ = 0;
+	size_t requestedBytes_ = 0;	// Tiles that are loading in the background
+	size_t largestTexture_ = 0;	// Used as the size of the textures that were never loaded
+	float radius_;
+	bool warned_ = false;
+
+	ThreadPool loader_;	// Must be the last member so it stops before the slots are destroyed
+
+	LevelTile* ReadTile(unsigned int index) const;
+	void Install(unsigned int index, unique_ptr<LevelTile> tile);
+	void Evict(unsigned int index);
+	void Request(unsigned int index);
+	size_t Cost(unsigned int index);	// Memory that the tile would add if it was installed
+	float Distance(unsigned int index, const vector<Float3>& points) const;	// To the closest point
+	void FindTiles(const vector<Float3>& points, float radius, vector<unsigned int>& found) const;
+};
+
+#endif	// LEVELSTREAM_H
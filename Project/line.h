@@ -17,9 +17,12 @@
 // Line/Circle collision code
 // Source: https://github.com/jeffThompson/CollisionDetection/blob/master/CodeExamples/LineCircle/LineCircle.pde
 
+#ifndef LINE_H
+#define LINE_H
+
 #include <cmath>
 
-float dist(float x1, float y1, float x2, float y2)
+inline float dist(float x1, float y1, float x2, float y2)
 {
 	float distX = x1 - x2;
 	float distY = y1 - y2;
@@ -28,7 +31,7 @@ float dist(float x1, float y1, float x2, float y2)
 }
 
 // POINT/CIRCLE
-bool pointCircle(float px, float py, float cx, float cy, float r) {
+inline bool pointCircle(float px, float py, float cx, float cy, float r) {
 
 	// get distance between the point and circle's center
 	// using the Pythagorean Theorem
@@ -45,7 +48,7 @@ bool pointCircle(float px, float py, float cx, float cy, float r) {
 }
 
 // LINE/POINT
-bool linePoint(float x1, float y1, float x2, float y2, float px, float py) {
+inline bool linePoint(float x1, float y1, float x2, float y2, float px, float py) {
 
 	// get distance from the point to the two ends of the line
 	float d1 = dist(px, py, x1, y1);
@@ -70,7 +73,7 @@ bool linePoint(float x1, float y1, float x2, float y2, float px, float py) {
 
 
 // LINE/CIRCLE
-bool lineCircle(float x1, float y1, float x2, float y2, float cx, float cy, float r) {
+inline bool lineCircle(float x1, float y1, float x2, float y2, float cx, float cy, float r) {
 
 	// is either end INSIDE the circle?
 	// if so, return true immediately
@@ -108,3 +111,5 @@ bool lineCircle(float x1, float y1, float x2, float y2, float cx, float cy, floa
 	}
 	return false;
 }
+
+#endif	// LINE_H
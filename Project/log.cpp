@@ -0,0 +1,49 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// log.cpp
+// Where the messages of the levels are written
+
+#include "log.h"
+
+#include <iostream>	/* cout, cerr */
+using namespace std;
+
+static thread_local ostream* threadOut = nullptr;
+static thread_local ostream* threadErr = nullptr;
+
+ostream& Log()
+{
+	return threadOut ? *threadOut : cout;
+}
+
+ostream& LogError()
+{
+	return threadErr ? *threadErr : cerr;
+}
+
+ThreadLog::ThreadLog(ostream& out, ostream& err): out_(threadOut), err_(threadErr)
+{
+	threadOut = &out;
+	threadErr = &err;
+}
+
+ThreadLog::~ThreadLog()
+{
+	// The streams that were used before
+	threadOut = out_;
+	threadErr = err_;
+}
@@ -0,0 +1,46 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// log.h
+// Where the messages of the levels are written. Each thread has its own streams,
+// so a thread can silence them without touching the others.
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <ostream>
+using namespace std;
+
+// The streams of the current thread. They are cout and cerr unless the thread changes them.
+ostream& Log();
+ostream& LogError();
+
+// Changes the streams of the current thread until it's destroyed
+class ThreadLog
+{
+public:
+	ThreadLog(ostream& out, ostream& err);
+	~ThreadLog();
+
+	ThreadLog(const ThreadLog&) = delete;
+	ThreadLog& operator=(const ThreadLog&) = delete;
+
+private:
+	ostream* out_;
+	ostream* err_;
+};
+
+#endif	// LOG_H
@@ -0,0 +1,178 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// lz.cpp
+// Each sequence has a token (number of literals and length of the match), the literals,
+// then the offset of the match. The last sequence only has literals.
+
+#include "lz.h"
+
+#include <vector>
+#include <cstring>	/* memcpy */
+#include <cstdint>
+#include <stdexcept>
+using namespace std;
+
+const unsigned int LZ_MIN_MATCH = 4;
+const unsigned int LZ_HASH_BITS = 12;
+const size_t LZ_MAX_OFFSET = 65535;
+
+// The format requires the last bytes to be literals
+const size_t LZ_LAST_LITERALS = 5;
+const size_t LZ_MATCH_LIMIT = 12;	// No match starts in the last bytes
+
+static uint32_t Read32(const unsigned char* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static unsigned int Hash(uint32_t sequence)
+{
+	return (sequence * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+// Lengths that don't fit in the token are followed by bytes of 255 and the rest
+static void WriteLength(vector<unsigned char>& out, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		out.push_back(255);
+
+	out.push_back(length);
+}
+
+static void WriteSequence(vector<unsigned char>& out, const unsigned char* literals, size_t count, size_t offset, size_t match)
+{
+	size_t extra = match >= LZ_MIN_MATCH ? match - LZ_MIN_MATCH : 0;
+	out.push_back((count < 15 ? count : 15) << 4 | (extra < 15 ? extra : 15));
+
+	if (count >= 15)
+		WriteLength(out, count - 15);
+
+	out.insert(out.end(), literals, literals + count);
+
+	if (match == 0)
+		return;
+
+	out.push_back(offset);
+	out.push_back(offset >> 8);
+
+	if (extra >= 15)
+		WriteLength(out, extra - 15);
+}
+
+void LzCompress(const unsigned char* data, size_t size, vector<unsigned char>& out)
+{
+	// Position + 1 of the last sequence of 4 bytes that had each hash
+	uint32_t table[1 << LZ_HASH_BITS] = {};
+
+	size_t anchor = 0;	// First literal that's not written
+	size_t pos = 0;
+
+	while (size > LZ_MATCH_LIMIT && pos < size - LZ_MATCH_LIMIT)
+	{
+		uint32_t sequence = Read32(data + pos);
+		unsigned int hash = Hash(sequence);
+		size_t candidate = table[hash];
+		table[hash] = pos + 1;
+
+		if (candidate == 0 || pos - (candidate - 1) > LZ_MAX_OFFSET || Read32(data + candidate - 1) != sequence)
+		{
+			pos++;
+			continue;
+		}
+
+		candidate--;
+
+		// Extend the match as far as possible
+		size_t match = LZ_MIN_MATCH;
+		while (pos + match < size - LZ_LAST_LITERALS && data[candidate + match] == data[pos + match])
+			match++;
+
+		WriteSequence(out, data + anchor, pos - anchor, pos - candidate, match);
+		pos += match;
+		anchor = pos;
+	}
+
+	WriteSequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+// A length from a token and the bytes after it
+static size_t ReadLength(const unsigned char*& pos, const unsigned char* end, size_t length)
+{
+	if (length < 15)
+		return length;
+
+	unsigned char byte;
+	do
+	{
+		if (pos >= end)
+			throw runtime_error("Compressed data is incomplete.");
+
+		byte = *pos++;
+		length += byte;
+	}
+	while (byte == 255);
+
+	return length;
+}
+
+void LzDecompress(const unsigned char* data, size_t compressed, vector<unsigned char>& out, size_t size)
+{
+	const unsigned char* pos = data;
+	const unsigned char* end = data + compressed;
+
+	out.resize(size);
+	unsigned char* dest = out.data();
+	size_t written = 0;
+
+	while (pos < end)
+	{
+		unsigned char token = *pos++;
+
+		size_t literals = ReadLength(pos, end, token >> 4);
+		if (literals > (size_t)(end - pos) || literals > size - written)
+			throw runtime_error("Compressed data is damaged.");
+
+		memcpy(dest + written, pos, literals);
+		pos += literals;
+		written += literals;
+
+		// The last sequence has no match
+		if (pos == end)
+			break;
+
+		if (end - pos < 2)
+			throw runtime_error("Compressed data is incomplete.");
+
+		size_t offset = pos[0] | pos[1] << 8;
+		pos += 2;
+
+		size_t match = ReadLength(pos, end, token & 15) + LZ_MIN_MATCH;
+		if (offset == 0 || offset > written || match > size - written)
+			throw runtime_error("Compressed data is damaged.");
+
+		// The match can overlap the bytes that it writes
+		const unsigned char* from = dest + written - offset;
+		for (size_t i = 0; i < match; i++)
+			dest[written + i] = from[i];
+
+		written += match;
+	}
+
+	if (written != size)
+		throw runtime_error("Compressed data has the wrong size.");
+}
@@ -0,0 +1,33 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// lz.h
+// A small and fast LZ77 compressor. The compressed blocks use the format of LZ4 blocks,
+// so they can also be read and written by the LZ4 library.
+
+#ifndef LZ_H
+#define LZ_H
+
+#include <vector>
+#include <cstddef>
+using namespace std;
+
+// Append the compressed bytes to 'out'
+void LzCompress(const unsigned char* data, size_t size, vector<unsigned char>& out);
+
+// 'size' is the number of bytes before compression. Throws if the data is damaged.
+void LzDecompress(const unsigned char* data, size_t compressed, vector<unsigned char>& out, size_t size);
+
+#endif	// LZ_H
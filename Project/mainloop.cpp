@@ -16,6 +16,7 @@
 // mainloop.cpp
 // The main stuff is here, like the game loop and initialization.
 
+#include "mainloop.h"
 #include "viewdraw.h"
 #include "command.h"
 #include "actor.h"
@@ -28,6 +29,19 @@
 #include "network.h"
 #include "strutils.h"	/* Split */
 #include "bot.h"
+#include "rollback.h"	/* Rollback */
+#include "gamestate.h"	/* Checksum, TicChecksum */
+#include "netbench.h"	/* NetBenchmark */
+#include "spectator.h"	/* Broadcast, Spectator */
+#include "timedemo.h"	/* TicProfiler */
+#include "texture.h"	/* Texture::SetHeadless */
+#include "ticcmd.h"	/* Ticcmd */
+#include "demo.h"	/* DemoReader, DemoWriter */
+#include "verify.h"	/* VerifyDemos */
+#include "navmesh.h"	/* NavMesh */
+#include "levelfile.h"	/* IsTiledLevel */
+#include "botscheduler.h"	/* BotScheduler */
+#include "botbench.h"	/* BotBenchmark */
 
 #include <GLFW/glfw3.h>
 #include <GL/gl.h>
@@ -39,8 +53,99 @@
 #include <cstdlib>		/* EXIT_FAILURE, EXIT_SUCCESS */
 #include <fstream>
 #include <chrono>
+#include <memory>	/* unique_ptr */
 using namespace std;
 
+// Move the players and update the things for one tic. Each phase is timed if there's a profiler.
+void PlayTic(Level* lvl, TicProfiler* profiler)
+{
+	// Bring the tiles around the players
+	lvl->UpdateStreaming();
+
+	if (profiler)
+		profiler->Lap(PHASE_STREAMING);
+
+	// Update game logic
+	for (unsigned int i = 0; i < lvl->players.size(); i++)
+	{
+		// Save player's position and the execute the tic command
+		Float3 pt = lvl->players[i]->pos_;
+		lvl->players[i]->ExecuteTick();
+
+		if (profiler)
+			profiler->Lap(PHASE_MOVEMENT);
+
+		// Collision detection with floors and walls
+		if (!NewPositionIsValid(lvl->players[i], lvl))
+		{
+			// Compute the position where the player would be if he slide against the wall
+			Float2 pos = MoveOnCollision(pt, lvl->players[i]->pos_, lvl->players[i], lvl);
+
+			// Move the player back to its original position
+			// TODO: Shouldn't any 'momentum' be cancelled?
+			lvl->players[i]->pos_ = pt;
+
+			// Try to slide the player against the walls to a valid position
+			if (NewPositionIsValid(lvl->players[i], lvl))
+			{
+				// Make sure the walls didn't push the player inside other players
+				if (!PlayerToPlayersCollision(lvl->players[i], lvl->players))
+				{
+					// Set the new position
+					lvl->players[i]->pos_.x = pos.x;
+					lvl->players[i]->pos_.y = pos.y;
+				}
+				else
+				{
+					// TODO: Shouldn't any 'momentum' be cancelled?
+					lvl->players[i]->pos_ = pt;
+				}
+			}
+		}
+
+		// Player to player collision check
+		if (PlayerToPlayersCollision(lvl->players[i], lvl->players))
+		{
+			for (unsigned int j = 0; j < lvl->players.size(); j++)
+			{
+				if (lvl->players[i] != lvl->players[j])
+				{
+					// Execute Player to player collision
+					lvl->players[i]->pos_ = PlayerToPlayerCollisionReact(lvl->players[i], lvl->players[j]);
+					// Check if there's a collision between players
+					if (PlayerToPlayerCollision(lvl->players[i], lvl->players[j]) ||
+						!NewPositionIsValid(lvl->players[i], lvl))
+					{
+						// Restore original position
+						lvl->players[i]->pos_ = pt;
+					}
+				}
+			}
+		}
+
+		// Adjust height
+		AdjustPlayerToFloor(lvl->players[i], lvl);
+
+		if (profiler)
+			profiler->Lap(PHASE_COLLISION);
+
+		// Handle fire here to avoid circular inclusion/dependecy with 'Level' in the Player class
+		if (lvl->players[i]->ShouldFire)
+		{
+			Hitscan(lvl, lvl->players[i], lvl->players);
+			lvl->players[i]->ShouldFire = false;
+
+			if (profiler)
+				profiler->Lap(PHASE_HITSCAN);
+		}
+	}
+
+	lvl->UpdateThings();
+
+	if (profiler)
+		profiler->Lap(PHASE_THINGS);
+}
+
 int mainloop(int argc, const char* argv[])
 {
 	const char* const VERSION = "0.59 (dev)";
@@ -48,8 +153,9 @@ int mainloop(int argc, const char* argv[])
 	bool Quit = false;
 	static unsigned int TicCount = 0;
 	bool Debug = false;
-	ofstream DemoWrite;
-	ifstream DemoRead;
+	unique_ptr<DemoWriter> DemoWrite;
+	unique_ptr<DemoReader> DemoRead;
+	string RecordName;	// The demo is created once the level is loaded
 	unsigned int FrameDelay = 0;
 	string LevelName = "test.txt";
 	bool Fast = false;	// To unlock the speed of the game
@@ -57,6 +163,11 @@ int mainloop(int argc, const char* argv[])
 	extern GameWindow view;
 	Network network;
 	int numOfPlayers = 1;
+	bool DemoChecksums = false;	// The demo has the checksum of each tic
+	bool Desynced = false;
+	unique_ptr<Broadcast> Spectators;	// Sends the game to spectators
+	unique_ptr<Spectator> Watch;	// Watches a game instead of playing
+	Checksum WatchedSum;	// Of the game that's watched, after the last tic
 
 	cout << "                MESHGLIDE ENGINE -- " << VERSION << "\n\n";
 
@@ -74,55 +185,111 @@ int mainloop(int argc, const char* argv[])
 		Fast = true;
 	}
 
+	if (FindArgumentPosition(argc, argv, "-netbench") > 0)
+	{
+		// Measure the network code. There's no window and no level.
+		NetBenchSettings bench;
+		bench.clients = stoi(FindArgumentParameter(argc, argv, "-netbench", "7"));
+		bench.tics = stoi(FindArgumentParameter(argc, argv, "-benchtics", "2000"));
+		bench.delay = stoi(FindArgumentParameter(argc, argv, "-inputdelay", "2"));
+		bench.transport = FindArgumentParameter(argc, argv, "-transport", "inproc");
+		bench.demo = FindArgumentParameter(argc, argv, "-playdemo");
+		bench.rate = stoi(FindArgumentParameter(argc, argv, "-benchrate", "0"));
+		bench.loss = stof(FindArgumentParameter(argc, argv, "-netloss", "0")) / 100;
+		bench.latency = stoi(FindArgumentParameter(argc, argv, "-netlag", "0"));
+
+		if (bench.clients < 1 || bench.clients >= MAX_PLAYERS || bench.delay > 60 || bench.loss < 0 || bench.loss > 0.9f)
+		{
+			throw runtime_error("Invalid network benchmark settings.");
+		}
+
+		return NetBenchmark(bench) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (FindArgumentPosition(argc, argv, "-verify") > 0)
+	{
+		// Play many demos at the same time without a window and compare how each one ends with its golden hash
+		VerifySettings verify;
+		verify.demos = FindArgumentParameter(argc, argv, "-verify", ".");
+		verify.golden = FindArgumentParameter(argc, argv, "-golden");
+		verify.update = FindArgumentPosition(argc, argv, "-updategolden") > 0;
+		verify.threads = stoi(FindArgumentParameter(argc, argv, "-threads", "0"));
+		verify.scale = stof(FindArgumentParameter(argc, argv, "-scale", "1.0"));
+
+		return VerifyDemos(verify) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (FindArgumentPosition(argc, argv, "-botbench") > 0)
+	{
+		// Measure how long the bots take to think. There's no window.
+		BotBenchSettings bench;
+		bench.bots = stoi(FindArgumentParameter(argc, argv, "-botbench", "1000"));
+		bench.level = FindArgumentParameter(argc, argv, "-level", "citadel.txt");
+		bench.tics = stoi(FindArgumentParameter(argc, argv, "-benchtics", "100"));
+		bench.threads = stoi(FindArgumentParameter(argc, argv, "-threads", "0"));
+		bench.scale = stof(FindArgumentParameter(argc, argv, "-scale", "1.0"));
+
+		if (bench.bots < 1 || bench.tics < 1)
+		{
+			throw runtime_error("Invalid bot benchmark settings.");
+		}
+
+		BotBenchmark(bench);
+		return EXIT_SUCCESS;
+	}
+
 	/****************************** DEMO FILES ******************************/
 
-	string DemoName = FindArgumentParameter(argc, argv, "-playdemo");
+	// Play a demo as fast as possible and measure each part of the tics. The screen is only drawn with -render.
+	bool Timedemo = FindArgumentPosition(argc, argv, "-timedemo") > 0;
+	bool Render = !Timedemo || FindArgumentPosition(argc, argv, "-render") > 0;
+
+	// Levels are converted without a window, so it works on a computer without a display
+	if (FindArgumentPosition(argc, argv, "-compile") > 0)
+		Render = false;
+
+	string DemoName = FindArgumentParameter(argc, argv, Timedemo ? "-timedemo" : "-playdemo");
 	if (!DemoName.empty())
 	{
 		cout << "Playing demo: " << DemoName << endl;
-		DemoRead.open(DemoName);
-		if (!DemoRead.is_open())
-		{
-			throw runtime_error("Could not open demo '" + DemoName + "'");
-		}
+		DemoRead.reset(new DemoReader(DemoName));
 	}
 	else
 	{
 		Fast = false;	// Must be false if not playing a demo. It's reserved for demo playback and benchmarking.
 
 		// Playing a demo has priority over recording a demo
-		DemoName = FindArgumentParameter(argc, argv, "-record");
-		if (!DemoName.empty())
+		RecordName = FindArgumentParameter(argc, argv, "-record");
+		if (!RecordName.empty())
 		{
-			cout << "Recoring demo: " << DemoName << endl;
-			DemoWrite.open(DemoName);
-			if (!DemoWrite.is_open())
-			{
-				throw runtime_error("Could not open file '" + DemoName + "' to write");
-			}
+			cout << "Recoring demo: " << RecordName << endl;
 		}
 	}
 
-	if (DemoRead.is_open())
+	if (DemoRead)
 	{
-		string line;
-		getline(DemoRead, line);
-		cout << "Demo Version: " << line << endl;
+		const DemoInfo& info = DemoRead->Info();
+		cout << "Demo Version: " << info.version << endl;
 
-		if (string(VERSION) != line)
+		if (string(VERSION) != info.version)
 		{
 			cout << "Demo is from a different version. A desync may occur." << endl;
 		}
 
-		getline(DemoRead, line);
-		LevelName = line;
-		cout << "Level name: " << line << endl;
-		getline(DemoRead, line);
-		SetIndex(stoi(line));		// Randomization
-		cout << "Seed: " << line << endl;
-		getline(DemoRead, line);
-		numOfPlayers = stoi(line);
-		cout << "# of players: " << line << endl;
+		LevelName = info.level;
+		cout << "Level name: " << info.level << endl;
+		SetIndex(info.seed);		// Randomization
+		cout << "Seed: " << info.seed << endl;
+		numOfPlayers = info.players;
+		cout << "# of players: " << info.players << endl;
+
+		// Newer demos have a checksum after each tic
+		DemoChecksums = info.checksums;
+
+		if (DemoRead->Keyframes() > 0)
+		{
+			cout << "Keyframes: " << DemoRead->Keyframes() << ", one every " << info.interval << " tics" << endl;
+		}
 	}
 	else
 	{
@@ -156,7 +323,7 @@ int mainloop(int argc, const char* argv[])
 
 	/****************************** NETWORKING ******************************/
 
-	if (!DemoRead.is_open())
+	if (!DemoRead)
 	{
 		string hostport;
 		if (FindArgumentPosition(argc, argv, "-host") > 0)
@@ -166,12 +333,28 @@ int mainloop(int argc, const char* argv[])
 		if (FindArgumentPosition(argc, argv, "-connect") > 0)
 			serverloc = FindArgumentParameter(argc, argv, "-connect", "localhost:5555");
 
+		string watchloc;
+		if (FindArgumentPosition(argc, argv, "-spectate") > 0)
+			watchloc = FindArgumentParameter(argc, argv, "-spectate", "localhost:5556");
+
 		if (!hostport.empty())
 		{
-			numOfPlayers = 2;	// (for now, it's always two players)
+			numOfPlayers = stoi(FindArgumentParameter(argc, argv, "-players", "2"));
+			if (numOfPlayers < 2 || numOfPlayers > (int)MAX_PLAYERS)
+			{
+				throw runtime_error("The number of players must be between 2 and " + to_string(MAX_PLAYERS) + ".");
+			}
+
+			// Commands are used this many tics after they are sent. Hides the latency of the network.
+			int delay = stoi(FindArgumentParameter(argc, argv, "-inputdelay", "2"));
+			if (delay < 0 || delay > 60)
+			{
+				throw runtime_error("The input delay must be between 0 and 60 tics.");
+			}
+
 			// Start a server
 			string info = LevelName + '\n' + to_string(initialIndex) + '\n' + to_string(numOfPlayers);
-			network.startServer(hostport, info);
+			network.startServer(hostport, info, numOfPlayers, delay);
 		}
 		else if (!serverloc.empty())
 		{
@@ -183,19 +366,76 @@ int mainloop(int argc, const char* argv[])
 			SetIndex(initialIndex = stoi(infos[1]));
 			numOfPlayers = stoi(infos[2]);
 		}
+		else if (!watchloc.empty())
+		{
+			// Or watch a game. It's joined at its latest keyframe.
+			Watch.reset(new Spectator());
+			vector<string> infos = Split(Watch->Connect(watchloc, network.TIMEOUT), '\n');
+			if (infos.size() < 3)
+			{
+				throw runtime_error("Invalid game received from '" + watchloc + "'");
+			}
+
+			LevelName = infos[0];
+			numOfPlayers = stoi(infos[2]);
+
+			if (!RecordName.empty())
+			{
+				// The game started before the spectator joined
+				cout << "Demos can't be recorded while watching a game." << endl;
+				RecordName.clear();
+			}
+		}
+
+		// Test how the game plays on a bad network
+		if (network.enabled())
+		{
+			network.simulate(stof(FindArgumentParameter(argc, argv, "-netloss", "0")) / 100, stoi(FindArgumentParameter(argc, argv, "-netlag", "0")));
+		}
+
+		// Any player can broadcast the game. A keyframe is sent every few seconds so spectators can join late.
+		if (network.enabled() && FindArgumentPosition(argc, argv, "-spectators") > 0)
+		{
+			string info = LevelName + '\n' + to_string(initialIndex) + '\n' + to_string(numOfPlayers);
+			Spectators.reset(new Broadcast(FindArgumentParameter(argc, argv, "-spectators", "5556"), info,
+				(unsigned int)(stof(FindArgumentParameter(argc, argv, "-keyframe", "10")) * 60)));
+		}
+	}
+
+	// Bots are added after the other players. Only for local games because their commands are not sent.
+	int NumBots = stoi(FindArgumentParameter(argc, argv, "-bots", "0"));
+	if (NumBots > 0 && (DemoRead || !RecordName.empty() || network.enabled() || Watch))
+	{
+		cout << "Bots are disabled in demos and network games." << endl;
+		NumBots = 0;
+	}
+	else if (NumBots < 0)
+	{
+		throw runtime_error("Invalid number of bots.");
 	}
 
+	numOfPlayers += NumBots;
+
 	/****************************** OPENGL HANDLING ******************************/
 
-	// Load OpenGL
-	GLFWwindow* window = Init_OpenGL(FindArgumentPosition(argc, argv, "-fullscreen") > 0, "MeshGlide v" + string(VERSION));
+	// Load OpenGL. There's no window if nothing is drawn.
+	GLFWwindow* window = nullptr;
 
-	if (!window)
+	if (Render)
 	{
-		throw runtime_error("Could not create OpenGL window!");
+		window = Init_OpenGL(FindArgumentPosition(argc, argv, "-fullscreen") > 0, "MeshGlide v" + string(VERSION));
+
+		if (!window)
+		{
+			throw runtime_error("Could not create OpenGL window!");
+		}
+	}
+	else
+	{
+		Texture::SetHeadless(true);
 	}
 
-	if (FindArgumentPosition(argc, argv, "-wireframe") > 0)
+	if (window && FindArgumentPosition(argc, argv, "-wireframe") > 0)
 	{
 		cout << "_OpenGL: Wireframe mode activated." << endl;
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -210,17 +450,276 @@ int mainloop(int argc, const char* argv[])
 		throw runtime_error("Failed to load level '" + LevelName + "'");
 	}
 
+	if (FindArgumentPosition(argc, argv, "-compile") > 0)
+	{
+		// Convert the level to the compiled format, then quit
+		if (FindArgumentPosition(argc, argv, "-tiles") > 0)
+		{
+			// Tiled levels are streamed around the players
+			string TiledName = LevelName.substr(0, LevelName.find_last_of('.')) + ".mgt";
+			CurrentLevel->SaveTiled(FindArgumentParameter(argc, argv, "-compile", TiledName), stof(FindArgumentParameter(argc, argv, "-tiles", "32")));
+		}
+		else
+		{
+			string CompiledName = LevelName.substr(0, LevelName.find_last_of('.')) + ".mgl";
+			CurrentLevel->SaveCompiled(FindArgumentParameter(argc, argv, "-compile", CompiledName));
+		}
+
+		delete CurrentLevel;
+		if (window)
+			Close_OpenGL(window);
+		return EXIT_SUCCESS;
+	}
+
 	/****************************** SETUP PHASE ******************************/
 
+	// Reload the level when its file is saved. Only for local games because it changes the simulation.
+	bool WatchLevel = FindArgumentPosition(argc, argv, "-watch") > 0;
+	if (WatchLevel && (DemoRead || !RecordName.empty() || network.enabled() || Watch))
+	{
+		cout << "Level watching is disabled in demos and network games." << endl;
+		WatchLevel = false;
+	}
+
+	// Memory budget in MB and distance at which the tiles of a tiled level are used
+	CurrentLevel->SetStreaming(stoul(FindArgumentParameter(argc, argv, "-tilebudget", "512")) * 1024 * 1024,
+		stof(FindArgumentParameter(argc, argv, "-tileradius", "0")));
+
+	// The navmesh is saved next to the level, so it's only built again when the level changes
+	unique_ptr<NavMesh> Navigation;
+	bool UseNavMesh = FindArgumentPosition(argc, argv, "-navmesh") > 0 || NumBots > 0;
+	if (UseNavMesh && IsTiledLevel(LevelName))
+	{
+		cout << "Tiled levels don't have a navmesh." << endl;
+		UseNavMesh = false;
+	}
+
+	if (UseNavMesh)
+	{
+		Navigation.reset(new NavMesh(*CurrentLevel, LevelName + NAVMESH_EXTENSION));
+	}
+
+	// The bots think on every core
+	unique_ptr<BotScheduler> Bots;
+	if (NumBots > 0)
+	{
+		vector<uint32_t> BotPlayers;
+		for (int i = numOfPlayers - NumBots; i < numOfPlayers; i++)
+			BotPlayers.push_back(i);
+
+		Bots.reset(new BotScheduler(*CurrentLevel, BotPlayers, Navigation.get(), stoi(FindArgumentParameter(argc, argv, "-threads", "0"))));
+	}
+
 	CurrentLevel->play = CurrentLevel->players[network.myPlayer()];
 	CurrentLevel->play->Cmd.id = network.myPlayer();
 
-	if (DemoWrite.is_open())
+	// Play ahead of the network by guessing the commands of the other players
+	unique_ptr<Rollback> GameRollback;
+	if (network.enabled() && FindArgumentPosition(argc, argv, "-rollback") > 0)
+	{
+		GameRollback.reset(new Rollback(CurrentLevel, network.myPlayer(), stoi(FindArgumentParameter(argc, argv, "-rollback", "8")),
+			stof(FindArgumentParameter(argc, argv, "-rollbackbudget", "8")), [CurrentLevel]() { PlayTic(CurrentLevel); }));
+	}
+
+	// Nobody has input for the first tics of a network game
+	for (unsigned int i = 0; network.enabled() && i < network.delay(); i++)
+	{
+		network.sendCommand(CurrentLevel->play->CmdToNet());
+
+		if (GameRollback)
+			GameRollback->AddLocalCommand(CurrentLevel->play->CmdToNet());
+	}
+
+	// Commands of every player for the tic that arrived. Reused on every tic.
+	vector<vector<unsigned char>> NetCommands;
+
+	// Show the chat of the other players and find a player who quits
+	auto ReceivedTic = [&](const vector<vector<unsigned char>>& commands)
+	{
+		for (unsigned int i = 0; i < commands.size(); i++)
+		{
+			Ticcmd cmd;
+			cmd.Deserialize(commands[i]);
+
+			if ((i != network.myPlayer() || Watch) && cmd.chat.size() > 0)
+			{
+				ShowMessage(view, cmd.chat);
+			}
+
+			// Nothing after this tic is used
+			if (cmd.quit)
+			{
+				Quit = true;
+			}
+		}
+	};
+
+	// Compare the game with the demo and the other players after a tic, and record its checksum
+	auto CheckTic = [&](unsigned int tic, const Checksum& sum)
+	{
+		Checksum expected;
+		if (DemoRead && DemoRead->ReadChecksum(expected) && expected != sum && !Desynced)
+		{
+			Desynced = true;
+			cout << "Desync with the demo at tic " << tic << ": " << sum.Differences(expected) << endl;
+		}
+
+		if (DemoWrite)
+		{
+			DemoWrite->WriteChecksum(sum);
+		}
+
+		if (Watch && sum != WatchedSum && !Desynced)
+		{
+			Desynced = true;
+			cout << "Desync with the game that's watched at tic " << tic << ": " << sum.Differences(WatchedSum) << endl;
+		}
+
+		if (network.enabled())
+		{
+			network.sendChecksum(tic, sum);
+
+			string desync = network.desync();
+			if (!desync.empty())
+			{
+				cout << desync << endl;
+				ShowMessage(view, desync);
+			}
+		}
+	};
+
+	// With rollback, tics are recorded once they were played with the confirmed commands
+	unsigned int FinalTic = 0;
+	auto FinishTics = [&]()
+	{
+		for (; FinalTic < GameRollback->FinalTic(); FinalTic++)
+		{
+			if (DemoWrite)
+			{
+				if (DemoWrite->KeyframeDue())
+					DemoWrite->WriteKeyframe(GameRollback->FinalState(FinalTic));
+
+				DemoWrite->WriteTic(GameRollback->FinalCommands(FinalTic));
+			}
+
+			CheckTic(FinalTic, GameRollback->FinalChecksum(FinalTic));
+
+			if (Spectators)
+			{
+				Spectators->Publish(FinalTic, GameRollback->FinalCommands(FinalTic), GameRollback->FinalChecksum(FinalTic),
+					GameRollback->FinalState(FinalTic));
+			}
+		}
+	};
+
+	// State of the game before a keyframe. Only used without rollback.
+	GameState KeyframeState;
+
+	// Demos in the container format have a keyframe every few seconds, so they can be played from any tic
+	if (!RecordName.empty())
+	{
+		DemoInfo info;
+		info.version = VERSION;
+		info.level = LevelName;
+		info.seed = initialIndex;
+		info.players = CurrentLevel->players.size();
+		info.interval = (unsigned int)(stof(FindArgumentParameter(argc, argv, "-keyframe", "10")) * 60);
+		DemoWrite.reset(new DemoWriter(RecordName, info));
+	}
+
+	const int FRAMERATE = 60;
+	auto FrameTime = std::chrono::milliseconds(1000 / FRAMERATE);
+
+	// Start the demo at a later tic. The game is restored from the keyframe before it and the tics in between are played
+	// without drawing them.
+	if (DemoRead && FindArgumentPosition(argc, argv, "-seek") > 0)
+	{
+		auto start = chrono::system_clock::now();
+		unsigned int target = stoul(FindArgumentParameter(argc, argv, "-seek", "0"));
+		unsigned int from = DemoRead->Seek(target, *CurrentLevel);
+
+		while (!Quit && DemoRead->Tic() < target && DemoRead->ReadTic(CurrentLevel->players))
+		{
+			PlayTic(CurrentLevel);
+			CheckTic(DemoRead->Tic() - 1, TicChecksum(*CurrentLevel));
+
+			for (unsigned int i = 0; i < CurrentLevel->players.size(); i++)
+			{
+				Quit = Quit || CurrentLevel->players[i]->Cmd.quit;
+			}
+		}
+
+		// The game continues at the speed of the demo from there
+		TicCount = DemoRead->Tic();
+		if (!Fast)
+			GameStartTime = chrono::system_clock::now() - FrameTime * TicCount;
+
+		cout << "Seeked to tic " << TicCount << " from the keyframe at tic " << from << " in "
+			<< chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now() - start).count() << "ms." << endl;
+	}
+
+	/****************************** TIMEDEMO ******************************/
+
+	if (Timedemo)
 	{
-		DemoWrite << VERSION << endl;
-		DemoWrite << LevelName << endl;
-		DemoWrite << initialIndex << endl;
-		DemoWrite << CurrentLevel->players.size() << endl;
+		TicProfiler profiler;
+
+		while (!Quit)
+		{
+			auto start = chrono::system_clock::now();
+			profiler.BeginTic();
+
+			if (!DemoRead->ReadTic(CurrentLevel->players))
+				break;
+
+			profiler.Lap(PHASE_INPUT);
+			PlayTic(CurrentLevel, &profiler);
+			CheckTic(TicCount, TicChecksum(*CurrentLevel));
+			profiler.Lap(PHASE_CHECKSUM);
+
+			if (window)
+			{
+				glfwPollEvents();
+				FrameDelay = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now() - start).count();
+				DrawScreen(window, CurrentLevel->play, CurrentLevel, FrameDelay);
+				Quit = glfwWindowShouldClose(window);
+				profiler.Lap(PHASE_RENDER);
+			}
+
+			profiler.EndTic();
+			TicCount++;
+
+			for (unsigned int i = 0; i < CurrentLevel->players.size(); i++)
+			{
+				Quit = Quit || CurrentLevel->players[i]->Cmd.quit;
+			}
+		}
+
+		profiler.Print();
+
+		if (DemoChecksums && !Desynced)
+		{
+			cout << "Every tic matched the checksum of the demo." << endl;
+		}
+
+		if (FindArgumentPosition(argc, argv, "-json") > 0)
+		{
+			TimedemoInfo info;
+			info.version = VERSION;
+			info.demo = DemoName;
+			info.level = LevelName;
+			info.players = CurrentLevel->players.size();
+			info.render = Render;
+			info.checksums = DemoChecksums;
+			info.desynced = Desynced;
+			profiler.WriteJson(FindArgumentParameter(argc, argv, "-json", "timedemo.json"), info);
+		}
+
+		delete CurrentLevel;
+		if (window)
+			Close_OpenGL(window);
+
+		return Desynced ? EXIT_FAILURE : EXIT_SUCCESS;
 	}
 
 	/****************************** GAME LOOP ******************************/
@@ -234,10 +733,45 @@ int mainloop(int argc, const char* argv[])
 			glfwPollEvents();
 		RegisterKeyPresses(window);
 
-		if (DemoRead.is_open())
+		if (DemoRead)
 		{
 			// Read demo. No event capture or network activity occurs.
-			Quit = !readCmdFromDemo(DemoRead, CurrentLevel->players);
+			Quit = !DemoRead->ReadTic(CurrentLevel->players);
+
+			if (glfwWindowShouldClose(window))
+			{
+				Quit = true;
+			}
+		}
+		else if (Watch)
+		{
+			// Play the tics of the game that's watched. Nobody waits for the spectator.
+			if (!Watch->ReceiveTic(*CurrentLevel, NetCommands, WatchedSum, network.TIMEOUT))
+			{
+				cout << "The game that was watched is not sent anymore." << endl;
+				break;
+			}
+
+			// The tics that already arrived are played without drawing them, so a spectator who joined late catches up
+			while (!Quit && Watch->Waiting())
+			{
+				for (unsigned int i = 0; i < NetCommands.size() && i < CurrentLevel->players.size(); i++)
+				{
+					CurrentLevel->players[i]->NetToCmd(NetCommands[i]);
+				}
+
+				ReceivedTic(NetCommands);
+				PlayTic(CurrentLevel);
+				CheckTic(Watch->Tic(), TicChecksum(*CurrentLevel));
+				Watch->ReceiveTic(*CurrentLevel, NetCommands, WatchedSum, 0);
+			}
+
+			for (unsigned int i = 0; i < NetCommands.size() && i < CurrentLevel->players.size(); i++)
+			{
+				CurrentLevel->players[i]->NetToCmd(NetCommands[i]);
+			}
+
+			ReceivedTic(NetCommands);
 
 			if (glfwWindowShouldClose(window))
 			{
@@ -252,8 +786,11 @@ int mainloop(int argc, const char* argv[])
 				updatePlayerWithEvents(window, view, TicCount, CurrentLevel->play);
 			}
 
-			// Run bot on Player 2. For testing.
-//			updateBot(CurrentLevel->players[1], CurrentLevel);
+			// The bots set the commands of their players
+			if (Bots)
+			{
+				Bots->Think();
+			}
 
 			// Cause the game to quit if the player wants to
 			if (glfwWindowShouldClose(window))
@@ -264,50 +801,46 @@ int mainloop(int argc, const char* argv[])
 			// Send commands over network and receive commands
 			if (network.enabled())
 			{
-				if (network.myPlayer() == 0)
+				if (view.chatSend)
 				{
-					if (view.chatSend)
-					{
-						CurrentLevel->players[0]->Cmd.chat = view.chatStr;
-						view.chatSend = false;
-						view.chatStr.clear();
-					}
-
-					// Receive network event from player 2
-					CurrentLevel->players[1]->NetToCmd(network.receive());
+					CurrentLevel->play->Cmd.chat = view.chatStr;
+					view.chatSend = false;
+					view.chatStr.clear();
+				}
 
-					// Send network event to player 2
-					network.send(CurrentLevel->players[0]->CmdToNet());
+				// The command is sent for a later tic. The one that's played was sent a few tics ago,
+				// so only wait if it's not there yet.
+				unsigned char command[Ticcmd::MAX_SIZE];
+				size_t size = CurrentLevel->play->Cmd.Serialize(command, sizeof(command));
+				network.sendCommand(command, size);
 
-					if (CurrentLevel->players[1]->Cmd.chat.size() > 0)
-					{
-						ShowMessage(view, CurrentLevel->players[1]->Cmd.chat);
-					}
-
-				}
-				else if (network.myPlayer() == 1)
+				if (GameRollback)
 				{
-					if (view.chatSend)
-					{
-						CurrentLevel->players[1]->Cmd.chat = view.chatStr;
-						view.chatSend = false;
-						view.chatStr.clear();
-					}
+					// Use every tic that arrived. Only wait if the game is too far ahead.
+					GameRollback->AddLocalCommand(command, size);
 
-					// Send network event to player 1
-					network.send(CurrentLevel->players[1]->CmdToNet());
+					bool received = network.pollTic(NetCommands);
 
-					// Receive network event from player 1
-					CurrentLevel->players[0]->NetToCmd(network.receive());
-
-					if (CurrentLevel->players[0]->Cmd.chat.size() > 0)
+					while (!Quit && (received || !GameRollback->CanAdvance()))
 					{
-						ShowMessage(view, CurrentLevel->players[0]->Cmd.chat);
+						if (!received)
+							network.receiveTic(NetCommands);
+
+						GameRollback->Confirm(NetCommands);
+						ReceivedTic(NetCommands);
+						received = network.pollTic(NetCommands);
 					}
 				}
 				else
 				{
-					throw runtime_error("Something is wrong: Player ID is not 0 or 1.");
+					network.receiveTic(NetCommands);
+
+					for (unsigned int i = 0; i < NetCommands.size() && i < CurrentLevel->players.size(); i++)
+					{
+						CurrentLevel->players[i]->NetToCmd(NetCommands[i]);
+					}
+
+					ReceivedTic(NetCommands);
 				}
 			}
 			else
@@ -321,82 +854,57 @@ int mainloop(int argc, const char* argv[])
 			}
 
 			// Write commands to demo
-			if (DemoWrite.is_open())
+			if (DemoWrite && !GameRollback)
 			{
-				writeCmdToDemo(DemoWrite, CurrentLevel->players);
+				if (DemoWrite->KeyframeDue())
+				{
+					KeyframeState.Save(*CurrentLevel);
+					DemoWrite->WriteKeyframe(KeyframeState);
+				}
+
+				DemoWrite->WriteTic(CurrentLevel->players);
 			}
 		}
 
 		updateSpecials(CurrentLevel->play, CurrentLevel->players);
 
-		// Update game logic
-		for (unsigned int i = 0; i < CurrentLevel->players.size(); i++)
+		// Check the level's file twice per second
+		if (WatchLevel && TicCount % 30 == 0)
 		{
-			// Save player's position and the execute the tic command
-			Float3 pt = CurrentLevel->players[i]->pos_;
-			CurrentLevel->players[i]->ExecuteTick();
-
-			// Collision detection with floors and walls
-			if (!NewPositionIsValid(CurrentLevel->players[i], CurrentLevel))
+			// The planes of the navmesh are not the same anymore
+			if (CurrentLevel->ReloadIfChanged() && UseNavMesh)
 			{
-				// Compute the position where the player would be if he slide against the wall
-				Float2 pos = MoveOnCollision(pt, CurrentLevel->players[i]->pos_, CurrentLevel->players[i], CurrentLevel);
-
-				// Move the player back to its original position
-				// TODO: Shouldn't any 'momentum' be cancelled?
-				CurrentLevel->players[i]->pos_ = pt;
+				Navigation.reset();
+				Navigation.reset(new NavMesh(*CurrentLevel, LevelName + NAVMESH_EXTENSION));
 
-				// Try to slide the player against the walls to a valid position
-				if (NewPositionIsValid(CurrentLevel->players[i], CurrentLevel))
-				{
-					// Make sure the walls didn't push the player inside other players
-					if (!PlayerToPlayersCollision(CurrentLevel->players[i], CurrentLevel->players))
-					{
-						// Set the new position
-						CurrentLevel->players[i]->pos_.x = pos.x;
-						CurrentLevel->players[i]->pos_.y = pos.y;
-					}
-					else
-					{
-						// TODO: Shouldn't any 'momentum' be cancelled?
-						CurrentLevel->players[i]->pos_ = pt;
-					}
-				}
+				if (Bots)
+					Bots->SetNavMesh(Navigation.get());
 			}
+		}
 
-			// Player to player collision check
-			if (PlayerToPlayersCollision(CurrentLevel->players[i], CurrentLevel->players))
+		// Play the tic. With rollback, tics that were guessed wrong are also played again.
+		if (GameRollback)
+		{
+			GameRollback->Advance();
+			FinishTics();
+		}
+		else
+		{
+			if (Spectators && Spectators->KeyframeDue(TicCount))
 			{
-				for (unsigned int j = 0; j < CurrentLevel->players.size(); j++)
-				{
-					if (CurrentLevel->players[i] != CurrentLevel->players[j])
-					{
-						// Execute Player to player collision
-						CurrentLevel->players[i]->pos_ = PlayerToPlayerCollisionReact(CurrentLevel->players[i], CurrentLevel->players[j]);
-						// Check if there's a collision between players
-						if (PlayerToPlayerCollision(CurrentLevel->players[i], CurrentLevel->players[j]) ||
-							!NewPositionIsValid(CurrentLevel->players[i], CurrentLevel))
-						{
-							// Restore original position
-							CurrentLevel->players[i]->pos_ = pt;
-						}
-					}
-				}
+				KeyframeState.Save(*CurrentLevel);
 			}
 
-			// Adjust height
-			AdjustPlayerToFloor(CurrentLevel->players[i], CurrentLevel);
+			PlayTic(CurrentLevel);
+			Checksum sum = TicChecksum(*CurrentLevel);
+			CheckTic(Watch ? Watch->Tic() : TicCount, sum);
 
-			// Handle fire here to avoid circular inclusion/dependecy with 'Level' in the Player class
-			if (CurrentLevel->players[i]->ShouldFire)
+			if (Spectators)
 			{
-				Hitscan(CurrentLevel, CurrentLevel->players[i], CurrentLevel->players);
-				CurrentLevel->players[i]->ShouldFire = false;
+				Spectators->Publish(TicCount, NetCommands, sum, KeyframeState);
 			}
 		}
 
-		CurrentLevel->UpdateThings();
-
 		// Play sound
 
 		// Status of the player for debugging purposes
@@ -408,8 +916,6 @@ int mainloop(int argc, const char* argv[])
 
 		TicCount++;
 
-		const int FRAMERATE = 60;
-		auto FrameTime = std::chrono::milliseconds(1000 / FRAMERATE);
 		auto max = GameStartTime + FrameTime * TicCount;
 
 		// Check if we're not running too late
@@ -436,8 +942,9 @@ int mainloop(int argc, const char* argv[])
 			cerr << (const char*)gluErrorString(ErrorCode) << endl;
 		}
 
-		// Find a player who quits and terminate the game.
-		for (unsigned int i = 0; i < CurrentLevel->players.size(); i++)
+		// Find a player who quits and terminate the game. With rollback, the commands may be guesses,
+		// so only the tics that were confirmed are checked.
+		for (unsigned int i = 0; i < CurrentLevel->players.size() && !GameRollback; i++)
 		{
 			if (!Quit)
 			{
@@ -447,22 +954,56 @@ int mainloop(int argc, const char* argv[])
 	}
 	while (!Quit);
 
+	// Every peer records the same tics
+	if (GameRollback)
+	{
+		GameRollback->Finish();
+		FinishTics();
+	}
+
 	/****************************** TERMINATION ******************************/
 
 	// Destroy level
 	if (CurrentLevel != nullptr)
 		delete CurrentLevel;
 
-	if (DemoWrite.is_open())
+	if (DemoWrite)
 	{
-		DemoWrite.close();
+		DemoWrite->Close();
 		cout << "Demo written to disk." << endl;
 	}
 
-	if (DemoRead.is_open())
+	if (DemoRead)
 	{
-		DemoRead.close();
+		DemoRead.reset();
 		cout << "Demo playback ended." << endl;
+
+		if (DemoChecksums && !Desynced)
+		{
+			cout << "Every tic matched the checksum of the demo." << endl;
+		}
+	}
+
+	if (network.enabled())
+	{
+		cout << "Waited for the network on " << network.stalls() << " of " << TicCount << " tics (" << (int)network.waitTime()
+			<< "ms in total). Up to " << network.maxQueuedTics() << " tics were ready before they were played." << endl;
+
+		if (TicCount > 0)
+		{
+			cout << "Network: " << network.bytesSent() / TicCount << " bytes sent and " << network.bytesReceived() / TicCount << " bytes received per tic." << endl;
+		}
+
+		if (GameRollback)
+			GameRollback->PrintStats();
+
+		if (Spectators)
+			Spectators->PrintStats();
+	}
+
+	if (Watch)
+	{
+		Watch->PrintStats();
 	}
 
 	if (Fast)
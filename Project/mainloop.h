@@ -19,6 +19,12 @@
 #ifndef MAINLOOP_H
 #define MAINLOOP_H
 
+class Level;
+class TicProfiler;
+
 int mainloop(int argc, const char* argv[]);
 
+// Move the players and update the things for one tic. Each phase is timed if there's a profiler.
+void PlayTic(Level* lvl, TicProfiler* profiler = nullptr);
+
 #endif	// MAINLOOP_H
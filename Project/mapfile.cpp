@@ -0,0 +1,121 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// mapfile.cpp
+// Read-only memory-mapped file
+
+#include "mapfile.h"
+
+#include <string>
+#include <vector>
+#include <fstream>	/* ifstream */
+
+#ifndef _WIN32
+#include <sys/mman.h>	/* mmap, munmap, madvise */
+#include <sys/stat.h>	/* fstat */
+#include <fcntl.h>	/* open */
+#include <unistd.h>	/* close */
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const string& path)
+{
+	Open(path);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const string& path)
+{
+	Close();
+
+#ifndef _WIN32
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (p != MAP_FAILED)
+		{
+			data_ = static_cast<const unsigned char*>(p);
+			size_ = st.st_size;
+			close(fd);	// The mapping stays valid after the descriptor is closed
+			return true;
+		}
+	}
+
+	close(fd);
+#endif
+
+	// Read the whole file if it can't be mapped (or if it's empty)
+	ifstream file(path, ios::binary);
+	if (!file.is_open())
+		return false;
+
+	fallback_.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	data_ = fallback_.data();
+	size_ = fallback_.size();
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifndef _WIN32
+	if (data_ && data_ != fallback_.data())
+	{
+		munmap(const_cast<unsigned char*>(data_), size_);
+	}
+#endif
+
+	fallback_.clear();
+	data_ = nullptr;
+	size_ = 0;
+}
+
+void MappedFile::Sequential()
+{
+#ifndef _WIN32
+	if (data_ && data_ != fallback_.data())
+	{
+		// These are advice values, not flags, so they can't be combined
+		madvise(const_cast<unsigned char*>(data_), size_, MADV_SEQUENTIAL);
+		madvise(const_cast<unsigned char*>(data_), size_, MADV_WILLNEED);
+	}
+#endif
+}
+
+bool MappedFile::IsOpen() const
+{
+	return data_ != nullptr;
+}
+
+const unsigned char* MappedFile::Data() const
+{
+	return data_;
+}
+
+size_t MappedFile::Size() const
+{
+	return size_;
+}
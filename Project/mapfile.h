@@ -0,0 +1,53 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// mapfile.h
+// Read-only memory-mapped file
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <string>
+#include <vector>
+using namespace std;
+
+class MappedFile
+{
+private:
+	const unsigned char* data_ = nullptr;
+	size_t size_ = 0;
+	vector<unsigned char> fallback_;	// Used when the file can't be mapped
+
+public:
+	MappedFile() = default;
+	explicit MappedFile(const string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false if the file could not be opened
+	bool Open(const string& path);
+	void Close();
+
+	// Tell the system that the file is going to be read from start to end
+	void Sequential();
+
+	bool IsOpen() const;
+	const unsigned char* Data() const;
+	size_t Size() const;
+};
+
+#endif	// MAPFILE_H
@@ -0,0 +1,530 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// navmesh.cpp
+// Navigation mesh used by the bots
+
+#include "navmesh.h"
+#include "level.h"	/* Level */
+#include "plane.h"	/* Plane */
+#include "player.h"	/* Player::MaxStep */
+#include "vecmath.h"	/* Float3, pointInPoly, PointHeightOnPoly */
+#include "mapfile.h"	/* MappedFile */
+#include "threadpool.h"	/* ThreadPool */
+#include "line.h"	/* lineCircle */
+
+#include <cmath>
+#include <cstring>	/* memcpy */
+#include <algorithm>	/* push_heap, pop_heap, reverse */
+#include <limits>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+using namespace std;
+
+struct NavMeshFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t numNodes;
+	uint32_t numLinks;
+	uint32_t padding;
+	uint64_t key;
+	// Followed by the nodes, the link offsets and the links
+};
+
+const uint32_t NAVMESH_BYTEORDER = 0x01020304;	// Written in the machine's byte order
+
+// Edges that are closer than this are considered to be the same
+const float NAV_EPSILON = 0.01f;
+
+// Most points that are tried on an edge to find where a player fits
+const unsigned int NAV_PORTAL_TRIES = 16;
+
+// Scratch memory of the A* search. Each thread has its own so bots can search at the same time.
+struct NavSearch
+{
+	vector<float> cost;	// Cost to reach each node from the start
+	vector<uint32_t> link;	// Link used to reach each node
+	vector<uint32_t> parent;	// Node that the link comes from
+	vector<uint32_t> seen;	// Equals 'search' if the node was reached by the current search
+	vector<uint32_t> done;	// Equals 'search' if the node's cost is final
+	vector<pair<float, uint32_t>> open;	// Heap of the nodes to visit, smallest estimate first
+	uint32_t search = 0;
+};
+
+static thread_local NavSearch search_;
+
+static float Distance(const Float3& u, const Float3& v)
+{
+	return sqrt((u.x - v.x) * (u.x - v.x) + (u.y - v.y) * (u.y - v.y) + (u.z - v.z) * (u.z - v.z));
+}
+
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+	// FNV-1a
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+NavMesh::NavMesh(const Level& level, const string& path): level_(level)
+{
+	auto start = chrono::steady_clock::now();
+	key_ = LevelKey();
+
+	if (path.empty() || !Load(path))
+	{
+		Build();
+
+		if (!path.empty())
+			Save(path);
+	}
+
+	for (uint32_t i = 0; i < nodes_.size(); i++)
+	{
+		planeNodes_[level_.planes[nodes_[i].plane]] = i;
+	}
+
+	auto diff = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+	cout << "Navmesh has " << NumNodes() << " nodes and " << NumLinks() << " links. It was " <<
+		(fromFile_ ? "loaded" : "built") << " in " << diff << "ms." << endl;
+}
+
+bool NavMesh::FromFile() const
+{
+	return fromFile_;
+}
+
+unsigned int NavMesh::NumNodes() const
+{
+	return nodes_.size();
+}
+
+unsigned int NavMesh::NumLinks() const
+{
+	return links_.size();
+}
+
+const NavNode& NavMesh::Node(uint32_t node) const
+{
+	return nodes_[node];
+}
+
+const NavLink* NavMesh::Links(uint32_t node, unsigned int& count) const
+{
+	count = linkOffsets_[node + 1] - linkOffsets_[node];
+	return links_.data() + linkOffsets_[node];
+}
+
+// The navmesh only matches the level if the planes and the size of the player are the same
+uint64_t NavMesh::LevelKey() const
+{
+	uint64_t hash = 14695981039346656037ULL;
+	const float sizes[3] = {Player::MaxStep, Player::Radius_, Player::Height_};
+	const uint32_t count = level_.planes.size();
+
+	HashBytes(hash, &NAVMESH_VERSION, sizeof(NAVMESH_VERSION));
+	HashBytes(hash, sizes, sizeof(sizes));
+	HashBytes(hash, &count, sizeof(count));
+
+	for (unsigned int i = 0; i < level_.planes.size(); i++)
+	{
+		const Plane* p = level_.planes[i];
+		Float3 vertices[Plane::MAX_VERTICES];
+		uint32_t numVertices = p->GetVertices(vertices);
+		unsigned char impassable = p->Impassable;
+
+		HashBytes(hash, &impassable, sizeof(impassable));
+		HashBytes(hash, &numVertices, sizeof(numVertices));
+		HashBytes(hash, vertices, numVertices * sizeof(Float3));
+	}
+
+	return hash;
+}
+
+void NavMesh::Build()
+{
+	nodes_.clear();
+	links_.clear();
+	planeNodes_.clear();
+
+	// Players can stand on the planes that are not too steep
+	for (uint32_t i = 0; i < level_.planes.size(); i++)
+	{
+		const Plane* p = level_.planes[i];
+
+		if (p->IsFloor() && !isnan(p->normal.z))
+		{
+			planeNodes_[p] = nodes_.size();
+			nodes_.push_back({i, p->centroid});
+		}
+	}
+
+	// The links of each node are found on every core, then put one after the other
+	vector<vector<NavLink>> found(nodes_.size());
+	ThreadPool pool;
+
+	pool.ParallelFor(nodes_.size(), [this, &found](unsigned int first, unsigned int last)
+	{
+		for (unsigned int i = first; i < last; i++)
+			FindLinks(i, found[i]);
+	});
+
+	linkOffsets_.resize(nodes_.size() + 1);
+	linkOffsets_[0] = 0;
+
+	for (unsigned int i = 0; i < found.size(); i++)
+	{
+		links_.insert(links_.end(), found[i].begin(), found[i].end());
+		linkOffsets_[i + 1] = links_.size();
+	}
+}
+
+// Find the nodes that can be reached from this one
+void NavMesh::FindLinks(uint32_t node, vector<NavLink>& links) const
+{
+	const Plane* from = level_.planes[nodes_[node].plane];
+	Float3 low = from->BoxMin();
+	Float3 high = from->BoxMax();
+	float radius = max(high.x - low.x, high.y - low.y) / 2 + NAV_EPSILON;
+
+	vector<Plane*> near = level_.getPlanesForBox((low.x + high.x) / 2, (low.y + high.y) / 2, radius);
+
+	for (unsigned int i = 0; i < near.size(); i++)
+	{
+		auto other = planeNodes_.find(near[i]);
+		Float3 portal;
+
+		if (near[i] == from || other == planeNodes_.end() || !FindPortal(from, near[i], portal))
+			continue;
+
+		const NavNode& to = nodes_[other->second];
+		links.push_back({other->second, portal, Distance(nodes_[node].center, portal) + Distance(portal, to.center)});
+	}
+}
+
+// Find where a player can go from a plane to another one. They must share a part of an edge. It's
+// not possible to climb higher than a step, but it's possible to fall from any height.
+bool NavMesh::FindPortal(const Plane* from, const Plane* to, Float3& portal) const
+{
+	Float3 a[Plane::MAX_VERTICES];
+	Float3 b[Plane::MAX_VERTICES];
+	unsigned int countA = from->GetVertices(a);
+	unsigned int countB = to->GetVertices(b);
+
+	for (unsigned int i = 0, j = countA - 1; i < countA; j = i++)
+	{
+		// Edge of the first plane, from 'a[j]' to 'a[i]'
+		float dx = a[i].x - a[j].x;
+		float dy = a[i].y - a[j].y;
+		float length = sqrt(dx * dx + dy * dy);
+
+		if (length < NAV_EPSILON)
+			continue;
+
+		dx /= length;
+		dy /= length;
+
+		for (unsigned int k = 0, l = countB - 1; k < countB; l = k++)
+		{
+			// The other edge must be on the same line
+			float sideK = dx * (b[k].y - a[j].y) - dy * (b[k].x - a[j].x);
+			float sideL = dx * (b[l].y - a[j].y) - dy * (b[l].x - a[j].x);
+
+			if (fabs(sideK) > NAV_EPSILON || fabs(sideL) > NAV_EPSILON)
+				continue;
+
+			// Part of the first edge that is covered by the other one
+			float posK = dx * (b[k].x - a[j].x) + dy * (b[k].y - a[j].y);
+			float posL = dx * (b[l].x - a[j].x) + dy * (b[l].y - a[j].y);
+			float first = max(min(posK, posL), 0.0f);
+			float last = min(max(posK, posL), length);
+
+			if (last - first < NAV_EPSILON || fabs(posK - posL) < NAV_EPSILON)
+				continue;
+
+			// Try the middle first, then farther and farther from it
+			unsigned int tries = min(NAV_PORTAL_TRIES, (unsigned int)ceil((last - first) / Player::Radius_));
+
+			for (unsigned int t = 0; t < tries; t++)
+			{
+				int slot = tries / 2 + (t % 2 ? -(int)(t + 1) / 2 : (int)t / 2);
+				float pos = first + (last - first) * (slot + 0.5f) / tries;
+
+				// Height of both planes on their edge
+				float heightA = a[j].z + (a[i].z - a[j].z) * pos / length;
+				float heightB = b[l].z + (b[k].z - b[l].z) * (pos - posL) / (posK - posL);
+
+				if (heightB > heightA + Player::MaxStep)
+					continue;
+
+				Float3 point = {a[j].x + dx * pos, a[j].y + dy * pos, max(heightA, heightB)};
+
+				if (HasClearance(point))
+				{
+					portal = point;
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+// Same test as the player's collisions with walls
+bool NavMesh::HasClearance(const Float3& pos) const
+{
+	vector<Plane*> near = level_.getPlanesForBox(pos.x, pos.y, Player::Radius_);
+
+	for (unsigned int i = 0; i < near.size(); i++)
+	{
+		const Plane* p = near[i];
+
+		if (p->CanWalk() || pos.z + Player::MaxStep >= p->Max() || pos.z + Player::Height_ <= p->Min())
+			continue;
+
+		Float3 vertices[Plane::MAX_VERTICES];
+		unsigned int count = p->GetVertices(vertices);
+
+		if (pointInPoly(pos.x, pos.y, vertices, count))
+			return false;
+
+		for (unsigned int k = 0, l = count - 1; k < count; l = k++)
+			if (lineCircle(vertices[k].x, vertices[k].y, vertices[l].x, vertices[l].y, pos.x, pos.y, Player::Radius_))
+				return false;
+	}
+
+	return true;
+}
+
+int NavMesh::FindNode(const Float3& pos) const
+{
+	// Same as how a player is put on the floor, but only at its center
+	int node = -1;
+	float height = numeric_limits<float>::lowest();
+	vector<Plane*> near = level_.getPlanesForBox(pos.x, pos.y, 0);
+
+	for (unsigned int i = 0; i < near.size(); i++)
+	{
+		const Plane* p = near[i];
+		auto found = planeNodes_.find(p);
+
+		if (found == planeNodes_.end())
+			continue;
+
+		Float3 vertices[Plane::MAX_VERTICES];
+		unsigned int count = p->GetVertices(vertices);
+
+		if (!pointInPoly(pos.x, pos.y, vertices, count))
+			continue;
+
+		float floor = PointHeightOnPoly(pos.x, pos.y, pos.z, p->normal, p->centroid);
+
+		if (isnan(floor))
+			continue;
+
+		floor = min(max(floor, p->Min()), p->Max());
+
+		if (floor > height && floor <= pos.z + Player::MaxStep)
+		{
+			height = floor;
+			node = found->second;
+		}
+	}
+
+	return node;
+}
+
+bool NavMesh::FindPath(const Float3& start, const Float3& goal, vector<Float3>& path, const CostFunction& cost) const
+{
+	path.clear();
+
+	int first = FindNode(start);
+	int last = FindNode(goal);
+
+	if (first < 0 || last < 0)
+		return false;
+
+	NavSearch& s = search_;
+
+	if (s.cost.size() < nodes_.size())
+	{
+		s.cost.resize(nodes_.size());
+		s.link.resize(nodes_.size());
+		s.parent.resize(nodes_.size());
+		s.seen.resize(nodes_.size(), 0);
+		s.done.resize(nodes_.size(), 0);
+	}
+
+	// The marks of the previous searches don't have to be cleared
+	if (++s.search == 0)
+	{
+		fill(s.seen.begin(), s.seen.end(), 0);
+		fill(s.done.begin(), s.done.end(), 0);
+		s.search = 1;
+	}
+
+	const Float3& target = nodes_[last].center;
+	auto later = [](const pair<float, uint32_t>& x, const pair<float, uint32_t>& y) { return x.first > y.first; };
+
+	s.open.clear();
+	s.cost[first] = 0;
+	s.seen[first] = s.search;
+	s.open.push_back({Distance(nodes_[first].center, target), first});
+
+	while (!s.open.empty())
+	{
+		uint32_t node = s.open.front().second;
+		pop_heap(s.open.begin(), s.open.end(), later);
+		s.open.pop_back();
+
+		// A node can be in the heap more than once, only the cheapest is used
+		if (s.done[node] == s.search)
+			continue;
+
+		s.done[node] = s.search;
+
+		if (node == (uint32_t)last)
+			break;
+
+		for (uint32_t i = linkOffsets_[node]; i < linkOffsets_[node + 1]; i++)
+		{
+			const NavLink& link = links_[i];
+
+			if (s.done[link.node] == s.search)
+				continue;
+
+			float linkCost = cost ? cost(node, link) : link.length;
+
+			if (linkCost < 0)
+				continue;
+
+			float total = s.cost[node] + linkCost;
+
+			if (s.seen[link.node] != s.search || total < s.cost[link.node])
+			{
+				s.seen[link.node] = s.search;
+				s.cost[link.node] = total;
+				s.link[link.node] = i;
+				s.parent[link.node] = node;
+				s.open.push_back({total + Distance(nodes_[link.node].center, target), link.node});
+				push_heap(s.open.begin(), s.open.end(), later);
+			}
+		}
+	}
+
+	if (s.done[last] != s.search)
+		return false;
+
+	// Walk back from the goal through the portals
+	path.push_back(goal);
+
+	for (uint32_t node = last; node != (uint32_t)first; node = s.parent[node])
+		path.push_back(links_[s.link[node]].portal);
+
+	path.push_back(start);
+	reverse(path.begin(), path.end());
+	return true;
+}
+
+bool NavMesh::Load(const string& path)
+{
+	MappedFile file(path);
+	NavMeshFileHeader header;
+
+	if (!file.IsOpen() || file.Size() < sizeof(header))
+		return false;
+
+	memcpy(&header, file.Data(), sizeof(header));
+
+	if (memcmp(header.magic, NAVMESH_MAGIC, sizeof(header.magic)) != 0 || header.version != NAVMESH_VERSION ||
+		header.byteOrder != NAVMESH_BYTEORDER || header.key != key_)
+	{
+		cout << "Navmesh '" << path << "' was made for another level. It's built again." << endl;
+		return false;
+	}
+
+	size_t size = sizeof(header) + header.numNodes * sizeof(NavNode) + (header.numNodes + 1) * sizeof(uint32_t) +
+		header.numLinks * sizeof(NavLink);
+
+	if (file.Size() != size)
+	{
+		cout << "Navmesh '" << path << "' is damaged. It's built again." << endl;
+		return false;
+	}
+
+	const unsigned char* pos = file.Data() + sizeof(header);
+
+	nodes_.resize(header.numNodes);
+	memcpy(nodes_.data(), pos, nodes_.size() * sizeof(NavNode));
+	pos += nodes_.size() * sizeof(NavNode);
+
+	linkOffsets_.resize(header.numNodes + 1);
+	memcpy(linkOffsets_.data(), pos, linkOffsets_.size() * sizeof(uint32_t));
+	pos += linkOffsets_.size() * sizeof(uint32_t);
+
+	links_.resize(header.numLinks);
+	memcpy(links_.data(), pos, links_.size() * sizeof(NavLink));
+
+	// Don't trust indices that would be out of bounds
+	for (unsigned int i = 0; i < nodes_.size(); i++)
+	{
+		if (nodes_[i].plane >= level_.planes.size() || linkOffsets_[i] > linkOffsets_[i + 1])
+			return false;
+	}
+
+	for (unsigned int i = 0; i < links_.size(); i++)
+	{
+		if (links_[i].node >= nodes_.size())
+			return false;
+	}
+
+	fromFile_ = linkOffsets_.back() == links_.size();
+	return fromFile_;
+}
+
+// Writing the file is optional, so an error is not fatal
+void NavMesh::Save(const string& path) const
+{
+	NavMeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, NAVMESH_MAGIC, sizeof(header.magic));
+	header.version = NAVMESH_VERSION;
+	header.byteOrder = NAVMESH_BYTEORDER;
+	header.numNodes = nodes_.size();
+	header.numLinks = links_.size();
+	header.key = key_;
+
+	ofstream file(path, ios::binary);
+	if (!file.is_open())
+	{
+		cout << "Could not write the navmesh to '" << path << "'" << endl;
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(nodes_.data()), nodes_.size() * sizeof(NavNode));
+	file.write(reinterpret_cast<const char*>(linkOffsets_.data()), linkOffsets_.size() * sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(links_.data()), links_.size() * sizeof(NavLink));
+}
@@ -0,0 +1,96 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// navmesh.h
+// Navigation mesh used by the bots. The nodes are the polygons that can be walked on and the
+// links join the ones that a player can go between. It's saved in a file next to the level
+// so it's only built again when the level changes.
+
+#ifndef NAVMESH_H
+#define NAVMESH_H
+
+#include "vecmath.h"	/* Float3 */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+using namespace std;
+
+class Level;
+class Plane;
+
+const char NAVMESH_MAGIC[4] = {'M', 'G', 'N', 'V'};
+const uint32_t NAVMESH_VERSION = 1;
+const string NAVMESH_EXTENSION = ".nav";
+
+struct NavNode
+{
+	uint32_t plane;		// Index in the level's planes
+	Float3 center;
+};
+
+struct NavLink
+{
+	uint32_t node;		// Where the link goes
+	Float3 portal;		// Point on the shared edge where a player fits, at the height of the highest side
+	float length;		// From the center of the first node to the portal, then to the center of the other node
+};
+
+class NavMesh
+{
+public:
+	// Returns the cost of a link, or a negative number if it must not be used. The cost should not be
+	// smaller than the length of the link, otherwise the path that is found may not be the cheapest.
+	typedef function<float(uint32_t from, const NavLink& link)> CostFunction;
+
+	// Load the navmesh from the file if it was made for this level, otherwise build it and write
+	// the file. Nothing is written if the path is empty. The level must outlive the navmesh.
+	NavMesh(const Level& level, const string& path);
+
+	bool FromFile() const;	// The navmesh was not built
+	unsigned int NumNodes() const;
+	unsigned int NumLinks() const;
+	const NavNode& Node(uint32_t node) const;
+	const NavLink* Links(uint32_t node, unsigned int& count) const;
+
+	// Node on which a player standing at this position would be. -1 if there's none.
+	int FindNode(const Float3& pos) const;
+
+	// A* search. 'path' gets the points to go through, starting at 'start' and ending at 'goal'.
+	// Returns false if there's no way to go from one to the other.
+	bool FindPath(const Float3& start, const Float3& goal, vector<Float3>& path, const CostFunction& cost = nullptr) const;
+
+private:
+	const Level& level_;
+	vector<NavNode> nodes_;
+	vector<uint32_t> linkOffsets_;	// Where each node's links start in 'links_', one more than the number of nodes
+	vector<NavLink> links_;
+	unordered_map<const Plane*, uint32_t> planeNodes_;
+	uint64_t key_ = 0;	// Identifies the level's geometry
+	bool fromFile_ = false;
+
+	uint64_t LevelKey() const;
+	void Build();
+	void FindLinks(uint32_t node, vector<NavLink>& links) const;
+	bool FindPortal(const Plane* from, const Plane* to, Float3& portal) const;
+	bool HasClearance(const Float3& pos) const;	// A player standing there doesn't touch a wall
+	bool Load(const string& path);
+	void Save(const string& path) const;
+};
+
+#endif	// NAVMESH_H
@@ -0,0 +1,273 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// netbench.cpp
+// Measures the network code without a window. A server and its clients run in the same
+// process and play tics with random commands or with the commands of a demo.
+
+#include "netbench.h"
+#include "network.h"
+#include "ticcmd.h"
+#include "threadpool.h"	/* ThreadPool */
+#include "demo.h"	/* DemoReader */
+
+#include <zmq.hpp>
+#include <string>
+#include <vector>
+#include <iostream>	/* cout */
+#include <chrono>
+#include <thread>	/* this_thread::sleep_until */
+#include <atomic>
+#include <random>
+#include <algorithm>	/* sort, max */
+#include <cstdint>
+#include <stdexcept>
+using namespace std;
+
+// Size of a player's command in a demo (see writeTicToDemo)
+const unsigned int DEMO_COMMAND_SIZE = 7;
+
+struct NetBenchDemo
+{
+	unsigned int players = 0;
+	vector<unsigned char> commands;	// Every tic one after the other
+};
+
+struct NetBenchPeer
+{
+	vector<float> latencies;	// ms between sending a command and receiving its tic
+	uint64_t hash = 14695981039346656037ULL;	// Of every tic that was received
+	unsigned int stalls = 0;
+	double waitTime = 0;	// ms
+	size_t maxQueuedTics = 0;
+	size_t bytesSent = 0;
+	double seconds = 0;
+};
+
+static void LoadDemo(const string& path, NetBenchDemo& demo)
+{
+	DemoReader file(path);
+	demo.players = file.Info().players;
+
+	vector<vector<unsigned char>> commands;
+	while (file.ReadTic(commands))
+	{
+		for (unsigned int i = 0; i < commands.size(); i++)
+			demo.commands.insert(demo.commands.end(), commands[i].begin(), commands[i].end());
+	}
+
+	if (demo.players == 0 || demo.commands.empty())
+	{
+		throw runtime_error("Demo '" + path + "' has no tics.");
+	}
+}
+
+// A command for the next tic. Players keep doing the same thing for a while, like real players.
+static void NextCommand(Ticcmd& cmd, unsigned int tic, minstd_rand& random, const NetBenchDemo& demo)
+{
+	unsigned char id = cmd.id;
+
+	if (demo.players > 0)
+	{
+		unsigned int tics = demo.commands.size() / (demo.players * DEMO_COMMAND_SIZE);
+		unsigned char record[Ticcmd::HEADER_SIZE] = {};
+		const unsigned char* found = &demo.commands[((tic % tics) * demo.players + id % demo.players) * DEMO_COMMAND_SIZE];
+
+		copy(found, found + DEMO_COMMAND_SIZE, record);
+		cmd.Deserialize(record, sizeof(record));
+		cmd.id = id;
+		cmd.quit = false;
+		return;
+	}
+
+	if (random() % 8 == 0)
+		cmd.forward = (int)(random() % 3) * 50 - 50;
+	if (random() % 8 == 0)
+		cmd.lateral = (int)(random() % 3) * 50 - 50;
+	if (random() % 4 == 0)
+		cmd.rotation = (int)(random() % 401) - 200;
+	if (random() % 8 == 0)
+		cmd.vertical = (int)(random() % 41) - 20;
+
+	cmd.fire = random() % 16 == 0;
+}
+
+static void RunPeer(context_t& context, const string& endpoint, bool server, const NetBenchSettings& settings,
+	const NetBenchDemo& demo, atomic<unsigned int>& finished, atomic<unsigned int>& stopped, NetBenchPeer& result)
+{
+	Network network(&context);
+	unsigned int peers = settings.clients + 1;
+
+	try
+	{
+		if (server)
+			network.startServer(endpoint, "netbench", peers, settings.delay);
+		else
+			network.connectClient(endpoint);
+
+		network.simulate(settings.loss, settings.latency);
+
+		Ticcmd cmd;
+		cmd.id = network.myPlayer();
+		minstd_rand random(cmd.id + 1);
+
+		unsigned char command[Ticcmd::MAX_SIZE];
+		vector<vector<unsigned char>> commands;
+		vector<chrono::steady_clock::time_point> sent(settings.tics + network.delay());
+		result.latencies.reserve(settings.tics);
+
+		auto start = chrono::steady_clock::now();
+
+		// Nobody has input for the first tics, like in a game
+		for (unsigned int i = 0; i < network.delay(); i++)
+		{
+			sent[i] = start;
+			network.sendCommand(command, cmd.Serialize(command, sizeof(command)));
+		}
+
+		for (unsigned int tic = 0; tic < settings.tics; tic++)
+		{
+			if (settings.rate > 0)
+				this_thread::sleep_until(start + chrono::microseconds(1000000ULL * tic / settings.rate));
+
+			NextCommand(cmd, tic, random, demo);
+			sent[tic + network.delay()] = chrono::steady_clock::now();
+			network.sendCommand(command, cmd.Serialize(command, sizeof(command)));
+
+			network.receiveTic(commands);
+
+			if (tic >= network.delay())
+				result.latencies.push_back(chrono::duration<float, milli>(chrono::steady_clock::now() - sent[tic]).count());
+
+			// FNV-1a
+			for (unsigned int i = 0; i < commands.size(); i++)
+			{
+				for (unsigned int j = 0; j < commands[i].size(); j++)
+					result.hash = (result.hash ^ commands[i][j]) * 1099511628211ULL;
+			}
+		}
+
+		result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		result.stalls = network.stalls();
+		result.waitTime = network.waitTime();
+		result.maxQueuedTics = network.maxQueuedTics();
+	}
+	catch (...)
+	{
+		finished++;
+		stopped++;
+		throw;
+	}
+
+	// The others may still need the tics of this peer
+	finished++;
+	while (finished < peers)
+		network.update(10);
+
+	// A client can't send once the server's socket is closed, so the sockets are closed together
+	stopped++;
+	while (stopped < peers)
+		this_thread::sleep_for(chrono::milliseconds(1));
+
+	result.bytesSent = network.bytesSent();
+}
+
+static float Percentile(const vector<float>& sorted, float fraction)
+{
+	if (sorted.empty())
+		return 0;
+
+	return sorted[min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+}
+
+bool NetBenchmark(const NetBenchSettings& settings)
+{
+	string endpoint;
+	if (settings.transport == "inproc")
+		endpoint = "inproc://meshglide";
+	else if (settings.transport == "ipc")
+		endpoint = "ipc:///tmp/meshglide-netbench";
+	else if (settings.transport == "tcp")
+		endpoint = "tcp://127.0.0.1:5555";
+	else
+		throw runtime_error("Unknown transport '" + settings.transport + "'. Use inproc, ipc or tcp.");
+
+	NetBenchDemo demo;
+	if (!settings.demo.empty())
+		LoadDemo(settings.demo, demo);
+
+	cout << "Network benchmark: 1 server and " << settings.clients << " clients over " << settings.transport << ", "
+		<< settings.tics << " tics" << (demo.players > 0 ? " from " + settings.demo : " of random commands") << endl;
+	cout << "Input delay: " << settings.delay << " tics, packet loss: " << settings.loss * 100 << "%, latency: "
+		<< settings.latency << "ms, rate: " << (settings.rate > 0 ? to_string(settings.rate) + " tics/s" : "unlimited") << endl;
+
+	// Every peer waits for the others, so each one needs its own thread
+	context_t context(1);
+	vector<NetBenchPeer> results(settings.clients + 1);
+	atomic<unsigned int> finished(0);
+	atomic<unsigned int> stopped(0);
+	vector<future<void>> peers;
+
+	{
+		ThreadPool pool(results.size());
+
+		for (unsigned int i = 0; i < results.size(); i++)
+		{
+			peers.push_back(pool.Submit([&, i]()
+			{
+				RunPeer(context, endpoint, i == 0, settings, demo, finished, stopped, results[i]);
+			}));
+		}
+
+		for (unsigned int i = 0; i < peers.size(); i++)
+			peers[i].get();
+	}
+
+	// Results of every peer together
+	vector<float> latencies;
+	double seconds = 0;
+	unsigned int stalls = 0;
+	double waitTime = 0;
+	size_t maxQueuedTics = 0;
+	size_t clientBytes = 0;
+	bool sync = true;
+
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		latencies.insert(latencies.end(), results[i].latencies.begin(), results[i].latencies.end());
+		seconds = max(seconds, results[i].seconds);
+		stalls += results[i].stalls;
+		waitTime += results[i].waitTime;
+		maxQueuedTics = max(maxQueuedTics, results[i].maxQueuedTics);
+		sync = sync && results[i].hash == results[0].hash;
+
+		if (i > 0)
+			clientBytes += results[i].bytesSent;
+	}
+
+	sort(latencies.begin(), latencies.end());
+	unsigned int tics = max(settings.tics, 1u);
+
+	cout << "Tics per second: " << (seconds > 0 ? (unsigned int)(settings.tics / seconds) : 0) << endl;
+	cout << "Latency of a command: " << Percentile(latencies, 0.5f) << "ms (50%), " << Percentile(latencies, 0.9f) << "ms (90%), "
+		<< Percentile(latencies, 0.99f) << "ms (99%), " << (latencies.empty() ? 0 : latencies.back()) << "ms (max)" << endl;
+	cout << "Bytes per tic: " << results[0].bytesSent / tics << " sent by the server, "
+		<< clientBytes / (results.size() - 1) / tics << " sent by each client" << endl;
+	cout << "Waited for the network on " << stalls << " of " << settings.tics * results.size() << " tics ("
+		<< waitTime / results.size() << "ms per player). Up to " << maxQueuedTics << " tics were ready before they were used." << endl;
+	cout << (sync ? "Every player received the same tics." : "The players did not receive the same tics!") << endl;
+
+	return sync;
+}
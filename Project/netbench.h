@@ -0,0 +1,41 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// netbench.h
+// Measures the network code without a window. A server and its clients run in the same
+// process and play tics with random commands or with the commands of a demo.
+
+#ifndef NETBENCH_H
+#define NETBENCH_H
+
+#include <string>
+using namespace std;
+
+struct NetBenchSettings
+{
+	unsigned int clients = 7;
+	unsigned int tics = 2000;
+	unsigned int delay = 2;	// Input delay in tics
+	string transport = "inproc";	// inproc, ipc or tcp
+	string demo;	// Commands are taken from this demo if it's set
+	unsigned int rate = 0;	// Tics per second. Zero to go as fast as possible.
+	float loss = 0;	// Fraction of the packets that are dropped
+	unsigned int latency = 0;	// ms
+};
+
+// Prints the results. Returns false if the players did not all receive the same tics.
+bool NetBenchmark(const NetBenchSettings& settings);
+
+#endif	// NETBENCH_H
@@ -20,28 +20,124 @@
 #include <string>	// to_string
 #include <iostream>	// cout
 #include <vector>
-#include <cstring>	// memcpy
+#include <algorithm>	// find, min, max
+#include <cstring>	// memcmp, memcpy
+#include <chrono>
+#include <cstdint>
+#include <cstddef>	// ptrdiff_t
 #include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 #include "network.h"
+#include "packet.h"	/* WriteVarint, ReadVarint, WriteCommand, ReadCommand */
+#include "ticcmd.h"	/* Ticcmd::MAX_SIZE */
 
 using namespace std;
 using namespace zmq;
 
-Network::Network()
+// Tics that were not acknowledged are sent again in every packet, up to this many
+const unsigned int MAX_PACKET_TICS = 32;
+
+// Send the tics again if nothing arrived after this time while waiting (ms)
+const int RESEND_TIME = 50;
+
+// Tics that can be kept before the buffers grow
+const unsigned int INITIAL_SLOTS = 64;
+
+// Local checksums that are kept to be compared with the ones of the other players
+const unsigned int CHECKSUM_HISTORY = 128;
+
+// Size of the queues between the game and the thread of the socket
+const size_t QUEUE_SIZE = 256;
+
+// Longest time that the thread of the socket waits before it looks at the queues again (ms)
+const int IO_WAIT = 1;
+
+// After something happened, the thread of the socket doesn't wait for a while, because the game
+// can't wake it up without a system call. The next command is sent as soon as it's there.
+const chrono::microseconds IO_SPIN(1000);
+
+Network::Network(context_t* context)
+	: commandQueue_(QUEUE_SIZE), checksumQueue_(QUEUE_SIZE), ticQueue_(QUEUE_SIZE)
 {
 	id_ = 0;
+	server_ = false;
+	numOfPlayers_ = 1;
+	delay_ = 0;
+	tic_ = 0;
+	sendTic_ = 0;
+	received_ = 0;
+	acked_ = 0;
+	broadcastTic_ = 0;
+	historyStart_ = 0;
+	oldest_ = 0;
+	stalls_ = 0;
+	waitTime_ = 0;
+	maxQueuedTics_ = 0;
+	bytesSent_ = 0;
+	bytesReceived_ = 0;
+	sumSent_ = 0;
+	desyncFound_ = false;
+	desyncReady_ = false;
+	desyncTaken_ = false;
+	stop_ = false;
+	failed_ = false;
+	heard_ = 0;
+	loss_ = 0;
+	latency_ = chrono::milliseconds(0);
 	sock_ = nullptr;
-	context_ = nullptr;
+	context_ = context;
+	ownContext_ = context == nullptr;
 }
 
 Network::~Network()
 {
+	if (io_.joinable())
+	{
+		stop_ = true;
+		io_.join();
+	}
+
 	if (sock_)
 	{
-		delete sock_;
-		delete context_;
+		// The last packets may have been lost, so they're sent one more time without the simulated
+		// conditions. A peer that already left is not waited for.
+		int timeout = 0;
+		sock_->setsockopt(ZMQ_SNDTIMEO, &timeout, sizeof(int));
+
+		try
+		{
+			loss_ = 0;
+			latency_ = chrono::milliseconds(0);
+
+			// The last commands of the game may still be in the queue
+			if (!slots_.empty() && !failed_)
+			{
+				takeCommands();
+				takeChecksums();
+			}
+
+			for (unsigned int i = 0; i < delayed_.size(); i++)
+				sendMessage(delayed_[i].client, delayed_[i].data.data(), delayed_[i].data.size());
+
+			if (!slots_.empty())
+				resend();
+		}
+		catch (const runtime_error&)
+		{
+		}
+
+		// Give the packets some time to leave, but don't wait forever for a peer that's gone
+		int linger = 1000;
+		sock_->setsockopt(ZMQ_LINGER, &linger, sizeof(int));
 	}
+
+	delete sock_;
+
+	if (ownContext_)
+		delete context_;
 }
 
 bool Network::enabled()
@@ -55,92 +151,804 @@ unsigned int Network::myPlayer()
 	return id_;
 }
 
-void Network::send(const vector<unsigned char>& message)
+// Make room for the biggest commands
+void Network::prepareSlots()
 {
-	message_t request(message.size());
-	memcpy(request.data(), &message[0], message.size());
+	for (unsigned int i = 0; i < slots_.size(); i++)
+	{
+		slots_[i].commands.resize(numOfPlayers_);
 
+		for (unsigned int j = 0; j < numOfPlayers_; j++)
+			slots_[i].commands[j].reserve(Ticcmd::MAX_SIZE);
+
+		slots_[i].local.reserve(Ticcmd::MAX_SIZE);
+	}
+}
+
+// Allocate the buffers once the number of players is known
+void Network::initSlots()
+{
+	slots_.resize(INITIAL_SLOTS);
+	prepareSlots();
+
+	// The tics are copied to the game without allocating
+	for (unsigned int i = 0; i < ticQueue_.Capacity(); i++)
+	{
+		vector<vector<unsigned char>>& commands = ticQueue_.Item(i);
+		commands.resize(numOfPlayers_);
+
+		for (unsigned int j = 0; j < numOfPlayers_; j++)
+			commands[j].reserve(Ticcmd::MAX_SIZE);
+	}
+
+	localSums_.resize(CHECKSUM_HISTORY);
+	remoteSums_.resize(numOfPlayers_);
+	clientSumSent_.assign(numOfPlayers_, 0);
+
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		scratch_[i].resize(numOfPlayers_);
+
+		for (unsigned int j = 0; j < numOfPlayers_; j++)
+			scratch_[i][j].reserve(Ticcmd::MAX_SIZE);
+	}
+}
+
+// Buffers of a tic. There are more slots if the tic is too far ahead.
+Network::TicSlot& Network::slot(unsigned int tic)
+{
+	if (tic < oldest_)
+	{
+		throw runtime_error("Network error. Tic " + to_string(tic) + " was already released.");
+	}
+
+	if (tic - oldest_ >= slots_.size())
+	{
+		// Rare, so it's fine to allocate. The kept tics move to their new slot.
+		vector<TicSlot> slots(slots_.size() * 2);
+
+		for (unsigned int i = 0; i < slots_.size(); i++)
+		{
+			unsigned int kept = oldest_ + i;
+			slots[kept % slots.size()] = move(slots_[kept % slots_.size()]);
+		}
+
+		slots_.swap(slots);
+		prepareSlots();
+
+		return slot(tic);
+	}
+
+	return slots_[tic % slots_.size()];
+}
+
+// Clear the slots of the tics that are no longer needed so they can be used again
+void Network::release()
+{
+	unsigned int oldest = server_ ? min(tic_, historyStart_) : min(tic_, acked_);
+
+	while (oldest_ < oldest)
+	{
+		TicSlot& old = slots_[oldest_ % slots_.size()];
+
+		for (unsigned int i = 0; i < old.commands.size(); i++)
+			old.commands[i].clear();
+
+		old.local.clear();
+		oldest_++;
+	}
+}
+
+// The server's socket needs to know to which client a message goes
+void Network::sendMessage(const string& client, const void* data, size_t size)
+{
 	try
 	{
-		sock_->send(request);
+		if (!client.empty() && sock_->send(client.data(), client.size(), ZMQ_SNDMORE) == 0)
+		{
+			throw runtime_error("Network send error. Timed out while waiting for peer.");
+		}
+
+		if (sock_->send(data, size) == 0)
+		{
+			throw runtime_error("Network send error. Timed out while waiting for peer.");
+		}
 	}
 	catch (zmq::error_t const& err)
 	{
-		throw runtime_error("Network send error. Timed out while waiting for peer.");
+		throw runtime_error("Network send error. " + string(err.what()));
 	}
+
+	bytesSent_ += size;
+}
+
+// Packets of the game go through the simulated network conditions
+void Network::sendPacket(const string& client)
+{
+	if (loss_ > 0 && uniform_real_distribution<float>(0, 1)(random_) < loss_)
+		return;
+
+	if (latency_.count() > 0)
+	{
+		delayed_.push_back({chrono::steady_clock::now() + latency_, client, packet_});
+		return;
+	}
+
+	sendMessage(client, packet_.data(), packet_.size());
 }
 
-vector<unsigned char> Network::receive()
+// Send the packets that were held long enough
+void Network::sendDelayed()
 {
-	message_t message;
+	auto now = chrono::steady_clock::now();
 
+	while (!delayed_.empty() && delayed_.front().due <= now)
+	{
+		sendMessage(delayed_.front().client, delayed_.front().data.data(), delayed_.front().data.size());
+		delayed_.pop_front();
+	}
+}
+
+// The message is put in 'message_'. Returns false if 'wait' is false and there's no message.
+bool Network::receiveMessage(bool wait)
+{
 	try
 	{
-		sock_->recv(&message);
+		// The server gets the identity of the client first
+		message_t& first = server_ ? identity_ : message_;
+
+		if (!sock_->recv(&first, wait ? 0 : ZMQ_DONTWAIT))
+		{
+			if (!wait)
+				return false;
+
+			throw runtime_error("Network receive error. Timed out while waiting for peer.");
+		}
+
+		if (server_ && (!identity_.more() || !sock_->recv(&message_)))
+		{
+			throw runtime_error("Network receive error. Incomplete message.");
+		}
 	}
 	catch (zmq::error_t const& err)
 	{
+		throw runtime_error("Network receive error. " + string(err.what()));
+	}
+
+	bytesReceived_ += message_.size();
+	return true;
+}
+
+// Commands from a client. Each packet has every command that the server did not acknowledge yet.
+// Format: next tic needed from the server, first tic, number of tics, commands.
+void Network::storeCommands()
+{
+	unsigned int player = 1;
+	while (player < clients_.size() && (clients_[player].size() != identity_.size() ||
+		memcmp(clients_[player].data(), identity_.data(), identity_.size()) != 0))
+	{
+		player++;
+	}
+
+	if (player >= clients_.size())
+		return;
+
+	const unsigned char* pos = message_.data<unsigned char>();
+	const unsigned char* end = pos + message_.size();
+
+	clientAcked_[player] = max(clientAcked_[player], ReadVarint(pos, end));
+	uint32_t first = ReadVarint(pos, end);
+	uint32_t count = ReadVarint(pos, end);
+
+	// A packet that arrives after a newer one may leave a gap
+	if (first > clientReceived_[player] || count > MAX_PACKET_TICS)
+		return;
+
+	// Nothing new means that the client is waiting. It may have lost the tics that it needs.
+	if (first + count <= clientReceived_[player] && clientAcked_[player] < broadcastTic_)
+		sendTics(player);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		vector<unsigned char>& command = scratch_[i % 2][0];
+		ReadCommand(pos, end, command, i > 0 ? &scratch_[(i + 1) % 2][0] : nullptr);
+
+		// Tics that were already sent to everyone are ignored
+		if (first + i >= clientReceived_[player])
+			slot(first + i).commands[player] = command;
+	}
+
+	clientReceived_[player] = max(clientReceived_[player], first + count);
+	readChecksum(pos, end, player);
+}
+
+// Tics from the server. Format: next tic needed from this client, first tic, number of tics,
+// then the commands of every player for each tic.
+void Network::storeTics()
+{
+	const unsigned char* pos = message_.data<unsigned char>();
+	const unsigned char* end = pos + message_.size();
+
+	// Forget the local commands that the server has
+	acked_ = max(acked_, min(ReadVarint(pos, end), sendTic_));
+
+	uint32_t first = ReadVarint(pos, end);
+	uint32_t count = ReadVarint(pos, end);
+
+	if (first > received_ || count > MAX_PACKET_TICS)
+		return;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		vector<vector<unsigned char>>& commands = scratch_[i % 2];
+
+		for (unsigned int j = 0; j < numOfPlayers_; j++)
+		{
+			ReadCommand(pos, end, commands[j], i > 0 ? &scratch_[(i + 1) % 2][j] : nullptr);
+		}
+
+		if (first + i >= received_)
+		{
+			TicSlot& tic = slot(first + i);
+
+			for (unsigned int j = 0; j < numOfPlayers_; j++)
+				tic.commands[j] = commands[j];
+		}
+	}
+
+	received_ = max(received_, first + count);
+	release();
+	readChecksum(pos, end, 0);
+}
+
+bool Network::ticComplete(unsigned int tic)
+{
+	if (tic < oldest_ || tic - oldest_ >= slots_.size())
+		return false;
+
+	const TicSlot& found = slots_[tic % slots_.size()];
+
+	for (unsigned int i = 0; i < found.commands.size(); i++)
+	{
+		if (found.commands[i].empty())
+			return false;
+	}
+
+	return true;
+}
+
+// Send the tics that a client doesn't have yet
+void Network::sendTics(unsigned int player)
+{
+	unsigned int first = max(clientAcked_[player], historyStart_);
+	unsigned int count = min(broadcastTic_ - min(first, broadcastTic_), MAX_PACKET_TICS);
+
+	packet_.clear();
+	WriteVarint(packet_, clientReceived_[player]);
+	WriteVarint(packet_, first);
+	WriteVarint(packet_, count);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const vector<vector<unsigned char>>& commands = slot(first + i).commands;
+
+		for (unsigned int j = 0; j < commands.size(); j++)
+		{
+			WriteCommand(packet_, commands[j], i > 0 ? &slot(first + i - 1).commands[j] : nullptr);
+		}
+	}
+
+	writeChecksum(clientSumSent_[player]);
+	sendPacket(clients_[player]);
+}
+
+// Send the local commands that the server doesn't have yet
+void Network::sendCommands()
+{
+	unsigned int count = min(sendTic_ - acked_, MAX_PACKET_TICS);
+
+	packet_.clear();
+	WriteVarint(packet_, received_);
+	WriteVarint(packet_, acked_);
+	WriteVarint(packet_, count);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		WriteCommand(packet_, slot(acked_ + i).local, i > 0 ? &slot(acked_ + i - 1).local : nullptr);
+	}
+
+	writeChecksum(sumSent_);
+	sendPacket("");
+}
+
+// After the commands: the tic plus one (zero if there's no checksum), then the checksum
+void Network::writeChecksum(unsigned int& sent)
+{
+	if (!latestSum_.valid || latestSum_.tic < sent)
+	{
+		WriteVarint(packet_, 0);
+		return;
+	}
+
+	WriteVarint(packet_, latestSum_.tic + 1);
+
+	size_t pos = packet_.size();
+	packet_.resize(pos + Checksum::SIZE);
+	latestSum_.sum.Write(&packet_[pos]);
+
+	sent = latestSum_.tic + 1;
+}
+
+void Network::readChecksum(const unsigned char*& pos, const unsigned char* end, unsigned int player)
+{
+	uint32_t tic = pos < end ? ReadVarint(pos, end) : 0;
+	if (tic == 0)
+		return;
+
+	if (end - pos < (ptrdiff_t)Checksum::SIZE)
+		throw runtime_error("Network packet is incomplete.");
+
+	ChecksumEntry& remote = remoteSums_[player];
+	remote.tic = tic - 1;
+	remote.valid = true;
+	remote.sum.Read(pos);
+	pos += Checksum::SIZE;
+
+	compareChecksums(player);
+}
+
+// The server checks every client and the clients check the server
+void Network::compareChecksums(unsigned int player)
+{
+	const ChecksumEntry& remote = remoteSums_[player];
+	const ChecksumEntry& local = localSums_[remote.tic % localSums_.size()];
+
+	if (desyncFound_ || !remote.valid || !local.valid || local.tic != remote.tic || local.sum == remote.sum)
+		return;
+
+	desyncFound_ = true;
+	desync_ = "Desync with player " + to_string(player + 1) + " at tic " + to_string(remote.tic) + ": " + local.sum.Differences(remote.sum);
+	desyncReady_.store(true, memory_order_release);
+}
+
+void Network::takeChecksums()
+{
+	while (const ChecksumEntry* entry = checksumQueue_.Front())
+	{
+		ChecksumEntry& local = localSums_[entry->tic % localSums_.size()];
+		local = *entry;
+		latestSum_ = local;
+		checksumQueue_.Pop();
+
+		// The checksum of the other player may have arrived first
+		for (unsigned int i = 0; i < remoteSums_.size(); i++)
+		{
+			if (i != id_ && (server_ || i == 0))
+				compareChecksums(i);
+		}
+	}
+}
+
+void Network::sendChecksum(unsigned int tic, const Checksum& sum)
+{
+	start();
+
+	ChecksumEntry* entry;
+	while (!(entry = checksumQueue_.Back()))
+		wait();
+
+	entry->tic = tic;
+	entry->valid = true;
+	entry->sum = sum;
+	checksumQueue_.Push();
+}
+
+string Network::desync()
+{
+	check();
+
+	// The thread doesn't touch it once it's ready
+	if (desyncTaken_ || !desyncReady_.load(memory_order_acquire))
+		return "";
+
+	desyncTaken_ = true;
+	return desync_;
+}
+
+// Send every tic that is complete to everyone, in order
+void Network::broadcastTics()
+{
+	unsigned int first = broadcastTic_;
+
+	while (ticComplete(broadcastTic_))
+		broadcastTic_++;
+
+	if (broadcastTic_ == first)
+		return;
+
+	for (unsigned int i = 1; i < clients_.size(); i++)
+		sendTics(i);
+
+	// Forget what every client has
+	historyStart_ = broadcastTic_;
+	for (unsigned int i = 1; i < clients_.size(); i++)
+		historyStart_ = min(historyStart_, clientAcked_[i]);
+
+	release();
+}
+
+// Send again what the other side may not have
+void Network::resend()
+{
+	if (server_)
+	{
+		for (unsigned int i = 1; i < clients_.size(); i++)
+			sendTics(i);
+	}
+	else
+	{
+		sendCommands();
+	}
+}
+
+// Handle the messages that arrived. Waits up to 'timeout' ms for the first one.
+// Returns true if something arrived.
+bool Network::pump(int timeout)
+{
+	bool received = false;
+
+	sendDelayed();
+
+	if (timeout > 0)
+	{
+		// Wake up in time to send the delayed packets
+		if (!delayed_.empty())
+		{
+			auto due = chrono::duration_cast<chrono::milliseconds>(delayed_.front().due - chrono::steady_clock::now());
+			timeout = max(1, min(timeout, (int)due.count() + 1));
+		}
+
+		pollitem_t item = {static_cast<void*>(*sock_), 0, ZMQ_POLLIN, 0};
+		poll(&item, 1, timeout);
+		sendDelayed();
+	}
+
+	while (receiveMessage(false))
+	{
+		received = true;
+
+		if (server_)
+			storeCommands();
+		else
+			storeTics();
+	}
+
+	if (server_)
+		broadcastTics();
+
+	return received;
+}
+
+// Commands from the game, in order. Returns true if there was one.
+bool Network::takeCommands()
+{
+	bool taken = false;
+
+	while (const QueuedCommand* command = commandQueue_.Front())
+	{
+		TicSlot& tic = slot(sendTic_);
+
+		if (server_)
+			tic.commands[0].assign(command->data, command->data + command->size);
+		else
+			tic.local.assign(command->data, command->data + command->size);
+
+		commandQueue_.Pop();
+		sendTic_++;
+		taken = true;
+	}
+
+	// The server sends them with the tics of everyone
+	if (taken && !server_)
+		sendCommands();
+
+	return taken;
+}
+
+// The server has a tic once it sent it. A client has it once it's received.
+bool Network::ticReady(unsigned int tic)
+{
+	return tic < (server_ ? broadcastTic_ : received_);
+}
+
+// Give the game the tics that are ready, as long as there's room in the queue
+void Network::deliverTics()
+{
+	while (ticReady(tic_))
+	{
+		vector<vector<unsigned char>>* commands = ticQueue_.Back();
+		if (!commands)
+			break;
+
+		const TicSlot& tic = slot(tic_);
+		commands->resize(tic.commands.size());
+
+		for (unsigned int i = 0; i < commands->size(); i++)
+			(*commands)[i] = tic.commands[i];
+
+		ticQueue_.Push();
+		tic_++;
+	}
+
+	release();
+}
+
+static long long SteadyMilliseconds()
+{
+	return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Network::run()
+{
+	try
+	{
+		auto heard = chrono::steady_clock::now();
+		auto active = heard;
+		resent_ = heard;
+
+		while (!stop_.load(memory_order_acquire))
+		{
+			bool spinning = chrono::steady_clock::now() - active < IO_SPIN;
+			bool taken = takeCommands();
+			takeChecksums();
+
+			bool received = pump(spinning ? 0 : IO_WAIT);
+			deliverTics();
+
+			// Something may have been lost if nothing arrives for a while, so it's sent again
+			auto now = chrono::steady_clock::now();
+			if (received)
+			{
+				heard = now;
+				heard_.store(SteadyMilliseconds(), memory_order_relaxed);
+			}
+			else if (now - heard >= chrono::milliseconds(RESEND_TIME) && now - resent_ >= chrono::milliseconds(RESEND_TIME))
+			{
+				resend();
+				resent_ = now;
+			}
+
+			if (taken || received)
+				active = now;
+			else if (spinning)
+				this_thread::yield();
+		}
+	}
+	catch (...)
+	{
+		error_ = current_exception();
+		failed_.store(true, memory_order_release);
+	}
+}
+
+void Network::start()
+{
+	if (io_.joinable() || !sock_)
+		return;
+
+	heard_ = SteadyMilliseconds();
+	io_ = thread(&Network::run, this);
+}
+
+void Network::check()
+{
+	if (failed_.load(memory_order_acquire))
+		rethrow_exception(error_);
+}
+
+void Network::wait()
+{
+	check();
+
+	if (SteadyMilliseconds() - heard_.load(memory_order_relaxed) > TIMEOUT)
 		throw runtime_error("Network receive error. Timed out while waiting for peer.");
+
+	this_thread::sleep_for(chrono::microseconds(100));
+}
+
+void Network::sendCommand(const unsigned char* command, size_t size)
+{
+	start();
+
+	if (size > Ticcmd::MAX_SIZE)
+		throw runtime_error("Network send error. The command is too big.");
+
+	QueuedCommand* queued;
+	while (!(queued = commandQueue_.Back()))
+		wait();
+
+	memcpy(queued->data, command, size);
+	queued->size = size;
+	commandQueue_.Push();
+}
+
+void Network::sendCommand(const vector<unsigned char>& command)
+{
+	sendCommand(command.data(), command.size());
+}
+
+bool Network::pollTic(vector<vector<unsigned char>>& commands)
+{
+	check();
+
+	size_t queued = ticQueue_.Size();
+	const vector<vector<unsigned char>>* tic = ticQueue_.Front();
+	if (!tic)
+		return false;
+
+	maxQueuedTics_ = max(maxQueuedTics_, queued);
+	commands.resize(tic->size());
+
+	for (unsigned int i = 0; i < commands.size(); i++)
+		commands[i] = (*tic)[i];
+
+	ticQueue_.Pop();
+	return true;
+}
+
+void Network::receiveTic(vector<vector<unsigned char>>& commands)
+{
+	start();
+
+	if (!pollTic(commands))
+	{
+		stalls_++;
+		auto waiting = chrono::steady_clock::now();
+
+		// Nothing may have arrived for a while before the game started to wait
+		heard_ = max(heard_.load(), SteadyMilliseconds());
+
+		do
+			wait();
+		while (!pollTic(commands));
+
+		waitTime_ += chrono::duration<double, milli>(chrono::steady_clock::now() - waiting).count();
 	}
+}
+
+void Network::update(int timeout)
+{
+	start();
+	check();
+	this_thread::sleep_for(chrono::milliseconds(timeout));
+}
 
-	vector<unsigned char> v(message.size());
-	memcpy(v.data(), message.data(), message.size());
+unsigned int Network::delay()
+{
+	return delay_;
+}
 
-	return v;
+unsigned int Network::stalls()
+{
+	return stalls_;
 }
 
-void Network::sendString(const string& s)
+double Network::waitTime()
 {
-	message_t message(s.size());
-	memcpy(message.data(), s.data(), s.size());
+	return waitTime_;
+}
 
-	sock_->send(message);
+size_t Network::queuedTics()
+{
+	return ticQueue_.Size();
 }
 
-string Network::receiveString()
+size_t Network::maxQueuedTics()
 {
-	message_t reply;
-	sock_->recv(&reply);
+	return maxQueuedTics_;
+}
 
-	return string(static_cast<char*>(reply.data()), reply.size());
+size_t Network::bytesSent()
+{
+	return bytesSent_;
 }
 
-void Network::startServer(const string& port, const string& info)
+size_t Network::bytesReceived()
 {
-	context_ = new context_t(1);
-	sock_ = new socket_t(*context_, ZMQ_REP);
+	return bytesReceived_;
+}
+
+void Network::simulate(float loss, unsigned int latency)
+{
+	loss_ = loss;
+	latency_ = chrono::milliseconds(latency);
+	random_.seed(id_ + 1);
+}
+
+void Network::startServer(const string& port, const string& info, unsigned int numOfPlayers, unsigned int delay)
+{
+	if (!context_)
+		context_ = new context_t(1);
+
+	sock_ = new socket_t(*context_, ZMQ_ROUTER);
+	numOfPlayers_ = numOfPlayers;
+	delay_ = delay;
+	server_ = true;
+	id_ = 0;
 
 	cout << "Starting local server on port '" << port << "'" << endl;
-	sock_->bind("tcp://*:" + port);
+	sock_->bind(port.find("://") != string::npos ? port : "tcp://*:" + port);
 
-	// Init game
-	receiveString();
-	sendString(info);
+	// Wait for the other players
+	clients_.assign(1, "");
+	while (clients_.size() < numOfPlayers_)
+	{
+		receiveMessage(true);
+		string client(identity_.data<char>(), identity_.size());
+
+		if (find(clients_.begin(), clients_.end(), client) == clients_.end())
+		{
+			clients_.push_back(client);
+			cout << "Player " << clients_.size() << " joined (" << clients_.size() << "/" << numOfPlayers_ << ")" << endl;
+		}
+	}
+
+	clientReceived_.assign(numOfPlayers_, 0);
+	clientAcked_.assign(numOfPlayers_, 0);
+	initSlots();
+
+	// Init game. Each client is told which player it is.
+	for (unsigned int i = 1; i < clients_.size(); i++)
+	{
+		string settings = to_string(i) + '\n' + to_string(numOfPlayers_) + '\n' + to_string(delay_) + '\n' + info;
+		sendMessage(clients_[i], settings.data(), settings.size());
+	}
 
 	// Allow the socket to timeout while the game is running
 	sock_->setsockopt(ZMQ_RCVTIMEO, &TIMEOUT, sizeof(int));
 	sock_->setsockopt(ZMQ_SNDTIMEO, &TIMEOUT, sizeof(int));
-
-	id_ = 0;
 }
 
 string Network::connectClient(const string& location)
 {
-	context_ = new context_t(1);
-	sock_ = new socket_t(*context_, ZMQ_REQ);
+	if (!context_)
+		context_ = new context_t(1);
+
+	sock_ = new socket_t(*context_, ZMQ_DEALER);
 
 	cout << "Connecting to server at '" << location << "'" << endl;
-	sock_->connect("tcp://" + location);
+	sock_->connect(location.find("://") != string::npos ? location : "tcp://" + location);
 
 	// Init game
-	sendString("Hello, World!");
-	string settings = receiveString();
+	string hello = "Hello, World!";
+	sendMessage("", hello.data(), hello.size());
+
+	receiveMessage(true);
+	string settings(message_.data<char>(), message_.size());
+
+	// The first three lines are for the network
+	size_t first = settings.find('\n');
+	size_t second = first == string::npos ? string::npos : settings.find('\n', first + 1);
+	size_t third = second == string::npos ? string::npos : settings.find('\n', second + 1);
+	if (third == string::npos)
+	{
+		throw runtime_error("Invalid settings received from the server.");
+	}
+
+	id_ = stoi(settings.substr(0, first));
+	numOfPlayers_ = stoi(settings.substr(first + 1, second - first - 1));
+	delay_ = stoi(settings.substr(second + 1, third - second - 1));
+
+	if (id_ == 0 || id_ >= numOfPlayers_ || numOfPlayers_ > MAX_PLAYERS)
+	{
+		throw runtime_error("Invalid player number received from the server.");
+	}
+
+	initSlots();
 
 	// Allow the socket to timeout while the game is running
 	sock_->setsockopt(ZMQ_RCVTIMEO, &TIMEOUT, sizeof(int));
 	sock_->setsockopt(ZMQ_SNDTIMEO, &TIMEOUT, sizeof(int));
 
-	id_ = 1;
-
-	return settings;
+	return settings.substr(third + 1);
 }
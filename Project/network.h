@@ -16,22 +16,152 @@
 // network.h
 // Networking component
 
+#include "gamestate.h"	/* Checksum */
+#include "spscqueue.h"	/* SpscQueue */
+#include "ticcmd.h"	/* Ticcmd::MAX_SIZE */
+
 #include <zmq.hpp>
 #include <vector>
 #include <string>
+#include <deque>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <cstddef>
 
 using namespace std;
 using namespace zmq;
 
+const unsigned int MAX_PLAYERS = 64;	// The player's ID has 6 bits in a tic command
+
+// The server is player 0. Every client sends its commands to the server, which sends
+// the commands of every player back to everyone once it has all of them for a tic.
+// Commands are sent a few tics before they are used so the game doesn't wait for the network.
+// Every packet also has the tics that the other side did not acknowledge, so a lost packet doesn't stall the game.
+// Once the game starts, the socket is only used by a thread of its own. The game gives it the commands and takes
+// the tics through queues, so it never waits for the socket unless a tic is missing.
 class Network
 {
 private:
 	socket_t* sock_;
 	context_t* context_;
-	unsigned int id_;		// For 2 players, 0-1
+	bool ownContext_;	// False if the context is shared with other sockets of the process
+	unsigned int id_;		// 0 for the server
+	bool server_;
+	unsigned int numOfPlayers_;
+	unsigned int delay_;	// Input delay in tics
+	unsigned int tic_;	// Next tic to play
+	unsigned int sendTic_;	// Tic of the next local command
+	atomic<size_t> bytesSent_;
+	atomic<size_t> bytesReceived_;
+
+	// Buffers are kept from one tic to the other so nothing is allocated while the game runs
+	struct TicSlot
+	{
+		vector<vector<unsigned char>> commands;	// Empty if not received yet
+		vector<unsigned char> local;	// Command of the local player that the server may not have (client only)
+	};
+	vector<TicSlot> slots_;	// The slot of a tic is its number modulo the size
+	unsigned int oldest_;	// Oldest tic that is kept
+	vector<vector<unsigned char>> scratch_[2];	// Commands being decoded and the previous ones
+	vector<unsigned char> packet_;	// Packet being written
+	message_t identity_;	// Last message that was received and who sent it
+	message_t message_;
+
+	// Client only
+	unsigned int received_;	// Next tic to get from the server
+	unsigned int acked_;	// Next local command that the server needs
+
+	// Checksums of the game, to find desyncs. Each packet has the newest local checksum if it's new to the peer.
+	struct ChecksumEntry
+	{
+		unsigned int tic = 0;
+		bool valid = false;
+		Checksum sum;
+	};
+	vector<ChecksumEntry> localSums_;	// Of the last tics, indexed by tic
+	vector<ChecksumEntry> remoteSums_;	// Newest one received from each player
+	ChecksumEntry latestSum_;
+	unsigned int sumSent_;	// Next tic whose checksum can be sent to the server (client only)
+	vector<unsigned int> clientSumSent_;	// Same for each client (server only)
+	string desync_;
+	bool desyncFound_;
+	atomic<bool> desyncReady_;	// 'desync_' can be read by the game
+	bool desyncTaken_;	// It was returned to the game
+
+	// Network conditions that are simulated for testing
+	struct DelayedPacket
+	{
+		chrono::steady_clock::time_point due;
+		string client;
+		vector<unsigned char> data;
+	};
+	float loss_;
+	chrono::milliseconds latency_;
+	deque<DelayedPacket> delayed_;
+	minstd_rand random_;
+	chrono::steady_clock::time_point resent_;	// Last time that packets were sent again
+
+	// Server only
+	vector<string> clients_;	// Socket identity of each player. The server's own player has none.
+	vector<unsigned int> clientReceived_;	// Next tic to get from each client
+	vector<unsigned int> clientAcked_;	// Next tic that each client needs
+	unsigned int historyStart_;	// Tics before this one were received by every client
+	unsigned int broadcastTic_;	// Next tic to send to everyone
+
+	void initSlots();
+	void prepareSlots();
+	TicSlot& slot(unsigned int tic);
+	void release();
+	void sendMessage(const string& client, const void* data, size_t size);
+	void sendPacket(const string& client);	// Sends 'packet_'
+	void writeChecksum(unsigned int& sent);
+	void readChecksum(const unsigned char*& pos, const unsigned char* end, unsigned int player);
+	void compareChecksums(unsigned int player);
+	void sendDelayed();
+	bool receiveMessage(bool wait);	// The identity is only set on the server
+	void storeCommands();
+	void storeTics();
+	bool ticComplete(unsigned int tic);
+	bool ticReady(unsigned int tic);
+	void sendTics(unsigned int player);
+	void sendCommands();
+	void broadcastTics();
+	void resend();
+	bool pump(int timeout);
+
+	// Thread that uses the socket
+	struct QueuedCommand
+	{
+		unsigned char data[Ticcmd::MAX_SIZE];
+		size_t size;
+	};
+	SpscQueue<QueuedCommand> commandQueue_;	// Local commands, from the game
+	SpscQueue<ChecksumEntry> checksumQueue_;	// Local checksums, from the game
+	SpscQueue<vector<vector<unsigned char>>> ticQueue_;	// Commands of every player for the next tics, to the game
+	thread io_;
+	atomic<bool> stop_;
+	atomic<bool> failed_;
+	exception_ptr error_;	// Why the thread stopped. Rethrown on the game's thread.
+	atomic<long long> heard_;	// Last time something arrived, in ms of the steady clock
+
+	void start();	// Once the handshake is done and the network conditions are set
+	void run();
+	void check();	// Throws the error of the thread
+	bool takeCommands();
+	void takeChecksums();
+	void deliverTics();
+	void wait();	// Until the thread does something, or time out if the peers are gone
+
+	// Used by the game's thread only
+	unsigned int stalls_;	// Tics that had to wait for the network
+	double waitTime_;	// ms
+	size_t maxQueuedTics_;
 
 public:
-	Network();
+	Network(context_t* context = nullptr);	// A context is only needed to connect sockets of the same process (inproc)
 	~Network();
 
 	const int TIMEOUT = 10 * 1000;	// ms
@@ -39,16 +169,35 @@ public:
 	bool enabled();
 	unsigned int myPlayer();
 
-	// Used when sharing tic commands
-	void send(const vector<unsigned char>& message);
-	vector<unsigned char> receive();
+	// Send the local player's command. It's used 'delay' tics after the current tic.
+	void sendCommand(const unsigned char* command, size_t size);
+	void sendCommand(const vector<unsigned char>& command);
+
+	// Get the command of every player for the next tic. Only waits if one is missing.
+	// The vectors are reused, so nothing is allocated if the same ones are passed every tic.
+	void receiveTic(vector<vector<unsigned char>>& commands);
+	bool pollTic(vector<vector<unsigned char>>& commands);	// Doesn't wait. Returns false if the next tic is not there.
 
-	// Used when the server shares the game's settings with the client
-	void sendString(const string& s);
-	string receiveString();
+	// Checksum of the game after a tic. It's compared with the one of the other players.
+	void sendChecksum(unsigned int tic, const Checksum& sum);
+	string desync();	// Description of the first desync that was found. Only returned once.
 
-	// Handshake
-	void startServer(const string& port, const string& info);
+	// Wait for a peer that's done playing but must not leave before the others. The tics keep flowing.
+	void update(int timeout);
+
+	unsigned int delay();
+	unsigned int stalls();
+	double waitTime();	// Time spent waiting for tics, in ms
+	size_t queuedTics();	// Tics that arrived and were not taken by the game yet
+	size_t maxQueuedTics();
+	size_t bytesSent();
+	size_t bytesReceived();
+
+	// Drop a fraction of the packets that are sent and hold the others for a time. For testing.
+	void simulate(float loss, unsigned int latency);
+
+	// Handshake. The server waits until every player is connected.
+	// A port or location can be replaced by a ZeroMQ endpoint such as "ipc:///tmp/meshglide".
+	void startServer(const string& port, const string& info, unsigned int numOfPlayers, unsigned int delay);
 	string connectClient(const string& location);
 };
-
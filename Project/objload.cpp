@@ -0,0 +1,295 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// objload.cpp
+// Loads OBJ files on many threads. The file is cut in chunks of lines that
+// are parsed at the same time, then the chunks are put back together in order.
+
+#include "level.h"
+#include "plane.h"
+#include "vecmath.h"	/* Float3, Float2 */
+#include "strutils.h"	/* Split */
+#include "mapfile.h"	/* MappedFile */
+#include "threadpool.h"	/* ThreadPool */
+#include "log.h"	/* Log */
+
+#include <string>
+#include <vector>
+#include <cstdlib>	/* atof, atoi */
+#include <cstring>	/* memchr */
+#include <stdexcept>
+using namespace std;
+
+enum ObjRecordType: unsigned char
+{
+	OBJ_VERTEX,
+	OBJ_UV,
+	OBJ_NORMAL,
+	OBJ_FACE,
+	OBJ_STATEMENT,	// Must be handled in order with the rest of the file
+	OBJ_EMPTY	// Empty line or comment
+};
+
+// A line of the file
+struct ObjRecord
+{
+	ObjRecordType type;
+	unsigned int index;	// Index in the chunk's array for that type
+};
+
+// A corner of a face. Indices are as written in the file (starting at 1, or negative if relative).
+struct ObjCorner
+{
+	unsigned int count;	// Number of indices that were given
+	int vertex;
+	int uv;
+	int normal;
+};
+
+struct ObjFace
+{
+	unsigned char count;
+	ObjCorner corners[4];
+};
+
+struct ObjChunk
+{
+	const char* begin;
+	const char* end;
+
+	vector<ObjRecord> records;
+	vector<double> vertices;	// x, y, z as written. The scale is only known once the chunks are stitched.
+	vector<Float2> uvs;
+	vector<Float3> normals;
+	vector<ObjFace> faces;
+	vector<vector<string>> statements;
+};
+
+// Parse every line of a chunk. Only the chunk is modified.
+static void ParseObjChunk(ObjChunk& chunk)
+{
+	const char* pos = chunk.begin;
+
+	while (pos < chunk.end)
+	{
+		const char* eol = static_cast<const char*>(memchr(pos, '\n', chunk.end - pos));
+		if (!eol)
+			eol = chunk.end;
+
+		string Line(pos, eol);
+		pos = eol + 1;
+
+		if (Line.size() == 0 || Line[0] == '#')
+		{
+			chunk.records.push_back({OBJ_EMPTY, 0});
+			continue;
+		}
+
+		// Same rules as Level::LoadObj
+		vector<string> slices = Split(Line, ' ');
+
+		if (slices[0] == "v" && slices.size() == 4)
+		{
+			chunk.records.push_back({OBJ_VERTEX, (unsigned int)chunk.vertices.size() / 3});
+			chunk.vertices.push_back(atof(slices[1].c_str()));
+			chunk.vertices.push_back(atof(slices[2].c_str()));
+			chunk.vertices.push_back(atof(slices[3].c_str()));
+		}
+		else if (slices[0] == "vt" && slices.size() == 3)
+		{
+			chunk.records.push_back({OBJ_UV, (unsigned int)chunk.uvs.size()});
+			chunk.uvs.push_back({(float)atof(slices[1].c_str()), (float)atof(slices[2].c_str())});
+		}
+		else if (slices[0] == "vn" && slices.size() == 4)
+		{
+			chunk.records.push_back({OBJ_NORMAL, (unsigned int)chunk.normals.size()});
+			chunk.normals.push_back({(float)atof(slices[1].c_str()), (float)atof(slices[2].c_str()), (float)atof(slices[3].c_str())});
+		}
+		else if (slices[0] == "f" && (slices.size() == 4 || slices.size() == 5))
+		{
+			ObjFace face;
+			face.count = slices.size() - 1;
+
+			for (unsigned int i = 1; i < slices.size(); i++)
+			{
+				vector<string> indices = Split(slices[i], '/');
+				ObjCorner& corner = face.corners[i - 1];
+
+				corner.count = indices.size();
+				corner.vertex = atoi(indices[0].c_str());
+				corner.uv = indices.size() >= 2 ? atoi(indices[1].c_str()) : 0;	// Zero if the field is empty
+				corner.normal = indices.size() >= 3 ? atoi(indices[2].c_str()) : 0;
+			}
+
+			chunk.records.push_back({OBJ_FACE, (unsigned int)chunk.faces.size()});
+			chunk.faces.push_back(face);
+		}
+		else
+		{
+			chunk.records.push_back({OBJ_STATEMENT, (unsigned int)chunk.statements.size()});
+			chunk.statements.push_back(slices);
+		}
+	}
+}
+
+// Convert an index from the file to an index in an array of 'count' elements
+static unsigned int ResolveObjIndex(int index, unsigned int count, unsigned int line)
+{
+	// Negative indices are relative to the end of the list
+	long long resolved = index > 0 ? (long long)index - 1 : (long long)count + index;
+
+	if (index == 0 || resolved < 0 || resolved >= count)
+	{
+		throw runtime_error("Invalid index " + to_string(index) + " in a face at line " + to_string(line));
+	}
+
+	return resolved;
+}
+
+// Loading method for OBJ format that uses every core
+void Level::LoadObjParallel(const string& path, unsigned int numOfPlayers)
+{
+	Log() << "Loading 3D model: " << path << endl;
+
+	MappedFile model(path);
+	if (!model.IsOpen())
+	{
+		throw runtime_error("Unable to open level '" + path + "'");
+	}
+
+	string texture = "None";	// Current texture for plane
+	SkyTexture = "clouds.jpg";
+	AddTexture(SkyTexture, true);
+
+	ThreadPool pool;
+
+	// Cut the file in chunks that end at the end of a line
+	const char* data = reinterpret_cast<const char*>(model.Data());
+	const char* end = data + model.Size();
+	vector<ObjChunk> chunks(pool.Size() * 4);
+	const char* pos = data;
+
+	for (unsigned int i = 0; i < chunks.size(); i++)
+	{
+		const char* split = data + model.Size() * (i + 1) / chunks.size();
+
+		if (split < pos)
+			split = pos;
+
+		const char* eol = static_cast<const char*>(memchr(split, '\n', end - split));
+		split = eol ? eol + 1 : end;
+
+		chunks[i].begin = pos;
+		chunks[i].end = split;
+		pos = split;
+	}
+
+	pool.ParallelFor(chunks.size(), [&chunks](unsigned int first, unsigned int last)
+	{
+		for (unsigned int i = first; i < last; i++)
+			ParseObjChunk(chunks[i]);
+	});
+
+	// Put the chunks back together in the same order as the file
+	vector<Float3> temp_vertices;
+	vector<Float2> temp_uvs;
+	vector<Float3> temp_normals;
+	unsigned int Count = 0;
+
+	for (unsigned int c = 0; c < chunks.size(); c++)
+	{
+		ObjChunk& chunk = chunks[c];
+
+		for (unsigned int r = 0; r < chunk.records.size(); r++)
+		{
+			const ObjRecord& record = chunk.records[r];
+			Count++;
+
+			if (record.type == OBJ_VERTEX)
+			{
+				// Puts Z X Y into X Y Z because most OBJ exporters use this format
+				const double* v = &chunk.vertices[record.index * 3];
+				Float3 temp_vertex;
+				temp_vertex.x = v[2] * scaling_;
+				temp_vertex.y = v[0] * scaling_;
+				temp_vertex.z = v[1] * scaling_;
+				temp_vertices.push_back(temp_vertex);
+			}
+			else if (record.type == OBJ_UV)
+			{
+				temp_uvs.push_back(chunk.uvs[record.index]);
+			}
+			else if (record.type == OBJ_NORMAL)
+			{
+				temp_normals.push_back(chunk.normals[record.index]);
+			}
+			else if (record.type == OBJ_FACE)
+			{
+				const ObjFace& face = chunk.faces[record.index];
+
+				// Create a plane for a set of vertices
+				Plane* p = NewPlane();
+				p->Impassable = 1;
+				p->TwoSided = 0;
+				p->Xscale = 1;
+				p->Yscale = 1;
+				p->Light = 1;
+
+				// Assign the last specified texture if the plane is not invisible
+				if (texture != "None")
+				{
+					p->Texture = TextureName(texture);
+				}
+
+				unsigned int first = mesh_.Indices.size();
+				for (unsigned int i = 0; i < face.count; i++)
+				{
+					const ObjCorner& corner = face.corners[i];
+					unsigned int vertex = ResolveObjIndex(corner.vertex, temp_vertices.size(), Count);
+					unsigned int uv = OBJ_NO_UV;
+
+					// An empty texture coordinate, like in "1//3", means that there's none, like in Level::LoadObj
+					if (corner.count >= 2 && corner.uv != 0)
+					{
+						uv = ResolveObjIndex(corner.uv, temp_uvs.size(), Count);
+					}
+
+					if (corner.count == 3)
+					{
+						normals_.push_back(temp_normals[ResolveObjIndex(corner.normal, temp_normals.size(), Count)]);
+					}
+
+					mesh_.Indices.push_back(AddObjCorner(vertex, uv, temp_vertices, temp_uvs));
+				}
+
+				// The plane is processed later
+				p->SetVertices(&mesh_, first, face.count);
+				planes.push_back(p);
+			}
+			else if (record.type == OBJ_STATEMENT)
+			{
+				if (!ParseObjStatement(chunk.statements[record.index], texture, path))
+				{
+					Log() << "Skipped line " << Count << endl;
+				}
+			}
+		}
+
+		// Free the memory as soon as possible
+		chunk = ObjChunk();
+	}
+
+	FinishObj(numOfPlayers);
+}
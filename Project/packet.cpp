@@ -0,0 +1,227 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// packet.cpp
+// Compact encoding of the tic commands that are sent over the network
+
+#include "packet.h"
+#include "ticcmd.h"	/* Ticcmd::HEADER_SIZE */
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+using namespace std;
+
+// Fields of a command that changed
+enum CommandField: unsigned char
+{
+	FIELD_FLAGS = 1,	// Quit, fire and player ID
+	FIELD_FORWARD = 2,
+	FIELD_LATERAL = 4,
+	FIELD_ROTATION = 8,
+	FIELD_VERTICAL = 16,
+	FIELD_CHAT = 32
+};
+
+void WriteVarint(vector<unsigned char>& data, uint32_t value)
+{
+	while (value >= 0x80)
+	{
+		data.push_back((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	data.push_back(value);
+}
+
+uint32_t ReadVarint(const unsigned char*& pos, const unsigned char* end)
+{
+	uint32_t value = 0;
+
+	for (unsigned int shift = 0; shift < 35; shift += 7)
+	{
+		if (pos >= end)
+			throw runtime_error("Network packet is incomplete.");
+
+		unsigned char byte = *pos++;
+		value |= (uint32_t)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80))
+			return value;
+	}
+
+	throw runtime_error("Network packet has an invalid number.");
+}
+
+// Small negative numbers also take few bytes
+static uint32_t ZigZag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t UnZigZag(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Two bytes of a command, in the order they were written
+static uint16_t Get16(const unsigned char* command)
+{
+	return (command[0] << 8) | command[1];
+}
+
+static void Set16(unsigned char* command, uint16_t value)
+{
+	command[0] = value >> 8;
+	command[1] = value;
+}
+
+void WriteCommand(vector<unsigned char>& data, const vector<unsigned char>& command, const vector<unsigned char>* previous)
+{
+	static const unsigned char idle[Ticcmd::HEADER_SIZE] = {};
+	const unsigned char* cur = command.data();
+	const unsigned char* prev = previous ? previous->data() : idle;
+
+	if (command.size() < Ticcmd::HEADER_SIZE || (previous && previous->size() < Ticcmd::HEADER_SIZE))
+		throw runtime_error("Cannot send an incomplete command.");
+
+	unsigned char changed = 0;
+	if (cur[0] != prev[0])
+		changed |= FIELD_FLAGS;
+	if (cur[1] != prev[1])
+		changed |= FIELD_FORWARD;
+	if (cur[2] != prev[2])
+		changed |= FIELD_LATERAL;
+	if (Get16(cur + 3) != Get16(prev + 3))
+		changed |= FIELD_ROTATION;
+	if (Get16(cur + 5) != Get16(prev + 5))
+		changed |= FIELD_VERTICAL;
+	if (cur[7] > 0)
+		changed |= FIELD_CHAT;
+
+	data.push_back(changed);
+
+	if (changed & FIELD_FLAGS)
+		data.push_back(cur[0]);
+	if (changed & FIELD_FORWARD)
+		WriteVarint(data, ZigZag((signed char)cur[1] - (signed char)prev[1]));
+	if (changed & FIELD_LATERAL)
+		WriteVarint(data, ZigZag((signed char)cur[2] - (signed char)prev[2]));
+	if (changed & FIELD_ROTATION)
+		WriteVarint(data, ZigZag((int16_t)(Get16(cur + 3) - Get16(prev + 3))));
+	if (changed & FIELD_VERTICAL)
+		WriteVarint(data, ZigZag((int16_t)(Get16(cur + 5) - Get16(prev + 5))));
+
+	// The chat string is never the same from one tic to the other
+	if (changed & FIELD_CHAT)
+	{
+		unsigned int size = cur[7];
+		if (command.size() < Ticcmd::HEADER_SIZE + size)
+			throw runtime_error("Cannot send an incomplete command.");
+
+		data.push_back(size);
+		data.insert(data.end(), command.begin() + Ticcmd::HEADER_SIZE, command.begin() + Ticcmd::HEADER_SIZE + size);
+	}
+}
+
+void ReadCommand(const unsigned char*& pos, const unsigned char* end, vector<unsigned char>& command, const vector<unsigned char>* previous)
+{
+	if (pos >= end)
+		throw runtime_error("Network packet is incomplete.");
+
+	if (previous && previous->size() >= Ticcmd::HEADER_SIZE)
+		command.assign(previous->begin(), previous->begin() + Ticcmd::HEADER_SIZE);
+	else
+		command.assign(Ticcmd::HEADER_SIZE, 0);
+
+	unsigned char changed = *pos++;
+	unsigned char* cur = command.data();
+
+	if (changed & FIELD_FLAGS)
+	{
+		if (pos >= end)
+			throw runtime_error("Network packet is incomplete.");
+
+		cur[0] = *pos++;
+	}
+
+	if (changed & FIELD_FORWARD)
+		cur[1] += UnZigZag(ReadVarint(pos, end));
+	if (changed & FIELD_LATERAL)
+		cur[2] += UnZigZag(ReadVarint(pos, end));
+	if (changed & FIELD_ROTATION)
+		Set16(cur + 3, Get16(cur + 3) + UnZigZag(ReadVarint(pos, end)));
+	if (changed & FIELD_VERTICAL)
+		Set16(cur + 5, Get16(cur + 5) + UnZigZag(ReadVarint(pos, end)));
+
+	cur[7] = 0;
+
+	if (changed & FIELD_CHAT)
+	{
+		if (pos >= end || end - pos < 1 + *pos)
+			throw runtime_error("Network packet is incomplete.");
+
+		unsigned int size = *pos++;
+		command[7] = size;
+		command.insert(command.end(), pos, pos + size);
+		pos += size;
+	}
+}
+
+// Pairs of a run of zeros and a run of other bytes, after the total size
+void WritePacked(vector<unsigned char>& data, const vector<unsigned char>& bytes)
+{
+	WriteVarint(data, bytes.size());
+
+	size_t pos = 0;
+	while (pos < bytes.size())
+	{
+		size_t zeros = pos;
+		while (zeros < bytes.size() && bytes[zeros] == 0)
+			zeros++;
+
+		// A single zero between other bytes is cheaper to keep with them
+		size_t literals = zeros;
+		while (literals < bytes.size() && (bytes[literals] != 0 || (literals + 1 < bytes.size() && bytes[literals + 1] != 0)))
+			literals++;
+
+		WriteVarint(data, zeros - pos);
+		WriteVarint(data, literals - zeros);
+		data.insert(data.end(), bytes.begin() + zeros, bytes.begin() + literals);
+		pos = literals;
+	}
+}
+
+void ReadPacked(const unsigned char*& pos, const unsigned char* end, vector<unsigned char>& bytes)
+{
+	uint32_t size = ReadVarint(pos, end);
+	bytes.clear();
+	bytes.reserve(size);
+
+	while (bytes.size() < size)
+	{
+		uint32_t zeros = ReadVarint(pos, end);
+		uint32_t literals = ReadVarint(pos, end);
+
+		if (zeros + literals == 0 || (uint64_t)zeros + literals > size - bytes.size())
+			throw runtime_error("Network packet has invalid data.");
+		if (literals > (size_t)(end - pos))
+			throw runtime_error("Network packet is incomplete.");
+
+		bytes.resize(bytes.size() + zeros, 0);
+		bytes.insert(bytes.end(), pos, pos + literals);
+		pos += literals;
+	}
+}
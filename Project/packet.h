@@ -0,0 +1,39 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// packet.h
+// Compact encoding of the tic commands that are sent over the network
+
+#ifndef PACKET_H
+#define PACKET_H
+
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+// Small numbers take fewer bytes
+void WriteVarint(vector<unsigned char>& data, uint32_t value);
+uint32_t ReadVarint(const unsigned char*& pos, const unsigned char* end);
+
+// A command from Ticcmd::Serialize is written as its difference with the previous command of the
+// same player. Only the fields that changed are written. 'previous' is null if there's none.
+void WriteCommand(vector<unsigned char>& data, const vector<unsigned char>& command, const vector<unsigned char>* previous);
+void ReadCommand(const unsigned char*& pos, const unsigned char* end, vector<unsigned char>& command, const vector<unsigned char>* previous);
+
+// Bytes that have many zeros, like a saved game state. Runs of zeros are written as their length.
+void WritePacked(vector<unsigned char>& data, const vector<unsigned char>& bytes);
+void ReadPacked(const unsigned char*& pos, const unsigned char* end, vector<unsigned char>& bytes);
+
+#endif	// PACKET_H
@@ -44,13 +44,16 @@ float CapHeight(float point, float min, float max)
 // Test if the player is inside the polygon or touching one of its edges
 bool TouchesPlane(const Player* play, const Plane* p)
 {
+	Float3 vertices[Plane::MAX_VERTICES];
+	unsigned int count = p->GetVertices(vertices);
+
 	// Is the player inside the polygon?
-	if (pointInPoly(play->PosX(), play->PosY(), p->Vertices))
+	if (pointInPoly(play->PosX(), play->PosY(), vertices, count))
 		return true;
 
 	// Is the player touching one of the polygon's edges?
-	for (unsigned int i = 0, j = p->Vertices.size() - 1; i < p->Vertices.size(); j = i++)
-		if (lineCircle(p->Vertices[i].x, p->Vertices[i].y, p->Vertices[j].x, p->Vertices[j].y,play->PosX(), play->PosY(), play->Radius()))
+	for (unsigned int i = 0, j = count - 1; i < count; j = i++)
+		if (lineCircle(vertices[i].x, vertices[i].y, vertices[j].x, vertices[j].y,play->PosX(), play->PosY(), play->Radius()))
 			return true;
 
 	return false;
@@ -287,16 +290,17 @@ void Hitscan(Level* lvl, Player* play, const vector<Player*>& players)
 		// Check if point is valid
 		if (f.z != numeric_limits<float>::quiet_NaN())
 		{
-			vector<Float3> verts = lvl->planes[i]->Vertices;
+			Float3 verts[Plane::MAX_VERTICES];
+			unsigned int count = lvl->planes[i]->GetVertices(verts);
 
 			// Check if the point is inside the polygon (because a plane is infinite)
 			bool test = false;
 			if (lvl->planes[i]->normal.z >= THRESHOLD || lvl->planes[i]->normal.z <= -THRESHOLD)
-				test = pointInPoly(f.x, f.y, verts, 0, 1);	// xOy
+				test = pointInPoly(f.x, f.y, verts, count, 0, 1);	// xOy
 			else if (lvl->planes[i]->normal.x >= THRESHOLD || lvl->planes[i]->normal.x <= -THRESHOLD)
-				test = pointInPoly(f.y, f.z, verts, 1, 2);	// yOz
+				test = pointInPoly(f.y, f.z, verts, count, 1, 2);	// yOz
 			else if (lvl->planes[i]->normal.y >= THRESHOLD || lvl->planes[i]->normal.y <= -THRESHOLD)
-				test = pointInPoly(f.z, f.x, verts, 2, 0);	// zOx
+				test = pointInPoly(f.z, f.x, verts, count, 2, 0);	// zOx
 			else
 				throw runtime_error("Caught a polygon with the following normal:\n" +
 					to_string(lvl->planes[i]->normal.x) + ", " + to_string(lvl->planes[i]->normal.y) + ", " + to_string(lvl->planes[i]->normal.z));
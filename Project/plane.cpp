@@ -24,11 +24,58 @@
 
 using namespace std;
 
+void PlaneMesh::Clear()
+{
+	Vertices.clear();
+	UVs.clear();
+	Indices.clear();
+}
+
+void Plane::SetVertices(const PlaneMesh* mesh, unsigned int firstIndex, unsigned int numVertices)
+{
+	mesh_ = mesh;
+	firstIndex_ = firstIndex;
+	numVertices_ = numVertices;
+}
+
+unsigned int Plane::NumVertices() const
+{
+	return numVertices_;
+}
+
+unsigned int Plane::FirstIndex() const
+{
+	return firstIndex_;
+}
+
+const Float3& Plane::Vertex(unsigned int i) const
+{
+	return mesh_->Vertices[mesh_->Indices[firstIndex_ + i]];
+}
+
+const Float2& Plane::UV(unsigned int i) const
+{
+	return mesh_->UVs[mesh_->Indices[firstIndex_ + i]];
+}
+
+unsigned int Plane::GetVertices(Float3* vertices) const
+{
+	for (unsigned int i = 0; i < numVertices_; i++)
+	{
+		vertices[i] = mesh_->Vertices[mesh_->Indices[firstIndex_ + i]];
+	}
+
+	return numVertices_;
+}
+
 // Process a plane
 void Plane::Process()
 {
-	normal = ComputeNormal(Vertices);
-	centroid = ComputeAverage(Vertices);
+	Float3 vertices[MAX_VERTICES];
+	unsigned int count = GetVertices(vertices);
+
+	normal = ComputeNormal(vertices);
+	centroid = ComputeAverage(vertices, count);
 	SetBox();
 }
 
@@ -42,28 +89,36 @@ void Plane::SetBox()
 	min.y = numeric_limits<float>::max();
 	min.z = numeric_limits<float>::max();
 
-	for (unsigned int i = 0; i < Vertices.size(); i++)
+	for (unsigned int v = 0; v < numVertices_; v++)
 	{
+		const Float3& vertex = Vertex(v);
+
 		// x
-		if (Vertices[i].x < min.x)
-			min.x = Vertices[i].x;
-		if (Vertices[i].x > max.x)
-			max.x = Vertices[i].x;
+		if (vertex.x < min.x)
+			min.x = vertex.x;
+		if (vertex.x > max.x)
+			max.x = vertex.x;
 
 		// y
-		if (Vertices[i].y < min.y)
-			min.y = Vertices[i].y;
-		if (Vertices[i].y > max.y)
-			max.y = Vertices[i].y;
+		if (vertex.y < min.y)
+			min.y = vertex.y;
+		if (vertex.y > max.y)
+			max.y = vertex.y;
 
 		// z
-		if (Vertices[i].z < min.z)
-			min.z = Vertices[i].z;
-		if (Vertices[i].z > max.z)
-			max.z = Vertices[i].z;
+		if (vertex.z < min.z)
+			min.z = vertex.z;
+		if (vertex.z > max.z)
+			max.z = vertex.z;
 	}
 }
 
+void Plane::SetBox(const Float3& low, const Float3& high)
+{
+	min = low;
+	max = high;
+}
+
 bool Plane::InBox2D(float x, float y, float radius) const
 {
 	// x
@@ -81,17 +136,22 @@ bool Plane::InBox2D(float x, float y, float radius) const
 	return true;
 }
 
+// '1' points up (floor) and '0' points to the side (wall)
+// At '0.7', it's a 45 degrees climb.
+static const float WALL_ANGLE = 0.4f;
+
 bool Plane::CanWalk() const
 {
-	// '1' points up (floor) and '0' points to the side (wall)
-	// At '0.7', it's a 45 degrees climb.
-	const float WALL_ANGLE = 0.4f;
-
 	if (Impassable && normal.z < WALL_ANGLE && normal.z > -WALL_ANGLE)
 		return false;
 	return true;
 }
 
+bool Plane::IsFloor() const
+{
+	return !(normal.z < WALL_ANGLE && normal.z > -WALL_ANGLE);
+}
+
 float Plane::Max() const
 {
 	return max.z;
@@ -102,6 +162,16 @@ float Plane::Min() const
 	return min.z;
 }
 
+Float3 Plane::BoxMax() const
+{
+	return max;
+}
+
+Float3 Plane::BoxMin() const
+{
+	return min;
+}
+
 float Plane::Angle() const
 {
 	// Return an angle that can be used for sliding if this plane cannot be entered
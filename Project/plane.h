@@ -14,7 +14,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 // plane.h
-// Plane are used to represent polygons in the world
+// Plane are used to represent polygons in the world. They are allocated in the level's arena.
 
 #ifndef PLANE_H
 #define PLANE_H
@@ -27,14 +27,24 @@
 
 using namespace std;
 
+// Geometry of a level. Vertices are stored once and shared by the planes.
+struct PlaneMesh
+{
+	vector<Float3> Vertices;
+	vector<Float2> UVs;	// One per vertex, or empty if the level has no UVs
+	vector<unsigned int> Indices;	// Each plane is a range of indices
+
+	void Clear();
+};
+
 class Plane
 {
 public:
-	string Texture;
+	static const unsigned int MAX_VERTICES = 4;	// Planes are triangles or quads
+
+	const string* Texture = nullptr;	// Name shared by every plane that uses it. Null if the plane is invisible.
 	bool Impassable = true;
 	bool TwoSided = false;
-	vector<Float3> Vertices;
-	vector<Float2> UVs;
 	float Xscale = 0;
 	float Yscale = 0;
 	float Xoff = 0;
@@ -43,24 +53,38 @@ public:
 
 	Float3 normal;
 	Float3 centroid;
-	vector<Plane*> Neighbors;	// List of adjacent planes
 
 private:
 	Float3 max;		// Maximal coordinates
 	Float3 min;		// Minimal coordinates
 
+	const PlaneMesh* mesh_ = nullptr;
+	unsigned int firstIndex_ = 0;
+	unsigned int numVertices_ = 0;
+
 public:
+	void SetVertices(const PlaneMesh* mesh, unsigned int firstIndex, unsigned int numVertices);
+	unsigned int NumVertices() const;
+	unsigned int FirstIndex() const;
+	const Float3& Vertex(unsigned int i) const;
+	const Float2& UV(unsigned int i) const;
+	unsigned int GetVertices(Float3* vertices) const;	// Copy the vertices to an array of MAX_VERTICES
+
 	float Max() const;
 	float Min() const;
+	Float3 BoxMax() const;
+	Float3 BoxMin() const;
 
 	float Angle() const;
 
 	void Process();		// Find centroid, find normal...
 
 	void SetBox();
+	void SetBox(const Float3& low, const Float3& high);	// Use a box that was already computed
 	bool InBox2D(float x, float y, float radius) const;
 
 	bool CanWalk() const;
+	bool IsFloor() const;	// Floors, slopes and ceilings, even if they are not impassable
 };
 
 #endif /* PLANE_H */
@@ -93,7 +93,7 @@ vector<unsigned char> Player::CmdToNet() const
 }
 
 // Decodes a player's data from a buffer and write to command
-void Player::NetToCmd(vector<unsigned char> v)
+void Player::NetToCmd(const vector<unsigned char>& v)
 {
 	// Deserialize the command
 	Cmd.Deserialize(v);
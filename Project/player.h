@@ -45,9 +45,9 @@ public:
 	char MoX = 0;		// Speed vector (momentum)
 	char MoY = 0;
 	char MoZ = 0;		// Used by gravity
-	const float MaxStep = 1.0f;
-	const float Radius_ = 0.5f;
-	const float Height_ = 2.0f;
+	static constexpr float MaxStep = 1.0f;	// Static so the navmesh can use them without a player
+	static constexpr float Radius_ = 0.5f;
+	static constexpr float Height_ = 2.0f;
 
 	int AirTime = 0;	// When the player falls
 	bool ShouldFire = false;
@@ -86,7 +86,7 @@ public:
 
 	// Command transfer
 	vector<unsigned char> CmdToNet() const;
-	void NetToCmd(vector<unsigned char> v);
+	void NetToCmd(const vector<unsigned char>& v);
 
 	float GetRadianAngle(short Angle) const;
 	float Radius() const;
@@ -0,0 +1,240 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// rollback.cpp
+// Plays tics before the commands of the other players arrive by guessing them.
+// When a guess was wrong, the game goes back to that tic and plays it again.
+
+#include "rollback.h"
+#include "gamestate.h"
+#include "level.h"
+#include "player.h"
+#include "ticcmd.h"
+
+#include <vector>
+#include <iostream>	/* cout */
+#include <chrono>
+#include <algorithm>	/* min, max */
+using namespace std;
+
+Rollback::Rollback(Level* lvl, unsigned int me, unsigned int maxTics, float budget, TicFunction playTic)
+	: lvl_(lvl), me_(me), maxTics_(max(maxTics, 1u)), budget_(budget), playTic_(playTic)
+{
+	states_.resize(maxTics_ + 1);
+	commands_.resize(maxTics_ + 1);
+	checksums_.resize(maxTics_ + 1);
+	replayFrom_ = tic_;
+
+	// Until something arrives, the players are guessed to do nothing
+	for (unsigned int i = 0; i < lvl_->players.size(); i++)
+	{
+		Ticcmd idle;
+		idle.id = i;
+		lastConfirmed_.push_back(idle.Serialize());
+		lastConfirmed_.back().reserve(Ticcmd::MAX_SIZE);
+	}
+
+	// The commands are copied in buffers that are big enough for any command, so nothing is allocated on each tic
+	ahead_ = TicRing<vector<vector<unsigned char>>>(maxTics_ + 1);
+	localCommands_ = TicRing<vector<unsigned char>>(maxTics_ + 1);
+
+	for (vector<vector<unsigned char>>& commands: ahead_.Items())
+	{
+		commands.resize(lvl_->players.size());
+		for (vector<unsigned char>& command: commands)
+			command.reserve(Ticcmd::MAX_SIZE);
+	}
+
+	for (vector<unsigned char>& command: localCommands_.Items())
+		command.reserve(Ticcmd::MAX_SIZE);
+
+	for (unsigned int i = 0; i < commands_.size(); i++)
+	{
+		commands_[i].resize(lvl_->players.size());
+		for (vector<unsigned char>& command: commands_[i])
+			command.reserve(Ticcmd::MAX_SIZE);
+	}
+}
+
+unsigned int Rollback::Slot(unsigned int tic) const
+{
+	return tic % states_.size();
+}
+
+void Rollback::AddLocalCommand(const unsigned char* command, size_t size)
+{
+	localCommands_.Back().assign(command, command + size);
+	localCommands_.Push();
+}
+
+void Rollback::AddLocalCommand(const vector<unsigned char>& command)
+{
+	AddLocalCommand(command.data(), command.size());
+}
+
+void Rollback::Confirm(const vector<vector<unsigned char>>& commands)
+{
+	if (confirmed_ < tic_)
+	{
+		// The tic was played with guesses. Play it again if one of them was wrong.
+		if (commands != commands_[Slot(confirmed_)])
+		{
+			replayFrom_ = min(replayFrom_, confirmed_);
+			commands_[Slot(confirmed_)] = commands;
+		}
+	}
+	else
+	{
+		ahead_.Back() = commands;
+		ahead_.Push();
+	}
+
+	// The next guesses are the same commands without the chat
+	lastConfirmed_ = commands;
+	for (unsigned int i = 0; i < lastConfirmed_.size(); i++)
+	{
+		if (lastConfirmed_[i].size() >= Ticcmd::HEADER_SIZE)
+		{
+			lastConfirmed_[i].resize(Ticcmd::HEADER_SIZE);
+			lastConfirmed_[i][Ticcmd::HEADER_SIZE - 1] = 0;
+		}
+	}
+
+	if (!localCommands_.Empty())
+		localCommands_.Pop();
+
+	confirmed_++;
+}
+
+bool Rollback::CanAdvance() const
+{
+	// Don't go further than what can be played again in the time budget
+	unsigned int depth = maxTics_;
+	if (ticTime_ > 0)
+		depth = max(1u, min(maxTics_, (unsigned int)(budget_ / ticTime_)));
+
+	return tic_ < confirmed_ + depth;
+}
+
+// Commands for a tic that was not confirmed
+void Rollback::Guess(unsigned int tic, vector<vector<unsigned char>>& commands) const
+{
+	commands = lastConfirmed_;
+
+	if (me_ < commands.size() && tic - confirmed_ < localCommands_.Size())
+		commands[me_] = localCommands_[tic - confirmed_];
+}
+
+void Rollback::Play(unsigned int tic)
+{
+	vector<vector<unsigned char>>& commands = commands_[Slot(tic)];
+
+	if (tic >= confirmed_)
+	{
+		Guess(tic, commands);
+	}
+	else if (tic == tic_ && !ahead_.Empty())
+	{
+		// Copied so both buffers are kept
+		commands = ahead_.Front();
+		ahead_.Pop();
+	}
+
+	states_[Slot(tic)].Save(*lvl_);
+
+	for (unsigned int i = 0; i < commands.size() && i < lvl_->players.size(); i++)
+		lvl_->players[i]->NetToCmd(commands[i]);
+
+	playTic_();
+	checksums_[Slot(tic)] = TicChecksum(*lvl_);
+}
+
+void Rollback::Advance()
+{
+	if (replayFrom_ < tic_)
+	{
+		// Go back to the first tic that was guessed wrong and play again up to now
+		auto start = chrono::steady_clock::now();
+		unsigned int depth = tic_ - replayFrom_;
+
+		states_[Slot(replayFrom_)].Restore(*lvl_);
+
+		for (unsigned int tic = replayFrom_; tic < tic_; tic++)
+			Play(tic);
+
+		rollbacks_++;
+		replayedTics_ += depth;
+		maxDepth_ = max(maxDepth_, depth);
+		replayTime_ += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	auto start = chrono::steady_clock::now();
+
+	Play(tic_);
+	tic_++;
+	replayFrom_ = tic_;
+
+	float time = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+	ticTime_ = ticTime_ > 0 ? ticTime_ * 0.9f + time * 0.1f : time;
+}
+
+unsigned int Rollback::Tic() const
+{
+	return tic_;
+}
+
+unsigned int Rollback::ConfirmedTic() const
+{
+	return confirmed_;
+}
+
+unsigned int Rollback::FinalTic() const
+{
+	return min(confirmed_, replayFrom_);
+}
+
+const vector<vector<unsigned char>>& Rollback::FinalCommands(unsigned int tic) const
+{
+	return commands_[Slot(tic)];
+}
+
+const Checksum& Rollback::FinalChecksum(unsigned int tic) const
+{
+	return checksums_[Slot(tic)];
+}
+
+const GameState& Rollback::FinalState(unsigned int tic) const
+{
+	return states_[Slot(tic)];
+}
+
+void Rollback::Finish()
+{
+	while (FinalTic() < confirmed_)
+		Advance();
+}
+
+void Rollback::PrintStats() const
+{
+	cout << "Rollback: went back " << rollbacks_ << " times and played " << replayedTics_ << " tics again";
+
+	if (rollbacks_ > 0)
+	{
+		cout << " (" << (float)replayedTics_ / rollbacks_ << " tics on average, " << maxDepth_ << " at most, "
+			<< replayTime_ / rollbacks_ << "ms on average)";
+	}
+
+	cout << "." << endl;
+}
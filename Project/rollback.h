@@ -0,0 +1,160 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// rollback.h
+// Plays tics before the commands of the other players arrive by guessing them.
+// When a guess was wrong, the game goes back to that tic and plays it again.
+
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include "gamestate.h"	/* GameState, Checksum */
+
+#include <vector>
+#include <functional>
+#include <cstddef>
+using namespace std;
+
+class Level;
+
+// Queue whose elements are created once and reused, like SpscQueue, but for a single thread.
+// It only allocates when it's full, which is rare.
+template<class T> class TicRing
+{
+public:
+	explicit TicRing(size_t capacity = 1): items_(capacity > 0 ? capacity : 1) {}
+
+	T& Back()	// Element that will be filled next. What it holds must be overwritten.
+	{
+		if (count_ == items_.size())
+		{
+			// The elements move to the new ring in order
+			vector<T> items(items_.size() * 2);
+			for (size_t i = 0; i < count_; i++)
+				items[i] = move(items_[(head_ + i) % items_.size()]);
+
+			items_.swap(items);
+			head_ = 0;
+		}
+
+		return items_[(head_ + count_) % items_.size()];
+	}
+
+	void Push()	// The element from Back() is added
+	{
+		count_++;
+	}
+
+	T& Front()
+	{
+		return items_[head_];
+	}
+
+	void Pop()
+	{
+		head_ = (head_ + 1) % items_.size();
+		count_--;
+	}
+
+	const T& operator[](size_t index) const	// From the front
+	{
+		return items_[(head_ + index) % items_.size()];
+	}
+
+	size_t Size() const
+	{
+		return count_;
+	}
+
+	bool Empty() const
+	{
+		return count_ == 0;
+	}
+
+	vector<T>& Items()	// Every element, used or not
+	{
+		return items_;
+	}
+
+private:
+	vector<T> items_;
+	size_t head_ = 0;
+	size_t count_ = 0;
+};
+
+class Rollback
+{
+public:
+	typedef function<void()> TicFunction;	// Plays one tic with the commands that the players have
+
+	// 'maxTics' is how far the game can go ahead of the commands that arrived.
+	// 'budget' is the time in ms that can be spent playing tics again on a frame.
+	Rollback(Level* lvl, unsigned int me, unsigned int maxTics, float budget, TicFunction playTic);
+
+	// The command of the local player for its next tic
+	void AddLocalCommand(const unsigned char* command, size_t size);
+	void AddLocalCommand(const vector<unsigned char>& command);
+
+	// The commands of every player for the next tic, as sent by the server
+	void Confirm(const vector<vector<unsigned char>>& commands);
+
+	bool CanAdvance() const;	// False if the game is too far ahead
+	void Advance();	// Go back if a guess was wrong, then play the next tic
+
+	unsigned int Tic() const;	// Next tic to play
+	unsigned int ConfirmedTic() const;	// Next tic to confirm
+
+	// Tics before this one were played with confirmed commands and won't be played again.
+	// Their commands and checksum are kept until the game is 'maxTics' tics further.
+	unsigned int FinalTic() const;
+	const vector<vector<unsigned char>>& FinalCommands(unsigned int tic) const;
+	const Checksum& FinalChecksum(unsigned int tic) const;
+	const GameState& FinalState(unsigned int tic) const;	// Before the tic
+
+	void Finish();	// Play the confirmed tics that were not final yet. Used when the game ends.
+
+	void PrintStats() const;
+
+private:
+	Level* lvl_;
+	unsigned int me_;
+	unsigned int maxTics_;
+	float budget_;
+	TicFunction playTic_;
+
+	unsigned int tic_ = 0;
+	unsigned int confirmed_ = 0;
+	unsigned int replayFrom_;	// First tic that must be played again. Equals 'tic_' if there's none.
+
+	vector<GameState> states_;	// Before each tic that was not confirmed, indexed by tic
+	vector<vector<vector<unsigned char>>> commands_;	// Commands used to play each tic, indexed by tic
+	vector<Checksum> checksums_;	// After each tic, indexed by tic
+	vector<vector<unsigned char>> lastConfirmed_;	// To guess the next commands
+	TicRing<vector<vector<unsigned char>>> ahead_;	// Confirmed tics that were not played yet, starting at 'tic_'
+	TicRing<vector<unsigned char>> localCommands_;	// Starting at 'confirmed_'
+	float ticTime_ = 0;	// Average time to play a tic in ms
+
+	// Stats
+	unsigned int rollbacks_ = 0;
+	unsigned int replayedTics_ = 0;
+	unsigned int maxDepth_ = 0;
+	double replayTime_ = 0;	// ms
+
+	unsigned int Slot(unsigned int tic) const;
+	void Guess(unsigned int tic, vector<vector<unsigned char>>& commands) const;
+	void Play(unsigned int tic);
+};
+
+#endif	// ROLLBACK_H
@@ -0,0 +1,160 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// sight.cpp
+// Line of sight queries of the bots
+
+#include "sight.h"
+#include "level.h"	/* Level */
+#include "plane.h"	/* Plane */
+#include "vecmath.h"	/* Float3, pointInPoly */
+#include "threadpool.h"	/* ThreadPool */
+
+#include <cmath>
+#include <algorithm>	/* fill */
+#include <vector>
+using namespace std;
+
+// Smaller batches are not worth sending to other threads
+const unsigned int SIGHT_PARALLEL_QUERIES = 64;
+
+// Memory used to answer a query. Each thread has its own.
+struct SightScratch
+{
+	vector<unsigned int> planes;	// Planes along the line
+	vector<uint32_t> tested;	// Equals 'query' if the plane was already tested for the current query
+	uint32_t query = 0;
+};
+
+static thread_local SightScratch scratch_;
+
+LineOfSight::LineOfSight(const Level& level, ThreadPool* pool): level_(level), pool_(pool)
+{
+	// Empty
+}
+
+void LineOfSight::Submit(uint32_t key, const Float3& from, const Float3& to)
+{
+	queries_.push_back({key, from, to});
+}
+
+void LineOfSight::Submit(const vector<SightQuery>& queries)
+{
+	queries_.insert(queries_.end(), queries.begin(), queries.end());
+}
+
+void LineOfSight::Resolve()
+{
+	blocked_.resize(queries_.size());
+
+	auto body = [this](unsigned int first, unsigned int last)
+	{
+		for (unsigned int i = first; i < last; i++)
+			blocked_[i] = Blocked(queries_[i].from, queries_[i].to);
+	};
+
+	if (pool_ && queries_.size() >= SIGHT_PARALLEL_QUERIES)
+		pool_->ParallelFor(queries_.size(), body);
+	else
+		body(0, queries_.size());
+
+	// In the order they were submitted, so the last query with a key is the one that counts
+	for (unsigned int i = 0; i < queries_.size(); i++)
+	{
+		if (queries_[i].key >= answers_.size())
+			answers_.resize(queries_[i].key + 1, UNKNOWN);
+
+		answers_[queries_[i].key] = blocked_[i] ? BLOCKED : VISIBLE;
+	}
+
+	resolved_ = queries_.size();
+	queries_.clear();
+}
+
+LineOfSight::Answer LineOfSight::Get(uint32_t key) const
+{
+	return key < answers_.size() ? answers_[key] : UNKNOWN;
+}
+
+unsigned int LineOfSight::Resolved() const
+{
+	return resolved_;
+}
+
+// Every plane blocks the sight, like for the hitscan. Only the planes in the blocks along the line are tested.
+bool LineOfSight::Blocked(const Float3& from, const Float3& to) const
+{
+	SightScratch& s = scratch_;
+	level_.getPlanesForLine(from.x, from.y, to.x, to.y, s.planes);
+
+	if (s.tested.size() < level_.planes.size())
+		s.tested.resize(level_.planes.size(), 0);
+
+	// The marks of the previous queries don't have to be cleared
+	if (++s.query == 0)
+	{
+		fill(s.tested.begin(), s.tested.end(), 0);
+		s.query = 1;
+	}
+
+	const Float3 ray = {to.x - from.x, to.y - from.y, to.z - from.z};
+	const float low = min(from.z, to.z);
+	const float high = max(from.z, to.z);
+
+	for (unsigned int i = 0; i < s.planes.size(); i++)
+	{
+		unsigned int index = s.planes[i];
+
+		if (s.tested[index] == s.query)
+			continue;
+
+		s.tested[index] = s.query;
+		const Plane* p = level_.planes[index];
+
+		if (high < p->Min() || low > p->Max())
+			continue;
+
+		// The points must be on both sides of the plane
+		float before = dotProduct(p->normal, subVectors(from, p->centroid));
+		float after = dotProduct(p->normal, subVectors(to, p->centroid));
+
+		if (before * after >= 0)
+			continue;
+
+		float t = before / (before - after);
+		Float3 hit = {from.x + ray.x * t, from.y + ray.y * t, from.z + ray.z * t};
+
+		// Check if the point is inside the polygon, seen from the side that it faces the most
+		Float3 vertices[Plane::MAX_VERTICES];
+		unsigned int count = p->GetVertices(vertices);
+		float nx = fabs(p->normal.x);
+		float ny = fabs(p->normal.y);
+		float nz = fabs(p->normal.z);
+		bool inside;
+
+		if (nz >= nx && nz >= ny)
+			inside = pointInPoly(hit.x, hit.y, vertices, count, 0, 1);	// xOy
+		else if (nx >= ny)
+			inside = pointInPoly(hit.y, hit.z, vertices, count, 1, 2);	// yOz
+		else
+			inside = pointInPoly(hit.z, hit.x, vertices, count, 2, 0);	// zOx
+
+		if (inside)
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,77 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+//
+// sight.h
+// Line of sight queries of the bots. The bots ask their questions while they think and
+// the answers are found all at once with the blockmap, so a bot gets its answer on the next tic.
+
+#ifndef SIGHT_H
+#define SIGHT_H
+
+#include "vecmath.h"	/* Float3 */
+
+#include <cstdint>
+#include <vector>
+using namespace std;
+
+class Level;
+class ThreadPool;
+
+struct SightQuery
+{
+	uint32_t key;	// Chosen by the one who asks, like the index of a player
+	Float3 from;
+	Float3 to;
+};
+
+class LineOfSight
+{
+public:
+	enum Answer: unsigned char
+	{
+		UNKNOWN,	// Nothing was asked with this key
+		VISIBLE,
+		BLOCKED
+	};
+
+	// Without a thread pool, the queries are answered on the thread that calls Resolve()
+	explicit LineOfSight(const Level& level, ThreadPool* pool = nullptr);
+
+	// Ask if anything is between two points. The answer replaces the previous one that had the same key
+	// once Resolve() is called. The last query that was submitted with a key is the one that counts.
+	void Submit(uint32_t key, const Float3& from, const Float3& to);
+	void Submit(const vector<SightQuery>& queries);
+
+	// Answer every query that was submitted since the last call. Big batches use the thread pool.
+	void Resolve();
+
+	// Answer that was found by the last call to Resolve() with this key
+	Answer Get(uint32_t key) const;
+
+	unsigned int Resolved() const;	// Number of queries answered by the last call to Resolve()
+
+private:
+	const Level& level_;
+	vector<SightQuery> queries_;
+	vector<unsigned char> blocked_;	// One per query, written by the workers
+	vector<Answer> answers_;	// Indexed by key
+	unsigned int resolved_ = 0;
+	ThreadPool* pool_;
+
+	bool Blocked(const Float3& from, const Float3& to) const;
+};
+
+#endif	// SIGHT_H
@@ -0,0 +1,329 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// spectator.cpp
+// Sends a network game to spectators and lets them watch it. The commands of every tic are
+// published on a ZeroMQ PUB socket with a copy of the game state from time to time (a keyframe),
+// so a spectator can join at any moment.
+
+#include "spectator.h"
+#include "gamestate.h"	/* GameState, Checksum */
+#include "packet.h"	/* WriteVarint, ReadVarint, WriteCommand, ReadCommand, WritePacked, ReadPacked */
+
+#include <zmq.hpp>
+#include <vector>
+#include <string>
+#include <iostream>	/* cout */
+#include <chrono>
+#include <algorithm>	/* max */
+#include <cstddef>	/* ptrdiff_t */
+#include <stdexcept>
+
+using namespace std;
+using namespace zmq;
+
+// First byte of each message
+enum SpectatorMessage: unsigned char
+{
+	SPECTATE_KEYFRAME = 'K',	// Tic, info of the game and the state before the tic
+	SPECTATE_TIC = 'T'	// Tic, commands of every player and the checksum after the tic
+};
+
+// Messages that can wait for a spectator who is slow. The ones after that are dropped and the
+// spectator jumps to the next keyframe. About a minute of the game.
+const int SPECTATOR_QUEUE = 4096;
+
+Broadcast::Broadcast(const string& port, const string& info, unsigned int interval)
+	: context_(1), sock_(context_, ZMQ_XPUB), info_(info), interval_(max(interval, 1u))
+{
+	// Every subscription is received, so each spectator who joins is seen
+	int verbose = 1;
+	sock_.setsockopt(ZMQ_XPUB_VERBOSE, &verbose, sizeof(int));
+	sock_.setsockopt(ZMQ_SNDHWM, &SPECTATOR_QUEUE, sizeof(int));
+
+	cout << "Broadcasting the game to spectators on port '" << port << "'" << endl;
+	sock_.bind(port.find("://") != string::npos ? port : "tcp://*:" + port);
+}
+
+Broadcast::~Broadcast()
+{
+	// Give the last tics some time to leave
+	int linger = 1000;
+	sock_.setsockopt(ZMQ_LINGER, &linger, sizeof(int));
+}
+
+bool Broadcast::KeyframeDue(unsigned int tic) const
+{
+	return tic % interval_ == 0;
+}
+
+void Broadcast::send(const vector<unsigned char>& message)
+{
+	// A PUB socket never waits. A spectator who is too slow misses messages.
+	sock_.send(message.data(), message.size(), ZMQ_DONTWAIT);
+	bytes_ += message.size();
+}
+
+void Broadcast::welcome()
+{
+	bool joined = false;
+
+	// A subscription starts with 1 and an unsubscription with 0
+	while (sock_.recv(&subscription_, ZMQ_DONTWAIT))
+	{
+		if (subscription_.size() > 0 && subscription_.data<unsigned char>()[0] == 1)
+		{
+			joined = true;
+			joined_++;
+		}
+	}
+
+	// Everyone gets them, but the spectators who are already watching ignore them
+	if (joined && !keyframe_.empty())
+	{
+		send(keyframe_);
+
+		for (unsigned int i = 0; i < historySize_; i++)
+			send(history_[i]);
+	}
+}
+
+void Broadcast::Publish(unsigned int tic, const vector<vector<unsigned char>>& commands, const Checksum& sum, const GameState& before)
+{
+	welcome();
+
+	if (KeyframeDue(tic))
+	{
+		keyframe_.clear();
+		keyframe_.push_back(SPECTATE_KEYFRAME);
+		WriteVarint(keyframe_, tic);
+		WriteVarint(keyframe_, info_.size());
+		keyframe_.insert(keyframe_.end(), info_.begin(), info_.end());
+		WritePacked(keyframe_, before.Data());
+		send(keyframe_);
+
+		// The tics after it are sent again with it
+		historySize_ = 0;
+		previous_.clear();
+
+		keyframes_++;
+		stateBytes_ += before.Size();
+		keyframeBytes_ += keyframe_.size();
+	}
+
+	if (historySize_ == history_.size())
+		history_.emplace_back();
+
+	// Commands are written as their difference with the ones of the last tic
+	vector<unsigned char>& message = history_[historySize_++];
+	message.clear();
+	message.push_back(SPECTATE_TIC);
+	WriteVarint(message, tic);
+	WriteVarint(message, commands.size());
+
+	for (unsigned int i = 0; i < commands.size(); i++)
+		WriteCommand(message, commands[i], i < previous_.size() ? &previous_[i] : nullptr);
+
+	size_t pos = message.size();
+	message.resize(pos + Checksum::SIZE);
+	sum.Write(&message[pos]);
+
+	send(message);
+	previous_ = commands;
+	tics_++;
+}
+
+void Broadcast::PrintStats() const
+{
+	cout << "Spectators: " << joined_ << " joined";
+
+	if (tics_ > 0)
+		cout << ", " << bytes_ / tics_ << " bytes published per tic";
+
+	if (keyframes_ > 0)
+	{
+		cout << ", keyframes of " << keyframeBytes_ / keyframes_ << " bytes (" << stateBytes_ / keyframes_
+			<< " before compression)";
+	}
+
+	cout << "." << endl;
+}
+
+Spectator::Spectator()
+	: context_(1), sock_(context_, ZMQ_SUB)
+{
+}
+
+Spectator::~Spectator()
+{
+	int linger = 0;
+	sock_.setsockopt(ZMQ_LINGER, &linger, sizeof(int));
+}
+
+string Spectator::Connect(const string& location, int timeout)
+{
+	sock_.setsockopt(ZMQ_RCVHWM, &SPECTATOR_QUEUE, sizeof(int));
+	sock_.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+
+	cout << "Watching the game at '" << location << "'" << endl;
+	sock_.connect(location.find("://") != string::npos ? location : "tcp://" + location);
+
+	// The tics before the first keyframe are not used
+	if (!readNext(timeout))
+	{
+		throw runtime_error("Nothing was received from '" + location + "'");
+	}
+
+	cout << "Joined the game at tic " << next_ - 1 << endl;
+	return info_;
+}
+
+bool Spectator::receive(int timeout)
+{
+	pollitem_t item = {static_cast<void*>(sock_), 0, ZMQ_POLLIN, 0};
+	if (poll(&item, 1, timeout) <= 0)
+		return false;
+
+	return sock_.recv(&message_, ZMQ_DONTWAIT);
+}
+
+void Spectator::readKeyframe(const unsigned char* pos, const unsigned char* end, unsigned int tic)
+{
+	uint32_t size = ReadVarint(pos, end);
+	if (size > (size_t)(end - pos))
+		throw runtime_error("Network packet is incomplete.");
+
+	info_.assign(reinterpret_cast<const char*>(pos), size);
+	pos += size;
+
+	vector<unsigned char> state;
+	ReadPacked(pos, end, state);
+	keyframe_.Load(state);
+
+	synced_ = true;
+	restore_ = true;
+	next_ = tic;
+	previous_.clear();
+}
+
+// Read messages until the next tic is there
+bool Spectator::readNext(int timeout)
+{
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout);
+
+	while (!ready_)
+	{
+		int left = max(0, (int)chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count());
+		if (!receive(left))
+			return false;
+
+		const unsigned char* pos = message_.data<unsigned char>();
+		const unsigned char* end = pos + message_.size();
+
+		if (pos == end)
+			continue;
+
+		unsigned char type = *pos++;
+		unsigned int tic = ReadVarint(pos, end);
+
+		if (type == SPECTATE_KEYFRAME)
+		{
+			// Old keyframes are sent again for the spectators who join
+			if (synced_ && tic < next_)
+				continue;
+
+			if (synced_ && tic == next_)
+			{
+				// The game is already in this state. The next commands are not written as a difference.
+				previous_.clear();
+				continue;
+			}
+
+			if (synced_)
+			{
+				cout << "Missed tics " << next_ << " to " << tic - 1 << " of the game. Jumped to tic " << tic << "." << endl;
+				jumps_++;
+			}
+
+			readKeyframe(pos, end, tic);
+		}
+		else if (type == SPECTATE_TIC && synced_)
+		{
+			if (tic < next_)
+				continue;
+
+			if (tic > next_)
+			{
+				// Wait for the next keyframe
+				cout << "Missed tics of the game after tic " << next_ << ". Waiting for the next keyframe." << endl;
+				synced_ = false;
+				continue;
+			}
+
+			commands_.resize(ReadVarint(pos, end));
+			for (unsigned int i = 0; i < commands_.size(); i++)
+				ReadCommand(pos, end, commands_[i], i < previous_.size() ? &previous_[i] : nullptr);
+
+			if (end - pos < (ptrdiff_t)Checksum::SIZE)
+				throw runtime_error("Network packet is incomplete.");
+
+			sum_.Read(pos);
+			previous_ = commands_;
+			ready_ = true;
+			next_++;
+		}
+	}
+
+	return true;
+}
+
+bool Spectator::ReceiveTic(Level& lvl, vector<vector<unsigned char>>& commands, Checksum& sum, int timeout)
+{
+	if (!ready_ && !readNext(timeout))
+		return false;
+
+	if (restore_)
+	{
+		keyframe_.Restore(lvl);
+		restore_ = false;
+	}
+
+	commands = commands_;
+	sum = sum_;
+	tic_ = next_ - 1;
+	ready_ = false;
+	tics_++;
+	return true;
+}
+
+bool Spectator::Waiting()
+{
+	return ready_ || readNext(0);
+}
+
+unsigned int Spectator::Tic() const
+{
+	return tic_;
+}
+
+void Spectator::PrintStats() const
+{
+	cout << "Watched " << tics_ << " tics";
+
+	if (jumps_ > 0)
+		cout << " and jumped ahead " << jumps_ << " times because tics were lost";
+
+	cout << "." << endl;
+}
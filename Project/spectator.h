@@ -0,0 +1,130 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// spectator.h
+// Sends a network game to spectators and lets them watch it. The commands of every tic are
+// published on a ZeroMQ PUB socket with a copy of the game state from time to time (a keyframe),
+// so a spectator can join at any moment.
+
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include "gamestate.h"	/* GameState, Checksum */
+
+#include <zmq.hpp>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+using namespace std;
+using namespace zmq;
+
+class Level;
+
+// Each tic is published once, whatever the number of spectators. ZeroMQ copies it to each of them
+// on its own thread. A spectator who joins gets the latest keyframe and the tics after it.
+class Broadcast
+{
+public:
+	// 'info' is the level name, seed and number of players, like the handshake of the network.
+	// 'interval' is the number of tics between two keyframes.
+	Broadcast(const string& port, const string& info, unsigned int interval);
+	~Broadcast();
+
+	Broadcast(const Broadcast&) = delete;
+	Broadcast& operator=(const Broadcast&) = delete;
+
+	bool KeyframeDue(unsigned int tic) const;	// The state before this tic will be published
+
+	// Publish a tic once it was played with the commands of every player. 'before' is the state
+	// before the tic and is only used when a keyframe is due.
+	void Publish(unsigned int tic, const vector<vector<unsigned char>>& commands, const Checksum& sum, const GameState& before);
+
+	void PrintStats() const;
+
+private:
+	context_t context_;
+	socket_t sock_;
+	string info_;
+	unsigned int interval_;
+
+	vector<unsigned char> keyframe_;	// Latest keyframe
+	vector<vector<unsigned char>> history_;	// Tics since the latest keyframe. The unused ones keep their memory.
+	unsigned int historySize_ = 0;
+	vector<vector<unsigned char>> previous_;	// Commands of the last tic. Empty after a keyframe.
+	message_t subscription_;
+
+	// Stats
+	unsigned int joined_ = 0;
+	unsigned int tics_ = 0;
+	unsigned int keyframes_ = 0;
+	size_t bytes_ = 0;
+	size_t stateBytes_ = 0;	// Before compression
+	size_t keyframeBytes_ = 0;
+
+	void send(const vector<unsigned char>& message);
+	void welcome();	// Send the latest keyframe and the tics after it if a spectator joined
+};
+
+// Watch a game that's broadcast. The spectator plays the same tics as the players.
+class Spectator
+{
+public:
+	Spectator();
+	~Spectator();
+
+	Spectator(const Spectator&) = delete;
+	Spectator& operator=(const Spectator&) = delete;
+
+	// Wait for a keyframe. Returns the info of the game, which is used to load the level.
+	string Connect(const string& location, int timeout);
+
+	// Get the commands of the next tic and the checksum of the game after it. Returns false if nothing
+	// arrived in time. The level is put in the state of the keyframe before the first tic, and again
+	// if tics were lost.
+	bool ReceiveTic(Level& lvl, vector<vector<unsigned char>>& commands, Checksum& sum, int timeout);
+	bool Waiting();	// The next tic already arrived
+	unsigned int Tic() const;	// Of the last tic that was received
+
+	void PrintStats() const;
+
+private:
+	context_t context_;
+	socket_t sock_;
+	message_t message_;
+
+	GameState keyframe_;
+	string info_;
+	bool synced_ = false;	// False until a keyframe arrives
+	bool restore_ = false;	// The next tic is the one of the keyframe
+	unsigned int next_ = 0;	// Next tic to receive
+	unsigned int tic_ = 0;
+
+	// Next tic, read before it's needed
+	bool ready_ = false;
+	vector<vector<unsigned char>> commands_;
+	vector<vector<unsigned char>> previous_;
+	Checksum sum_;
+
+	// Stats
+	unsigned int tics_ = 0;
+	unsigned int jumps_ = 0;
+
+	bool receive(int timeout);
+	bool readNext(int timeout);
+	void readKeyframe(const unsigned char* pos, const unsigned char* end, unsigned int tic);
+};
+
+#endif	// SPECTATOR_H
@@ -0,0 +1,101 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// spscqueue.h
+// Queue between two threads that doesn't use locks. One thread pushes and the other one pops.
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+using namespace std;
+
+// The elements are created once and reused, so the memory that they own is kept from one use to the next.
+// Only one thread may call Back() and Push(), and only one other thread may call Front() and Pop().
+template<class T> class SpscQueue
+{
+public:
+	explicit SpscQueue(size_t capacity)	// Rounded up to a power of two
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size *= 2;
+
+		items_.resize(size);
+		mask_ = size - 1;
+	}
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Element that will be filled next. Null if the queue is full.
+	T* Back()
+	{
+		size_t tail = tail_.load(memory_order_relaxed);
+		if (tail - head_.load(memory_order_acquire) > mask_)
+			return nullptr;
+
+		return &items_[tail & mask_];
+	}
+
+	void Push()	// The element from Back() can be popped
+	{
+		tail_.store(tail_.load(memory_order_relaxed) + 1, memory_order_release);
+	}
+
+	// Oldest element. Null if the queue is empty.
+	T* Front()
+	{
+		size_t head = head_.load(memory_order_relaxed);
+		if (head == tail_.load(memory_order_acquire))
+			return nullptr;
+
+		return &items_[head & mask_];
+	}
+
+	void Pop()	// The element from Front() can be filled again
+	{
+		head_.store(head_.load(memory_order_relaxed) + 1, memory_order_release);
+	}
+
+	size_t Size() const	// May already be different when another thread uses the queue
+	{
+		return tail_.load(memory_order_acquire) - head_.load(memory_order_acquire);
+	}
+
+	size_t Capacity() const
+	{
+		return items_.size();
+	}
+
+	// Only while no other thread uses the queue, to prepare the elements
+	T& Item(size_t index)
+	{
+		return items_[index];
+	}
+
+private:
+	vector<T> items_;
+	size_t mask_;
+
+	// Each thread writes its own position. They are kept apart so they aren't in the same cache line.
+	atomic<size_t> head_{0};	// Next element to pop
+	char padding_[64];
+	atomic<size_t> tail_{0};	// Next element to push
+};
+
+#endif	// SPSCQUEUE_H
@@ -17,18 +17,20 @@
 // Texture loader
 
 #include "texture.h"
+#include "log.h"	/* Log */
 
 #include <SDL2/SDL_image.h>
 #include <GL/gl.h>
 #include <GL/glu.h>	/* gluErrorString */
 
 #include <string>
-#include <iostream>
 #include <utility>	/* swap */
 #include <algorithm>	/* transform */
 #include <stdexcept>
 using namespace std;
 
+bool Texture::headless_ = false;
+
 Texture::Texture(const string& Path, bool enableFiltering)
 {
 	// Surface: Blue, Green, Red
@@ -42,6 +44,13 @@ Texture::Texture(const string& Path, bool enableFiltering)
 	Name_ = Path;
 	Width_ = Surface->w;
 	Height_ = Surface->h;
+	Id_ = 0;
+
+	if (headless_)
+	{
+		SDL_FreeSurface(Surface);
+		return;
+	}
 
 	// Create an OpenGL texture
 	GLuint textureID;
@@ -100,7 +109,7 @@ Texture::Texture(const string& Path, bool enableFiltering)
 		throw runtime_error((const char*)gluErrorString(ErrorCode));
 	}
 
-	cout << "Texture loaded: '" << Path << "' is " << Surface->w << 'x' << Surface->h << 'x' << bits << endl;
+	Log() << "Texture loaded: '" << Path << "' is " << Surface->w << 'x' << Surface->h << 'x' << bits << endl;
 
 	// Set the ID and free the surface
 	Id_ = textureID;
@@ -140,10 +149,18 @@ unsigned short Texture::Height() const
 
 void Texture::Bind()
 {
-	glBindTexture(GL_TEXTURE_2D, Id_);
+	if (!headless_)
+		glBindTexture(GL_TEXTURE_2D, Id_);
+}
+
+void Texture::SetHeadless(bool headless)
+{
+	headless_ = headless;
 }
 
 Texture::~Texture() {
-	cout << "Deleting texture " << Name_ << " (" << Id_ << ")" << endl;
-	glDeleteTextures(1, &Id_);
+	Log() << "Deleting texture " << Name_ << " (" << Id_ << ")" << endl;
+
+	if (!headless_)
+		glDeleteTextures(1, &Id_);
 }
@@ -31,6 +31,8 @@ private:
 	GLuint Id_;
 	unsigned short Width_;
 	unsigned short Height_;
+
+	static bool headless_;
 public:
 	Texture() = delete;
 	Texture(const string& Path, bool enableFiltering);
@@ -42,6 +44,9 @@ public:
 	unsigned short Width() const;
 	unsigned short Height() const;
 	void Bind();
+
+	// Without a window, only the size of the images is kept. The game can be played but not drawn.
+	static void SetHeadless(bool headless);
 };
 
 #endif	// TEXTURE_H
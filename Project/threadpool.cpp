@@ -0,0 +1,131 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// threadpool.cpp
+// Fixed set of worker threads that run tasks
+
+#include "threadpool.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <future>
+#include <algorithm>	/* min */
+using namespace std;
+
+unsigned int DefaultThreadCount()
+{
+	// Can return zero if it's not known
+	unsigned int cores = thread::hardware_concurrency();
+	return cores > 0 ? cores : 1;
+}
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	if (threads == 0)
+		threads = DefaultThreadCount();
+
+	for (unsigned int i = 0; i < threads; i++)
+	{
+		workers_.emplace_back(&ThreadPool::Work, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		stop_ = true;
+	}
+
+	wake_.notify_all();
+
+	for (unsigned int i = 0; i < workers_.size(); i++)
+	{
+		workers_[i].join();
+	}
+}
+
+unsigned int ThreadPool::Size() const
+{
+	return workers_.size();
+}
+
+void ThreadPool::Work()
+{
+	for (;;)
+	{
+		packaged_task<void()> task;
+
+		{
+			unique_lock<mutex> lock(mutex_);
+			wake_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+
+			// Finish the remaining tasks before stopping
+			if (tasks_.empty())
+				return;
+
+			task = move(tasks_.front());
+			tasks_.pop_front();
+		}
+
+		task();
+	}
+}
+
+future<void> ThreadPool::Submit(function<void()> task)
+{
+	packaged_task<void()> packaged(move(task));
+	future<void> result = packaged.get_future();
+
+	{
+		lock_guard<mutex> lock(mutex_);
+		tasks_.push_back(move(packaged));
+	}
+
+	wake_.notify_one();
+
+	return result;
+}
+
+void ThreadPool::ParallelFor(unsigned int count, const function<void(unsigned int first, unsigned int last)>& body)
+{
+	if (count == 0)
+		return;
+
+	unsigned int ranges = min(count, Size());
+	vector<future<void>> done;
+
+	for (unsigned int r = 0; r < ranges; r++)
+	{
+		// Spread the remainder on the first ranges
+		unsigned int first = (unsigned long long)count * r / ranges;
+		unsigned int last = (unsigned long long)count * (r + 1) / ranges;
+
+		done.push_back(Submit([&body, first, last] { body(first, last); }));
+	}
+
+	// Wait for everything before rethrowing, because 'body' is used by the tasks
+	for (unsigned int r = 0; r < done.size(); r++)
+	{
+		done[r].wait();
+	}
+
+	for (unsigned int r = 0; r < done.size(); r++)
+	{
+		done[r].get();
+	}
+}
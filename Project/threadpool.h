@@ -0,0 +1,62 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// threadpool.h
+// Fixed set of worker threads that run tasks
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+using namespace std;
+
+class ThreadPool
+{
+private:
+	vector<thread> workers_;
+	deque<packaged_task<void()>> tasks_;
+	mutex mutex_;
+	condition_variable wake_;
+	bool stop_ = false;
+
+	void Work();
+
+public:
+	explicit ThreadPool(unsigned int threads = 0);	// Zero means one thread per core
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int Size() const;
+
+	// Run a task on a worker. The future rethrows its exception.
+	future<void> Submit(function<void()> task);
+
+	// Split [0, count) in contiguous ranges and call 'body(first, last)' for each range on the workers.
+	// Returns when every range is done. There are never more ranges than workers.
+	void ParallelFor(unsigned int count, const function<void(unsigned int first, unsigned int last)>& body);
+};
+
+// Number of threads to use when nothing was specified
+unsigned int DefaultThreadCount();
+
+#endif	// THREADPOOL_H
@@ -24,9 +24,14 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>	/* min */
+#include <stdexcept>
 
 using namespace std;
 
+const size_t Ticcmd::HEADER_SIZE;
+const size_t Ticcmd::MAX_SIZE;
+
 Ticcmd::Ticcmd()
 {
 	Reset();
@@ -48,10 +53,18 @@ void Ticcmd::Reset()
 // Encodes a player's data to a buffer for network usage
 vector<unsigned char> Ticcmd::Serialize() const
 {
-	// Serialize the command
-	vector<unsigned char> c;
-	c.resize(8, 0);	// It must be at least 8 bytes long
+	vector<unsigned char> c(HEADER_SIZE + min(chat.size(), MAX_SIZE - HEADER_SIZE));
+	Serialize(c.data(), c.size());
+	return c;
+}
+
+// Encodes a player's data to a buffer that the caller owns
+size_t Ticcmd::Serialize(unsigned char* c, size_t size) const
+{
+	if (size < HEADER_SIZE)
+		throw runtime_error("Buffer is too small for a tic command.");
 
+	// Serialize the command
 	c[0] = quit;
 	c[0] = c[0] << 1;
 
@@ -77,16 +90,17 @@ vector<unsigned char> Ticcmd::Serialize() const
 	c[6] = vertical;
 #endif
 
-	// Save the chat string's size
-	c[7] = chat.size();
+	// Save the chat string's size. What doesn't fit is cut.
+	size_t length = min(chat.size(), min(size, MAX_SIZE) - HEADER_SIZE);
+	c[7] = length;
 
 	// Write chat string to buffer
-	for (unsigned int i = 0; i < chat.size(); i++)
+	for (unsigned int i = 0; i < length; i++)
 	{
-		c.push_back(chat[i]);
+		c[HEADER_SIZE + i] = chat[i];
 	}
 
-	return c;
+	return HEADER_SIZE + length;
 }
 
 // Encodes a player's data to a buffer for network usage
@@ -107,10 +121,16 @@ vector<unsigned char> Ticcmd::Serialize2() const
 }
 
 // Decodes a player's data from a buffer and write to command
-void Ticcmd::Deserialize(vector<unsigned char> v)
+void Ticcmd::Deserialize(const vector<unsigned char>& v)
+{
+	Deserialize(v.data(), v.size());
+}
+
+// Decodes a player's data from a buffer and write to command
+void Ticcmd::Deserialize(const unsigned char* v, size_t size)
 {
 	// Safety check if not a least 8 bytes
-	if (v.size() < 8)
+	if (size < HEADER_SIZE)
 		return;
 
 	// Deserialize the command
@@ -143,9 +163,9 @@ void Ticcmd::Deserialize(vector<unsigned char> v)
 	chat.clear();
 
 	// Write the chat string to the command
-	for (unsigned int i = 0; i < v[7] && i < 36; i++)
+	for (unsigned int i = 0; i < v[7] && i < 36 && HEADER_SIZE + i < size; i++)
 	{
-		chat.push_back(v[i + 8]);
+		chat.push_back(v[HEADER_SIZE + i]);
 	}
 }
 
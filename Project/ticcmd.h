@@ -22,6 +22,7 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
 
 using namespace std;
 
@@ -37,13 +38,20 @@ public:
 	bool quit;
 	string chat;
 
+	static const size_t HEADER_SIZE = 8;	// Size without the chat string
+	static const size_t MAX_SIZE = HEADER_SIZE + 255;
+
 	Ticcmd();
 	void Reset();
 
 	vector<unsigned char> Serialize() const;	// raw binary
 	vector<unsigned char> Serialize2() const;	// line of text
-	void Deserialize(vector<unsigned char> v);	// raw binary
+	void Deserialize(const vector<unsigned char>& v);	// raw binary
 	void Deserialize2(vector<unsigned char> v);	// line of text
+
+	// Same as above without allocating. Returns the number of bytes written, which is at most MAX_SIZE.
+	size_t Serialize(unsigned char* buffer, size_t size) const;
+	void Deserialize(const unsigned char* data, size_t size);
 };
 
 #endif /* TICCMD_H */
@@ -0,0 +1,164 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// timedemo.cpp
+// Statistics of -timedemo, which plays a demo as fast as possible to measure the speed of the game.
+// Each tic is cut in phases that are timed separately.
+
+#include "timedemo.h"
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <iostream>	/* cout */
+#include <fstream>
+#include <iomanip>	/* setw, setprecision */
+#include <algorithm>	/* sort, max, min */
+#include <stdexcept>
+using namespace std;
+
+// Names of the phases, also used in the JSON file
+static const char* const PHASE_NAMES[NUM_PHASES] = {"input", "streaming", "movement", "collision", "hitscan", "things", "checksum", "render"};
+
+TicProfiler::TicProfiler()
+{
+	// Enough for a few minutes of a demo, so it's rare to allocate while timing
+	costs_.reserve(1 << 14);
+}
+
+void TicProfiler::BeginTic()
+{
+	tic_ = lap_ = chrono::steady_clock::now();
+
+	if (costs_.empty())
+		start_ = tic_;
+}
+
+void TicProfiler::Lap(TicPhase phase)
+{
+	auto now = chrono::steady_clock::now();
+	phases_[phase] += chrono::duration<double, micro>(now - lap_).count();
+	lap_ = now;
+}
+
+void TicProfiler::EndTic()
+{
+	end_ = chrono::steady_clock::now();
+	costs_.push_back(chrono::duration<float, micro>(end_ - tic_).count());
+}
+
+double TicProfiler::Seconds() const
+{
+	return costs_.empty() ? 0 : chrono::duration<double>(end_ - start_).count();
+}
+
+float TicProfiler::Percentile(float fraction) const
+{
+	if (costs_.empty())
+		return 0;
+
+	vector<float> sorted(costs_);
+	size_t index = min(sorted.size() - 1, (size_t)(fraction * sorted.size()));
+	nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	return sorted[index];
+}
+
+void TicProfiler::Print() const
+{
+	size_t tics = max(costs_.size(), (size_t)1);
+	double total = 0;
+	for (unsigned int i = 0; i < NUM_PHASES; i++)
+		total += phases_[i];
+
+	cout << "Timedemo: " << costs_.size() << " tics in " << Seconds() << "s ("
+		<< (Seconds() > 0 ? (unsigned int)(costs_.size() / Seconds()) : 0) << " tics/s)" << endl;
+	cout << "Time of a tic: " << Percentile(0.5f) << "us (50%), " << Percentile(0.99f) << "us (99%), "
+		<< Percentile(1) << "us (max)" << endl;
+
+	for (unsigned int i = 0; i < NUM_PHASES; i++)
+	{
+		cout << "  " << left << setw(10) << PHASE_NAMES[i] << right << setw(10) << fixed << setprecision(2) << phases_[i] / tics
+			<< "us per tic (" << setw(5) << setprecision(1) << (total > 0 ? phases_[i] * 100 / total : 0) << "%)" << endl;
+	}
+
+	cout.unsetf(ios::fixed);
+	cout << setprecision(6);
+}
+
+// Only the characters that can't be written as they are in a JSON string
+static string JsonString(const string& text)
+{
+	string escaped = "\"";
+
+	for (unsigned int i = 0; i < text.size(); i++)
+	{
+		unsigned char c = text[i];
+
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (c < 0x20)
+		{
+			const char* hex = "0123456789abcdef";
+			escaped += "\\u00";
+			escaped += hex[c >> 4];
+			escaped += hex[c & 15];
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+
+	return escaped + "\"";
+}
+
+void TicProfiler::WriteJson(const string& path, const TimedemoInfo& info) const
+{
+	ofstream file(path);
+	if (!file.is_open())
+	{
+		throw runtime_error("Could not open file '" + path + "' to write");
+	}
+
+	size_t tics = max(costs_.size(), (size_t)1);
+
+	file << "{\n";
+	file << "\t\"version\": " << JsonString(info.version) << ",\n";
+	file << "\t\"demo\": " << JsonString(info.demo) << ",\n";
+	file << "\t\"level\": " << JsonString(info.level) << ",\n";
+	file << "\t\"players\": " << info.players << ",\n";
+	file << "\t\"render\": " << (info.render ? "true" : "false") << ",\n";
+	file << "\t\"in_sync\": " << (!info.checksums ? "null" : info.desynced ? "false" : "true") << ",\n";
+	file << "\t\"tics\": " << costs_.size() << ",\n";
+	file << "\t\"seconds\": " << Seconds() << ",\n";
+	file << "\t\"tics_per_second\": " << (Seconds() > 0 ? costs_.size() / Seconds() : 0) << ",\n";
+	file << "\t\"tic_us\": {\"p50\": " << Percentile(0.5f) << ", \"p99\": " << Percentile(0.99f) << ", \"max\": " << Percentile(1) << "},\n";
+	file << "\t\"phases_us_per_tic\": {";
+
+	for (unsigned int i = 0; i < NUM_PHASES; i++)
+		file << (i > 0 ? ", " : "") << "\"" << PHASE_NAMES[i] << "\": " << phases_[i] / tics;
+
+	file << "}\n}\n";
+
+	if (!file)
+	{
+		throw runtime_error("Could not write to '" + path + "'");
+	}
+
+	cout << "Statistics written to " << path << endl;
+}
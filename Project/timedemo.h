@@ -0,0 +1,76 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// timedemo.h
+// Statistics of -timedemo, which plays a demo as fast as possible to measure the speed of the game.
+// Each tic is cut in phases that are timed separately.
+
+#ifndef TIMEDEMO_H
+#define TIMEDEMO_H
+
+#include <vector>
+#include <string>
+#include <chrono>
+using namespace std;
+
+enum TicPhase
+{
+	PHASE_INPUT,	// Reading the commands from the demo
+	PHASE_STREAMING,	// Tiles of the level around the players
+	PHASE_MOVEMENT,	// Commands of the players
+	PHASE_COLLISION,	// With the walls, the floors and the other players
+	PHASE_HITSCAN,
+	PHASE_THINGS,
+	PHASE_CHECKSUM,	// And the comparison with the demo
+	PHASE_RENDER,	// Only with -render
+	NUM_PHASES
+};
+
+struct TimedemoInfo
+{
+	string version;
+	string demo;
+	string level;
+	unsigned int players = 0;
+	bool render = false;
+	bool checksums = false;	// The demo has checksums, so 'desynced' is known
+	bool desynced = false;
+};
+
+class TicProfiler
+{
+public:
+	TicProfiler();
+
+	void BeginTic();
+	void Lap(TicPhase phase);	// The time since the last lap goes to the phase
+	void EndTic();
+
+	void Print() const;
+	void WriteJson(const string& path, const TimedemoInfo& info) const;
+
+private:
+	chrono::steady_clock::time_point start_;	// Of the first tic
+	chrono::steady_clock::time_point end_;	// Of the last tic
+	chrono::steady_clock::time_point tic_;
+	chrono::steady_clock::time_point lap_;
+	double phases_[NUM_PHASES] = {};	// Total time in microseconds
+	vector<float> costs_;	// Time of each tic in microseconds
+
+	double Seconds() const;
+	float Percentile(float fraction) const;	// Of the time of the tics
+};
+
+#endif	// TIMEDEMO_H
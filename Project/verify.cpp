@@ -0,0 +1,356 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// verify.cpp
+// Each demo is played by a worker of a thread pool with a level of its own. The random
+// numbers and the texture cache are kept per thread, so the games don't share anything.
+
+#include "verify.h"
+#include "demo.h"	/* DemoReader, DEMO_CONTAINER_EXTENSION */
+#include "level.h"
+#include "player.h"
+#include "gamestate.h"	/* GameState, Checksum, TicChecksum */
+#include "mainloop.h"	/* PlayTic */
+#include "random.h"	/* SetIndex */
+#include "texture.h"	/* Texture::SetHeadless */
+#include "threadpool.h"	/* ThreadPool */
+#include "cache.h"	/* Cache */
+#include "log.h"	/* ThreadLog */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>	/* unique_ptr */
+#include <iostream>	/* cout */
+#include <iomanip>	/* setw, setfill */
+#include <sstream>
+#include <fstream>
+#include <streambuf>
+#include <chrono>
+#include <algorithm>	/* sort */
+#include <cstdint>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <dirent.h>	/* opendir, readdir, closedir */
+#include <sys/stat.h>	/* stat */
+#endif
+
+using namespace std;
+
+struct VerifyResult
+{
+	string path;
+	unsigned int tics = 0;
+	uint64_t hash = 0;	// Of the state of the game after the last tic
+	bool desynced = false;	// With the checksums of the demo
+	unsigned int desyncTic = 0;
+	string differences;
+	string error;	// The demo could not be played
+	double seconds = 0;
+};
+
+// The levels print a lot while they load. Nothing is shown while the demos play.
+class NullBuffer: public streambuf
+{
+protected:
+	int overflow(int c) override
+	{
+		return c;
+	}
+};
+
+static bool IsDemo(const string& path)
+{
+	static const string extensions[] = {".lmp", DEMO_CONTAINER_EXTENSION};
+
+	for (const string& extension: extensions)
+	{
+		if (path.size() > extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static size_t FileSize(const string& path)
+{
+	ifstream file(path, ios::binary | ios::ate);
+	return file.is_open() ? (size_t)file.tellg() : 0;
+}
+
+static void FindDemos(const string& path, vector<string>& demos)
+{
+	if (IsDemo(path))
+	{
+		demos.push_back(path);
+		return;
+	}
+
+#ifndef _WIN32
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+	{
+		DIR* dir = opendir(path.c_str());
+		if (!dir)
+		{
+			throw runtime_error("Could not open directory '" + path + "'");
+		}
+
+		while (dirent* entry = readdir(dir))
+		{
+			string name = entry->d_name;
+			if (IsDemo(name))
+				demos.push_back(path + (path.back() == '/' ? "" : "/") + name);
+		}
+
+		closedir(dir);
+		sort(demos.begin(), demos.end());
+		return;
+	}
+#endif
+
+	// A list of demos, one per line
+	ifstream list(path);
+	if (!list.is_open())
+	{
+		throw runtime_error("Could not open '" + path + "'");
+	}
+
+	string line;
+	while (getline(list, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (!line.empty() && line[0] != '#')
+			demos.push_back(line);
+	}
+}
+
+// Lines of a hash in hexadecimal and the path of its demo
+static void ReadGolden(const string& path, map<string, uint64_t>& golden)
+{
+	ifstream file(path);
+	if (!file.is_open())
+	{
+		throw runtime_error("Could not open golden hashes '" + path + "'");
+	}
+
+	string line;
+	while (getline(file, line))
+	{
+		size_t space = line.find(' ');
+		if (space == string::npos || line[0] == '#')
+			continue;
+
+		size_t name = line.find_first_not_of(' ', space);
+		golden[line.substr(name)] = stoull(line.substr(0, space), nullptr, 16);
+	}
+}
+
+static string HashString(uint64_t hash)
+{
+	ostringstream str;
+	str << hex << setw(16) << setfill('0') << hash;
+	return str.str();
+}
+
+// Same as -playdemo, without a window
+static void PlayDemo(const string& path, float scale, VerifyResult& result)
+{
+	auto start = chrono::steady_clock::now();
+
+	DemoReader demo(path);
+	SetIndex(demo.Info().seed);
+
+	unique_ptr<Level> lvl(new Level(demo.Info().level, scale, demo.Info().players));
+	if (lvl->planes.size() == 0)
+	{
+		throw runtime_error("Failed to load level '" + demo.Info().level + "'");
+	}
+
+	lvl->SetStreaming(512 * 1024 * 1024, 0);
+	lvl->play = lvl->players[0];
+
+	bool quit = false;
+	while (!quit && demo.ReadTic(lvl->players))
+	{
+		PlayTic(lvl.get());
+
+		Checksum sum = TicChecksum(*lvl);
+		Checksum expected;
+		if (demo.ReadChecksum(expected) && expected != sum && !result.desynced)
+		{
+			result.desynced = true;
+			result.desyncTic = result.tics;
+			result.differences = sum.Differences(expected);
+		}
+
+		result.tics++;
+
+		for (unsigned int i = 0; i < lvl->players.size(); i++)
+			quit = quit || lvl->players[i]->Cmd.quit;
+	}
+
+	GameState state;
+	state.Save(*lvl);
+	result.hash = state.Hash();
+	result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+bool VerifyDemos(const VerifySettings& settings)
+{
+	vector<string> demos;
+	FindDemos(settings.demos, demos);
+
+	if (demos.empty())
+	{
+		throw runtime_error("No demos were found in '" + settings.demos + "'");
+	}
+
+	map<string, uint64_t> golden;
+	if (!settings.golden.empty() && !settings.update)
+		ReadGolden(settings.golden, golden);
+
+	vector<VerifyResult> results(demos.size());
+
+	// The longest demos start first, so a long one doesn't finish alone at the end
+	vector<unsigned int> order(demos.size());
+	vector<size_t> sizes(demos.size());
+	for (unsigned int i = 0; i < demos.size(); i++)
+	{
+		order[i] = i;
+		sizes[i] = FileSize(demos[i]);
+		results[i].path = demos[i];
+	}
+
+	sort(order.begin(), order.end(), [&sizes](unsigned int a, unsigned int b) { return sizes[a] > sizes[b]; });
+
+	Texture::SetHeadless(true);
+
+	auto start = chrono::steady_clock::now();
+	unsigned int threads;
+
+	{
+		ThreadPool pool(settings.threads);
+		threads = pool.Size();
+
+		vector<future<void>> done;
+		for (unsigned int i = 0; i < order.size(); i++)
+		{
+			VerifyResult& result = results[order[i]];
+			done.push_back(pool.Submit([&result, &settings]()
+			{
+				// Only the messages of this thread are silenced
+				NullBuffer null;
+				ostream quiet(&null);
+				ThreadLog log(quiet, quiet);
+
+				try
+				{
+					PlayDemo(result.path, settings.scale, result);
+				}
+				catch (const exception& e)
+				{
+					result.error = e.what();
+				}
+
+				// The textures are not freed if the level could not be created
+				Cache::DestroyInstance();
+			}));
+		}
+
+		for (unsigned int i = 0; i < done.size(); i++)
+			done[i].get();
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	// Results in the order of the demos
+	unsigned int failed = 0;
+	unsigned int tics = 0;
+	double busy = 0;
+
+	for (const VerifyResult& result: results)
+	{
+		tics += result.tics;
+		busy += result.seconds;
+
+		if (!result.error.empty())
+		{
+			failed++;
+			cout << "ERROR     " << result.path << ": " << result.error << endl;
+			continue;
+		}
+
+		cout << (result.desynced ? "DESYNC    " : "          ") << HashString(result.hash) << "  " << setw(7) << result.tics << " tics  " << result.path;
+		bool passed = !result.desynced;
+
+		if (result.desynced)
+		{
+			cout << " (tic " << result.desyncTic << ": " << result.differences << ")";
+		}
+
+		if (!settings.golden.empty() && !settings.update)
+		{
+			auto found = golden.find(result.path);
+
+			if (found == golden.end())
+			{
+				cout << " (no golden hash)";
+			}
+			else if (found->second != result.hash)
+			{
+				passed = false;
+				cout << " MISMATCH, expected " << HashString(found->second);
+			}
+		}
+
+		if (!passed)
+			failed++;
+
+		cout << endl;
+	}
+
+	cout << "Played " << demos.size() << " demos (" << tics << " tics) on " << threads << " threads in " << seconds << "s ("
+		<< busy << "s for the demos added up)." << endl;
+
+	if (settings.update && !settings.golden.empty())
+	{
+		ofstream file(settings.golden);
+		if (!file.is_open())
+		{
+			throw runtime_error("Could not open file '" + settings.golden + "' to write");
+		}
+
+		for (const VerifyResult& result: results)
+		{
+			if (result.error.empty() && !result.desynced)
+				file << HashString(result.hash) << "  " << result.path << endl;
+		}
+
+		cout << "Golden hashes written to '" << settings.golden << "'" << endl;
+	}
+
+	if (failed > 0)
+	{
+		cout << failed << " of " << demos.size() << " demos failed." << endl;
+		return false;
+	}
+
+	cout << "Every demo passed." << endl;
+	return true;
+}
@@ -0,0 +1,39 @@
+// Copyright (C) 2026 Alexandre-Xavier Labonté-Lamoureux
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+// verify.h
+// Plays many demos at the same time without a window to check that the game still plays
+// them the same way. The state of the game at the end of each demo is compared with the
+// one that was saved in a file of golden hashes.
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <string>
+using namespace std;
+
+struct VerifySettings
+{
+	string demos;	// A demo, a directory of demos or a text file with a demo on each line
+	string golden;	// Hashes to compare with. Nothing is compared if it's empty.
+	bool update = false;	// Write the hashes to the golden file instead
+	unsigned int threads = 0;	// Zero means one thread per core
+	float scale = 1;	// Of the levels
+};
+
+// Prints the results. Returns false if a demo desynced, failed or did not match its golden hash.
+bool VerifyDemos(const VerifySettings& settings);
+
+#endif	// VERIFY_H
@@ -412,9 +412,9 @@ void DrawScreen(GLFWwindow* window, Player* play, Level* lvl, unsigned int Frame
 		// Draw walls
 		for (unsigned int i = 0; i < lvl->planes.size(); i++)
 		{
-			if (!lvl->planes[i]->Texture.empty())
+			if (lvl->planes[i]->Texture)
 			{
-				lvl->UseTexture(lvl->planes[i]->Texture);
+				lvl->UseTexture(*lvl->planes[i]->Texture);
 
 				if (lvl->planes[i]->TwoSided)
 					glDisable(GL_CULL_FACE);
@@ -431,66 +431,66 @@ void DrawScreen(GLFWwindow* window, Player* play, Level* lvl, unsigned int Frame
 					{
 						// Notice: The Y axis on the texture coordinate is flipped (see: https://halfgeek.org/wiki/Vertically_invert_a_surface_in_SDL)
 
-						if (lvl->planes[i]->Vertices.size() == 4)
+						if (lvl->planes[i]->NumVertices() == 4)
 						{
 							// Polygons that are square
 							glBegin(GL_QUADS);
 							{
-								glTexCoord2f(lvl->planes[i]->UVs[0].x, -lvl->planes[i]->UVs[0].y);
-								glVertex3f(lvl->planes[i]->Vertices[0].y, lvl->planes[i]->Vertices[0].z, lvl->planes[i]->Vertices[0].x);
-								glTexCoord2f(lvl->planes[i]->UVs[1].x, -lvl->planes[i]->UVs[1].y);
-								glVertex3f(lvl->planes[i]->Vertices[1].y, lvl->planes[i]->Vertices[1].z, lvl->planes[i]->Vertices[1].x);
-								glTexCoord2f(lvl->planes[i]->UVs[2].x, -lvl->planes[i]->UVs[2].y);
-								glVertex3f(lvl->planes[i]->Vertices[2].y, lvl->planes[i]->Vertices[2].z, lvl->planes[i]->Vertices[2].x);
-								glTexCoord2f(lvl->planes[i]->UVs[3].x, -lvl->planes[i]->UVs[3].y);
-								glVertex3f(lvl->planes[i]->Vertices[3].y, lvl->planes[i]->Vertices[3].z, lvl->planes[i]->Vertices[3].x);
+								glTexCoord2f(lvl->planes[i]->UV(0).x, -lvl->planes[i]->UV(0).y);
+								glVertex3f(lvl->planes[i]->Vertex(0).y, lvl->planes[i]->Vertex(0).z, lvl->planes[i]->Vertex(0).x);
+								glTexCoord2f(lvl->planes[i]->UV(1).x, -lvl->planes[i]->UV(1).y);
+								glVertex3f(lvl->planes[i]->Vertex(1).y, lvl->planes[i]->Vertex(1).z, lvl->planes[i]->Vertex(1).x);
+								glTexCoord2f(lvl->planes[i]->UV(2).x, -lvl->planes[i]->UV(2).y);
+								glVertex3f(lvl->planes[i]->Vertex(2).y, lvl->planes[i]->Vertex(2).z, lvl->planes[i]->Vertex(2).x);
+								glTexCoord2f(lvl->planes[i]->UV(3).x, -lvl->planes[i]->UV(3).y);
+								glVertex3f(lvl->planes[i]->Vertex(3).y, lvl->planes[i]->Vertex(3).z, lvl->planes[i]->Vertex(3).x);
 							}
 							glEnd();
 						}
-						else if (lvl->planes[i]->Vertices.size() == 3)
+						else if (lvl->planes[i]->NumVertices() == 3)
 						{
 							// Polygons that have a triangular shape
 							glBegin(GL_TRIANGLES);
 							{
-								glTexCoord2f(lvl->planes[i]->UVs[0].x, -lvl->planes[i]->UVs[0].y);
-								glVertex3f(lvl->planes[i]->Vertices[0].y, lvl->planes[i]->Vertices[0].z, lvl->planes[i]->Vertices[0].x);
-								glTexCoord2f(lvl->planes[i]->UVs[1].x, -lvl->planes[i]->UVs[1].y);
-								glVertex3f(lvl->planes[i]->Vertices[1].y, lvl->planes[i]->Vertices[1].z, lvl->planes[i]->Vertices[1].x);
-								glTexCoord2f(lvl->planes[i]->UVs[2].x, -lvl->planes[i]->UVs[2].y);
-								glVertex3f(lvl->planes[i]->Vertices[2].y, lvl->planes[i]->Vertices[2].z, lvl->planes[i]->Vertices[2].x);
+								glTexCoord2f(lvl->planes[i]->UV(0).x, -lvl->planes[i]->UV(0).y);
+								glVertex3f(lvl->planes[i]->Vertex(0).y, lvl->planes[i]->Vertex(0).z, lvl->planes[i]->Vertex(0).x);
+								glTexCoord2f(lvl->planes[i]->UV(1).x, -lvl->planes[i]->UV(1).y);
+								glVertex3f(lvl->planes[i]->Vertex(1).y, lvl->planes[i]->Vertex(1).z, lvl->planes[i]->Vertex(1).x);
+								glTexCoord2f(lvl->planes[i]->UV(2).x, -lvl->planes[i]->UV(2).y);
+								glVertex3f(lvl->planes[i]->Vertex(2).y, lvl->planes[i]->Vertex(2).z, lvl->planes[i]->Vertex(2).x);
 							}
 							glEnd();
 						}
 					}
 					else	// No UVs
 					{
-						if (lvl->planes[i]->Vertices.size() == 4)
+						if (lvl->planes[i]->NumVertices() == 4)
 						{
 							// Polygons that are square
 							glBegin(GL_QUADS);
 							{
 								glTexCoord2f(0, 1 * lvl->planes[i]->Yscale);
-								glVertex3f(lvl->planes[i]->Vertices[0].y, lvl->planes[i]->Vertices[0].z, lvl->planes[i]->Vertices[0].x);
+								glVertex3f(lvl->planes[i]->Vertex(0).y, lvl->planes[i]->Vertex(0).z, lvl->planes[i]->Vertex(0).x);
 								glTexCoord2f(1 * lvl->planes[i]->Xscale, 1 * lvl->planes[i]->Yscale);
-								glVertex3f(lvl->planes[i]->Vertices[1].y, lvl->planes[i]->Vertices[1].z, lvl->planes[i]->Vertices[1].x);
+								glVertex3f(lvl->planes[i]->Vertex(1).y, lvl->planes[i]->Vertex(1).z, lvl->planes[i]->Vertex(1).x);
 								glTexCoord2f(1 * lvl->planes[i]->Xscale, 0);
-								glVertex3f(lvl->planes[i]->Vertices[2].y, lvl->planes[i]->Vertices[2].z, lvl->planes[i]->Vertices[2].x);
+								glVertex3f(lvl->planes[i]->Vertex(2).y, lvl->planes[i]->Vertex(2).z, lvl->planes[i]->Vertex(2).x);
 								glTexCoord2f(0, 0);
-								glVertex3f(lvl->planes[i]->Vertices[3].y, lvl->planes[i]->Vertices[3].z, lvl->planes[i]->Vertices[3].x);
+								glVertex3f(lvl->planes[i]->Vertex(3).y, lvl->planes[i]->Vertex(3).z, lvl->planes[i]->Vertex(3).x);
 							}
 							glEnd();
 						}
-						else if (lvl->planes[i]->Vertices.size() == 3)
+						else if (lvl->planes[i]->NumVertices() == 3)
 						{
 							// Polygons that have a triangular shape
 							glBegin(GL_TRIANGLES);
 							{
 								glTexCoord2f(0, 1 * lvl->planes[i]->Yscale);
-								glVertex3f(lvl->planes[i]->Vertices[0].y, lvl->planes[i]->Vertices[0].z, lvl->planes[i]->Vertices[0].x);
+								glVertex3f(lvl->planes[i]->Vertex(0).y, lvl->planes[i]->Vertex(0).z, lvl->planes[i]->Vertex(0).x);
 								glTexCoord2f(1 * lvl->planes[i]->Xscale, 1 * lvl->planes[i]->Yscale);
-								glVertex3f(lvl->planes[i]->Vertices[1].y, lvl->planes[i]->Vertices[1].z, lvl->planes[i]->Vertices[1].x);
+								glVertex3f(lvl->planes[i]->Vertex(1).y, lvl->planes[i]->Vertex(1).z, lvl->planes[i]->Vertex(1).x);
 								glTexCoord2f(1 * lvl->planes[i]->Xscale, 0);
-								glVertex3f(lvl->planes[i]->Vertices[2].y, lvl->planes[i]->Vertices[2].z, lvl->planes[i]->Vertices[2].x);
+								glVertex3f(lvl->planes[i]->Vertex(2).y, lvl->planes[i]->Vertex(2).z, lvl->planes[i]->Vertex(2).x);
 							}
 							glEnd();
 						}